@@ -0,0 +1,119 @@
+#include "../src/batch.hh"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/mapped-file.hh"
+#include "../src/parsing.hh"
+
+#include "corpus.hh"
+
+using namespace infix_parsing;
+
+
+/*
+ * Throughput of calculator --batch FILE from one thread to all of them.
+ * The input is generated once and kept in /tmp between runs; its size is
+ * BATCH_BENCHMARK_BYTES, 2 GiB by default.
+ */
+
+static void initialize()
+{
+    static bool done = false;
+    if (!done) {
+        init_table();
+        done = true;
+    }
+}
+
+static size_t input_size()
+{
+    const char *env = std::getenv("BATCH_BENCHMARK_BYTES");
+    return env ? std::strtoull(env, nullptr, 10) : size_t(2) << 30;
+}
+
+/*
+ * The input is written under a temporary name and renamed when it's
+ * complete, so a run interrupted while writing it leaves no file that
+ * later runs would take for the input.
+ */
+static std::string input_path()
+{
+    const size_t size = input_size();
+    const std::string path = "/tmp/batch-benchmark-" + std::to_string(size) + ".txt";
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0 && size_t(st.st_size) >= size)
+        return path;
+
+    const std::string partial = path + "." + std::to_string(::getpid()) + ".partial";
+    std::FILE *file = std::fopen(partial.c_str(), "w");
+    if (!file)
+        throw std::system_error(errno, std::generic_category(), "Cannot create " + partial);
+    std::mt19937 rng(corpus::default_seed);
+    std::string block;
+    size_t written = 0;
+    bool failed = false;
+    while (written < size && !failed) {
+        block.clear();
+        while (block.size() < (1 << 20)) {
+            block += corpus::expression(rng, 8);
+            block += '\n';
+        }
+        failed = std::fwrite(block.data(), 1, block.size(), file) != block.size();
+        written += block.size();
+    }
+    failed = std::fclose(file) != 0 || failed;
+    if (failed || std::rename(partial.c_str(), path.c_str()) != 0) {
+        const int error = errno;
+        std::remove(partial.c_str());
+        throw std::system_error(error, std::generic_category(), "Cannot write " + path);
+    }
+    return path;
+}
+
+static void BM_ParallelBatch(benchmark::State &state)
+{
+    initialize();
+    std::string path;
+    try {
+        path = input_path();
+    } catch (const std::exception &e) {
+        state.SkipWithError(e.what());
+        return;
+    }
+    io::MappedFile file(path);
+    const int out = ::open("/dev/null", O_WRONLY);
+    if (out < 0) {
+        state.SkipWithError("Cannot open /dev/null");
+        return;
+    }
+    for (auto _ : state) {
+        io::ParallelBatch batch(io::BatchProcessor::value, state.range(0));
+        batch.run(file.data(), file.data() + file.size(), out);
+        state.counters["lines"] = batch.lines();
+    }
+    ::close(out);
+    state.SetBytesProcessed(state.iterations() * file.size());
+}
+
+static void thread_counts(benchmark::internal::Benchmark *b)
+{
+    const int all = std::thread::hardware_concurrency();
+    for (int threads = 1; threads < all; threads *= 2)
+        b->Arg(threads);
+    b->Arg(all > 0 ? all : 1);
+}
+
+BENCHMARK(BM_ParallelBatch)->Apply(thread_counts)->Iterations(1)->UseRealTime()->Unit(benchmark::kSecond);
@@ -0,0 +1,114 @@
+#include "../src/calculation-tree.hh"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/parsing.hh"
+#include "../src/serializer.hh"
+
+#include "corpus.hh"
+
+using namespace infix_parsing;
+using calculation::Operand;
+using calculation::Serializer;
+
+
+/*
+ * Evaluation latency by the depth and the width of trees, and the cost
+ * of printing them. Trees are parsed once, outside of the measurement.
+ */
+
+static void initialize()
+{
+    static bool done = false;
+    if (!done) {
+        init_table();
+        done = true;
+    }
+}
+
+static void evaluate(benchmark::State &state, const std::string &source)
+{
+    initialize();
+    std::shared_ptr<Operand> tree = parse_expression(source);
+    for (auto _ : state) {
+        double value = tree->evaluate();
+        benchmark::DoNotOptimize(value);
+    }
+}
+
+/*
+ * One operand under the other, the tree is as deep as the argument.
+ */
+static void BM_EvaluateDepthUnary(benchmark::State &state)
+{
+    evaluate(state, corpus::unary_chain(state.range(0)));
+}
+
+static void BM_EvaluateDepthBinary(benchmark::State &state)
+{
+    evaluate(state, corpus::nested(state.range(0)));
+}
+
+/*
+ * A complete tree, 2^depth numbers wide and only depth deep.
+ */
+static void BM_EvaluateWidth(benchmark::State &state)
+{
+    evaluate(state, corpus::balanced(state.range(0)));
+}
+
+BENCHMARK(BM_EvaluateDepthUnary)->RangeMultiplier(4)->Range(4, 4096);
+BENCHMARK(BM_EvaluateDepthBinary)->RangeMultiplier(4)->Range(4, 4096);
+BENCHMARK(BM_EvaluateWidth)->DenseRange(2, 12, 2);
+
+
+/*
+ * Operand::str(), the prefix notation, against the infix serializer
+ * writing into a reused string. The argument is the number of binary
+ * operators of random expressions.
+ */
+static void BM_Str(benchmark::State &state)
+{
+    initialize();
+    std::vector<std::shared_ptr<Operand>> trees;
+    for (auto &s : corpus::expressions(64, state.range(0)))
+        trees.push_back(parse_expression(s));
+    size_t bytes = 0;
+    for (auto _ : state) {
+        for (auto &t : trees) {
+            std::string text = t->str();
+            bytes += text.size();
+            benchmark::DoNotOptimize(text.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * trees.size());
+    state.SetBytesProcessed(bytes);
+}
+
+static void BM_SerializeInfix(benchmark::State &state)
+{
+    initialize();
+    std::vector<std::shared_ptr<Operand>> trees;
+    for (auto &s : corpus::expressions(64, state.range(0)))
+        trees.push_back(parse_expression(s));
+    Serializer serializer(Serializer::infix);
+    std::string text;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        for (auto &t : trees) {
+            text.clear();
+            serializer.write(*t, text);
+            bytes += text.size();
+            benchmark::DoNotOptimize(text.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * trees.size());
+    state.SetBytesProcessed(bytes);
+}
+
+BENCHMARK(BM_Str)->RangeMultiplier(4)->Range(1, 256);
+BENCHMARK(BM_SerializeInfix)->RangeMultiplier(4)->Range(1, 256);
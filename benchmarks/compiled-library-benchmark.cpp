@@ -0,0 +1,78 @@
+#include "../src/compiled-library.hh"
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/calculation-tree.hh"
+#include "../src/parsing.hh"
+
+#include "corpus.hh"
+
+using namespace infix_parsing;
+using calculation::Operand;
+
+
+/*
+ * Cold start of a service: every formula has to become evaluable and is
+ * evaluated once. The text path re-parses the sources, the compiled path
+ * maps a library written beforehand.
+ */
+
+static void initialize()
+{
+    static bool done = false;
+    if (!done) {
+        init_table();
+        done = true;
+    }
+}
+
+static std::string library_path(size_t count)
+{
+    return "/tmp/compiled-library-benchmark-" + std::to_string(count) + ".bin";
+}
+
+static void BM_ColdStartParse(benchmark::State &state)
+{
+    initialize();
+    std::vector<std::string> sources = corpus::expressions(state.range(0), 8);
+    for (auto _ : state) {
+        std::vector<std::shared_ptr<Operand>> trees;
+        trees.reserve(sources.size());
+        for (auto &s : sources)
+            trees.push_back(parse_expression(s));
+        double sum = 0;
+        for (auto &t : trees)
+            sum += t->evaluate();
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * sources.size());
+}
+
+static void BM_ColdStartMapped(benchmark::State &state)
+{
+    initialize();
+    std::vector<std::string> sources = corpus::expressions(state.range(0), 8);
+    CompiledLibraryWriter writer;
+    for (size_t i = 0; i < sources.size(); ++i)
+        writer.add("f" + std::to_string(i), parse_expression(sources[i]));
+    const std::string path = library_path(sources.size());
+    writer.save(path);
+
+    for (auto _ : state) {
+        CompiledLibrary lib(path);
+        double sum = 0;
+        for (size_t i = 0; i < lib.size(); ++i)
+            sum += lib.evaluate(i);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * sources.size());
+    std::remove(path.c_str());
+}
+
+BENCHMARK(BM_ColdStartParse)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ColdStartMapped)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,127 @@
+#pragma once
+#ifndef CORPUS_HH
+#define CORPUS_HH
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * Generators of benchmark inputs. They are seeded with fixed values, so
+ * every run measures exactly the same expressions.
+ */
+namespace corpus {
+
+const unsigned default_seed = 20211215;
+
+/*
+ * Random expression with about `operators` binary operators, using the
+ * symbols registered by infix_parsing::init_table().
+ */
+inline std::string expression(std::mt19937 &rng, size_t operators)
+{
+    static const char *const binary[] = {"+", "-", "*", "/"};
+    static const char *const unary[] = {"sin", "cos", "abs", "sqrt", "-"};
+    std::uniform_int_distribution<int> digit(1, 999);
+    std::uniform_int_distribution<int> pick(0, 15);
+
+    std::string res;
+    size_t open = 0;
+    for (size_t i = 0; i <= operators; ++i) {
+        int roll = pick(rng);
+        if (roll < 2) {
+            res += unary[pick(rng) % 5];
+            res += ' ';
+        }
+        if (roll == 2 && i < operators) {
+            res += '(';
+            ++open;
+        }
+        if (roll == 3)
+            res += "pi";
+        else
+            res += std::to_string(digit(rng)) + "." + std::to_string(digit(rng));
+        if (roll == 4 && open > 0) {
+            res += ')';
+            --open;
+        }
+        if (i < operators) {
+            res += ' ';
+            res += binary[pick(rng) % 4];
+            res += ' ';
+        }
+    }
+    res.append(open, ')');
+    return res;
+}
+
+inline std::vector<std::string> expressions(size_t count, size_t operators, unsigned seed = default_seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<std::string> res;
+    res.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        res.push_back(expression(rng, operators));
+    return res;
+}
+
+
+/*
+ * Expressions of one shape, growing with the argument. They don't need
+ * a seed, every call gives the same text.
+ */
+
+/*
+ * A single run of binary operators: "1 + 2 * 3 - 4 ..."
+ */
+inline std::string flat(size_t operators)
+{
+    static const char *const binary[] = {" + ", " * ", " - ", " / "};
+    std::string res = "1";
+    for (size_t i = 0; i < operators; ++i) {
+        res += binary[i % 4];
+        res += std::to_string(i % 9 + 1);
+    }
+    return res;
+}
+
+/*
+ * Parentheses nested `depth` deep: "(((1 + 1) + 1) + 1)"
+ */
+inline std::string nested(size_t depth)
+{
+    std::string res(depth, '(');
+    res += "1";
+    for (size_t i = 0; i < depth; ++i)
+        res += " + 1)";
+    return res;
+}
+
+/*
+ * Unary operators applied `depth` times: "abs - abs - 1"
+ */
+inline std::string unary_chain(size_t depth)
+{
+    std::string res;
+    for (size_t i = 0; i < depth; ++i)
+        res += i % 2 ? "- " : "abs ";
+    return res + "1";
+}
+
+/*
+ * A complete binary tree of the given depth, 2^depth numbers wide:
+ * "((1 + 2) * (3 - 4))"
+ */
+inline std::string balanced(size_t depth, size_t first = 1)
+{
+    if (depth == 0)
+        return std::to_string(first % 9 + 1);
+    static const char *const binary[] = {" + ", " * ", " - ", " / "};
+    const size_t half = size_t(1) << (depth - 1);
+    return "(" + balanced(depth - 1, first) + binary[depth % 4] + balanced(depth - 1, first + half) + ")";
+}
+
+}   // namespace corpus
+
+#endif  // CORPUS_HH
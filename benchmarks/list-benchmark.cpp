@@ -0,0 +1,168 @@
+#include "../src/list.hh"
+#include "../src/unrolled-list.hh"
+
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+using data_structs::List;
+using data_structs::UnrolledList;
+
+
+/*
+ * Containers are built, walked and thrown away the way the parser does it
+ * with its operand and operator lists: a few to a few thousand elements,
+ * pushed at the back and traversed front to back once or twice.
+ */
+
+template<class Container>
+static void BM_BuildAndWalk(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    for (auto _ : state) {
+        Container c;
+        for (size_t i = 0; i < count; ++i)
+            c.push_back(int(i));
+        long sum = 0;
+        for (auto &x : c)
+            sum += x;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+template<class Container>
+static void BM_Walk(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    Container c;
+    for (size_t i = 0; i < count; ++i)
+        c.push_back(int(i));
+    for (auto _ : state) {
+        long sum = 0;
+        for (auto &x : c)
+            sum += x;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+template<class Container>
+static void BM_SharedPointers(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    std::vector<std::shared_ptr<int>> values;
+    for (size_t i = 0; i < count; ++i)
+        values.push_back(std::make_shared<int>(i));
+    for (auto _ : state) {
+        Container c;
+        for (auto &v : values)
+            c.push_back(v);
+        long sum = 0;
+        for (auto &x : c)
+            sum += *x;
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+template<class Container>
+static void BM_PushPopFront(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    Container c;
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; ++i)
+            c.push_front(int(i));
+        for (size_t i = 0; i < count; ++i)
+            c.pop_front();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+/*
+ * Inserts before every element of a list, doubling it.
+ */
+template<class Container>
+static void BM_InsertEverywhere(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    for (auto _ : state) {
+        Container c;
+        for (size_t i = 0; i < count; ++i)
+            c.push_back(int(i));
+        auto it = c.begin();
+        while (it != c.end()) {
+            it = c.insert(it, -1);
+            ++it;
+            ++it;
+        }
+        benchmark::DoNotOptimize(c);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+template<class Container>
+static int &element(Container &c, size_t i)
+{
+    return c.at(i);
+}
+
+static int &element(std::list<int> &c, size_t i)
+{
+    return *std::next(c.begin(), i);
+}
+
+template<class Container>
+static void BM_RandomAt(benchmark::State &state)
+{
+    const size_t count = state.range(0);
+    Container c;
+    for (size_t i = 0; i < count; ++i)
+        c.push_back(int(i));
+    std::mt19937 random(42);
+    std::vector<size_t> indices(1024);
+    for (auto &i : indices)
+        i = random() % count;
+    for (auto _ : state) {
+        long sum = 0;
+        for (size_t i : indices)
+            sum += element(c, i);
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * indices.size());
+}
+
+BENCHMARK_TEMPLATE(BM_BuildAndWalk, List<int>)->Arg(16)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_BuildAndWalk, UnrolledList<int>)->Arg(16)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_BuildAndWalk, std::list<int>)->Arg(16)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_BuildAndWalk, std::vector<int>)->Arg(16)->Arg(1024);
+
+BENCHMARK_TEMPLATE(BM_Walk, List<int>)->Arg(1024)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Walk, UnrolledList<int>)->Arg(1024)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Walk, std::list<int>)->Arg(1024)->Arg(1 << 16);
+BENCHMARK_TEMPLATE(BM_Walk, std::vector<int>)->Arg(1024)->Arg(1 << 16);
+
+BENCHMARK_TEMPLATE(BM_SharedPointers, List<std::shared_ptr<int>>)->Arg(16)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_SharedPointers, UnrolledList<std::shared_ptr<int>>)->Arg(16)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_SharedPointers, std::list<std::shared_ptr<int>>)->Arg(16)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_SharedPointers, std::vector<std::shared_ptr<int>>)->Arg(16)->Arg(1024);
+
+BENCHMARK_TEMPLATE(BM_PushPopFront, List<int>)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_PushPopFront, UnrolledList<int>)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_PushPopFront, std::list<int>)->Arg(1024);
+
+BENCHMARK_TEMPLATE(BM_InsertEverywhere, List<int>)->Arg(1024)->Arg(1 << 14);
+BENCHMARK_TEMPLATE(BM_InsertEverywhere, UnrolledList<int>)->Arg(1024)->Arg(1 << 14);
+BENCHMARK_TEMPLATE(BM_InsertEverywhere, std::list<int>)->Arg(1024)->Arg(1 << 14);
+BENCHMARK_TEMPLATE(BM_InsertEverywhere, std::vector<int>)->Arg(1024)->Arg(1 << 14);
+
+BENCHMARK_TEMPLATE(BM_RandomAt, List<int>)->Arg(1024)->Arg(1 << 14);
+BENCHMARK_TEMPLATE(BM_RandomAt, UnrolledList<int>)->Arg(1024)->Arg(1 << 14);
+BENCHMARK_TEMPLATE(BM_RandomAt, std::list<int>)->Arg(1024)->Arg(1 << 14);
+BENCHMARK_TEMPLATE(BM_RandomAt, std::vector<int>)->Arg(1024)->Arg(1 << 14);
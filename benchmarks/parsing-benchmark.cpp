@@ -0,0 +1,136 @@
+#include "../src/parsing.hh"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/calculation-tree.hh"
+#include "../src/parsing-table.hh"
+
+#include "corpus.hh"
+
+using namespace infix_parsing;
+
+
+/*
+ * Parse throughput by the size and the shape of expressions, and the
+ * cost of the symbol table lookups the parser makes for every name.
+ */
+
+static void initialize()
+{
+    static bool done = false;
+    if (!done) {
+        init_table();
+        done = true;
+    }
+}
+
+static void parse_all(benchmark::State &state, const std::vector<std::string> &sources)
+{
+    size_t bytes = 0;
+    for (auto &s : sources)
+        bytes += s.size();
+    for (auto _ : state) {
+        for (auto &s : sources) {
+            std::shared_ptr<calculation::Operand> tree = parse_expression(s);
+            benchmark::DoNotOptimize(tree.get());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * sources.size());
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+/*
+ * Random expressions with about as many binary operators as the argument.
+ */
+static void BM_ParseRandom(benchmark::State &state)
+{
+    initialize();
+    parse_all(state, corpus::expressions(64, state.range(0)));
+}
+
+static void BM_ParseFlat(benchmark::State &state)
+{
+    initialize();
+    parse_all(state, {corpus::flat(state.range(0))});
+}
+
+static void BM_ParseNested(benchmark::State &state)
+{
+    initialize();
+    parse_all(state, {corpus::nested(state.range(0))});
+}
+
+static void BM_ParseUnaryChain(benchmark::State &state)
+{
+    initialize();
+    parse_all(state, {corpus::unary_chain(state.range(0))});
+}
+
+static void BM_ParseBalanced(benchmark::State &state)
+{
+    initialize();
+    parse_all(state, {corpus::balanced(state.range(0))});
+}
+
+BENCHMARK(BM_ParseRandom)->RangeMultiplier(4)->Range(1, 256);
+BENCHMARK(BM_ParseFlat)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK(BM_ParseNested)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK(BM_ParseUnaryChain)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK(BM_ParseBalanced)->DenseRange(2, 12, 2);
+
+
+/*
+ * A table holding the default entries and as many more constants as the
+ * argument. Constants are searched from the first registered, so the
+ * name looked up is found at the end of the list, at its beginning, or
+ * not at all after comparing every name.
+ */
+enum Lookup {
+    last,
+    first,
+    missing,
+};
+
+template <Lookup lookup>
+static void BM_SymbolLookup(benchmark::State &state)
+{
+    ParsingContext context;
+    init_table(context);
+    const size_t size = state.range(0);
+    context.update([size](SymbolTable &table) {
+        for (size_t i = 0; i < size; ++i)
+            table.register_constant("c" + std::to_string(i), double(i));
+    });
+    std::shared_ptr<const SymbolTable> table = context.snapshot();
+    const std::string name = lookup == last ? "c" + std::to_string(size - 1) : lookup == first ? "pi" : "nothing";
+    for (auto _ : state) {
+        bool found = table->is_constant(name);
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_SymbolLookup, last)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_SymbolLookup, first)->RangeMultiplier(8)->Range(8, 4096);
+BENCHMARK_TEMPLATE(BM_SymbolLookup, missing)->RangeMultiplier(8)->Range(8, 4096);
+
+/*
+ * The same through the static ParsingTable, which takes a snapshot of
+ * the global context for every call.
+ */
+static void BM_ParsingTableLookup(benchmark::State &state)
+{
+    initialize();
+    const std::string name = "sqrt";
+    for (auto _ : state) {
+        bool found = ParsingTable::is_unary_operator(name);
+        benchmark::DoNotOptimize(found);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ParsingTableLookup);
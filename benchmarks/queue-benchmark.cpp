@@ -0,0 +1,90 @@
+#include "../src/concurrent-queue.hh"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+using data_structs::BoundedQueue;
+using data_structs::ConcurrentQueue;
+
+
+/*
+ * Every thread pushes an element and pops one, so each is a producer and
+ * a consumer at once and the queue stays short. Thread counts go up to
+ * twice the number of cores.
+ */
+
+/*
+ * What the thread pool does: a std::queue behind a mutex.
+ */
+class LockedQueue {
+public:
+    void push_back(uint64_t value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push(value);
+    }
+
+    bool pop_front(uint64_t &value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.empty())
+            return false;
+        value = queue_.front();
+        queue_.pop();
+        return true;
+    }
+private:
+    std::mutex mutex_;
+    std::queue<uint64_t> queue_;
+};
+
+static std::unique_ptr<LockedQueue> locked;
+static std::unique_ptr<ConcurrentQueue<uint64_t>> unbounded;
+static std::unique_ptr<BoundedQueue<uint64_t>> bounded;
+
+static void create(LockedQueue *) { locked.reset(new LockedQueue); }
+static void create(ConcurrentQueue<uint64_t> *) { unbounded.reset(new ConcurrentQueue<uint64_t>); }
+static void create(BoundedQueue<uint64_t> *) { bounded.reset(new BoundedQueue<uint64_t>(1024)); }
+
+static LockedQueue &queue(LockedQueue *) { return *locked; }
+static ConcurrentQueue<uint64_t> &queue(ConcurrentQueue<uint64_t> *) { return *unbounded; }
+static BoundedQueue<uint64_t> &queue(BoundedQueue<uint64_t> *) { return *bounded; }
+
+template<class Queue>
+static void push(Queue &q, uint64_t value)
+{
+    q.push_back(value);
+}
+
+static void push(BoundedQueue<uint64_t> &q, uint64_t value)
+{
+    while (!q.push_back(value))
+        std::this_thread::yield();
+}
+
+template<class Queue>
+static void BM_PushPop(benchmark::State &state)
+{
+    Queue *tag = nullptr;
+    if (state.thread_index() == 0)
+        create(tag);
+    uint64_t value = state.thread_index();
+    for (auto _ : state) {
+        Queue &q = queue(tag);
+        push(q, value);
+        while (!q.pop_front(value))
+            std::this_thread::yield();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static const int max_threads = 2 * std::thread::hardware_concurrency();
+
+BENCHMARK_TEMPLATE(BM_PushPop, LockedQueue)->ThreadRange(1, max_threads)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, ConcurrentQueue<uint64_t>)->ThreadRange(1, max_threads)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_PushPop, BoundedQueue<uint64_t>)->ThreadRange(1, max_threads)->UseRealTime();
@@ -0,0 +1,132 @@
+#include "../src/scanner.hh"
+
+#include <cctype>
+#include <cstddef>
+#include <random>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "corpus.hh"
+
+using infix_parsing::Scanner;
+
+
+/*
+ * Input is tokenized the way the parser walks it: a run of spaces, then a
+ * number or an identifier run, or a single other character.
+ */
+
+struct Locale {
+    static const char *spaces(const char *p, const char *end)
+    {
+        while (p != end && std::isspace(*p))
+            ++p;
+        return p;
+    }
+    static const char *number(const char *p, const char *end)
+    {
+        while (p != end && (std::isdigit(*p) || *p == '.'))
+            ++p;
+        return p;
+    }
+    static const char *identifier(const char *p, const char *end)
+    {
+        while (p != end && (std::isalnum(*p) || *p == '_'))
+            ++p;
+        return p;
+    }
+};
+
+struct Table {
+    static const char *spaces(const char *p, const char *end) { return Scanner::skip_spaces_scalar(p, end); }
+    static const char *number(const char *p, const char *end) { return Scanner::skip_number_scalar(p, end); }
+    static const char *identifier(const char *p, const char *end) { return Scanner::skip_identifier_scalar(p, end); }
+};
+
+struct Wide {
+    static const char *spaces(const char *p, const char *end) { return Scanner::skip_spaces(p, end); }
+    static const char *number(const char *p, const char *end) { return Scanner::skip_number(p, end); }
+    static const char *identifier(const char *p, const char *end) { return Scanner::skip_identifier(p, end); }
+};
+
+template <typename Scan>
+static size_t tokenize(const std::string &text)
+{
+    const char *p = text.data(), *end = p + text.size();
+    size_t tokens = 0;
+    while (p != end) {
+        p = Scan::spaces(p, end);
+        if (p == end)
+            break;
+        const char *next = Scan::number(p, end);
+        if (next == p)
+            next = Scan::identifier(p, end);
+        p = next == p ? p + 1 : next;
+        ++tokens;
+    }
+    return tokens;
+}
+
+
+/*
+ * About 4 MB of generated expressions, the way they are written by the
+ * generator, and the same amount of machine formatted text with long
+ * indentation, long numbers and long names.
+ */
+
+static const std::string &expressions()
+{
+    static std::string text;
+    if (text.empty()) {
+        std::mt19937 rng(corpus::default_seed);
+        while (text.size() < (4 << 20))
+            text += corpus::expression(rng, 64) + "\n";
+    }
+    return text;
+}
+
+static const std::string &long_runs()
+{
+    static std::string text;
+    if (text.empty()) {
+        std::mt19937 rng(corpus::default_seed);
+        std::uniform_int_distribution<int> length(8, 64);
+        while (text.size() < (4 << 20)) {
+            text.append(length(rng), ' ');
+            text.append(length(rng), '7');
+            text += '.';
+            text.append(length(rng), '1');
+            text.append(length(rng), '\t');
+            text += "variable_";
+            text.append(length(rng), 'x');
+            text += " +\n";
+        }
+    }
+    return text;
+}
+
+template <typename Scan>
+static void BM_Expressions(benchmark::State &state)
+{
+    const std::string &text = expressions();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(tokenize<Scan>(text));
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+template <typename Scan>
+static void BM_LongRuns(benchmark::State &state)
+{
+    const std::string &text = long_runs();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(tokenize<Scan>(text));
+    state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+BENCHMARK_TEMPLATE(BM_Expressions, Locale);
+BENCHMARK_TEMPLATE(BM_Expressions, Table);
+BENCHMARK_TEMPLATE(BM_Expressions, Wide);
+BENCHMARK_TEMPLATE(BM_LongRuns, Locale);
+BENCHMARK_TEMPLATE(BM_LongRuns, Table);
+BENCHMARK_TEMPLATE(BM_LongRuns, Wide);
@@ -0,0 +1,87 @@
+#include "../src/workspace.hh"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "../src/allocation-counter.hh"
+#include "../src/calculation-tree.hh"
+#include "../src/parsing.hh"
+
+#include "corpus.hh"
+
+using namespace infix_parsing;
+using diagnostics::AllocationCounter;
+
+
+/*
+ * Parsing and evaluating one expression after another, as a calculator
+ * reading lines does. Allocations per expression are reported next to
+ * the time, the workspace is expected to make none.
+ */
+
+static void initialize()
+{
+    static bool done = false;
+    if (!done) {
+        init_table();
+        done = true;
+    }
+}
+
+static void report_allocations(benchmark::State &state, size_t allocations, size_t expressions)
+{
+    state.counters["allocs"] = benchmark::Counter(double(allocations) / expressions);
+    state.SetItemsProcessed(expressions);
+}
+
+static void BM_ParseTree(benchmark::State &state)
+{
+    initialize();
+    std::vector<std::string> sources = corpus::expressions(256, state.range(0));
+    size_t i = 0;
+    const size_t before = AllocationCounter::count();
+    for (auto _ : state) {
+        double value = parse_expression(sources[i++ % sources.size()])->evaluate();
+        benchmark::DoNotOptimize(value);
+    }
+    report_allocations(state, AllocationCounter::count() - before, state.iterations());
+}
+
+static void BM_ParseWorkspace(benchmark::State &state)
+{
+    initialize();
+    std::vector<std::string> sources = corpus::expressions(256, state.range(0));
+    Workspace workspace;
+    for (auto &s : sources)
+        workspace.evaluate(s);
+    size_t i = 0;
+    const size_t before = AllocationCounter::count();
+    for (auto _ : state) {
+        double value = workspace.evaluate(sources[i++ % sources.size()]);
+        benchmark::DoNotOptimize(value);
+    }
+    report_allocations(state, AllocationCounter::count() - before, state.iterations());
+}
+
+/*
+ * Parsed once, evaluated again and again.
+ */
+static void BM_EvaluateWorkspace(benchmark::State &state)
+{
+    initialize();
+    Workspace workspace;
+    workspace.parse(corpus::expressions(1, state.range(0))[0]);
+    const size_t before = AllocationCounter::count();
+    for (auto _ : state) {
+        double value = workspace.evaluate();
+        benchmark::DoNotOptimize(value);
+    }
+    report_allocations(state, AllocationCounter::count() - before, state.iterations());
+}
+
+BENCHMARK(BM_ParseTree)->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK(BM_ParseWorkspace)->Arg(4)->Arg(16)->Arg(64);
+BENCHMARK(BM_EvaluateWorkspace)->Arg(4)->Arg(16)->Arg(64);
@@ -0,0 +1,80 @@
+#pragma once
+#ifndef ALLOCATION_COUNTER_HH
+#define ALLOCATION_COUNTER_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/*
+ * Replaces the global operator new and delete with ones that count
+ * allocations, so tests and benchmarks can tell how many a piece of code
+ * makes. The replacements are plain definitions, the header must be
+ * included by exactly one source file of an executable, and never by a
+ * library.
+ */
+namespace diagnostics {
+
+class AllocationCounter {
+public:
+    AllocationCounter() = delete;
+    AllocationCounter(const AllocationCounter &) = delete;
+    AllocationCounter(AllocationCounter &&) = delete;
+
+    /*
+     * Allocations made by all threads since the process started.
+     */
+    static size_t count() { return counter().load(std::memory_order_relaxed); }
+
+    static void add() { counter().fetch_add(1, std::memory_order_relaxed); }
+private:
+    ~AllocationCounter() = default;
+
+    static std::atomic<size_t> &counter()
+    {
+        // Constant initialized, using it never allocates
+        static std::atomic<size_t> value(0);
+        return value;
+    }
+};
+
+}   // namespace diagnostics
+
+
+void *operator new(size_t size)
+{
+    diagnostics::AllocationCounter::add();
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    diagnostics::AllocationCounter::add();
+    return std::malloc(size ? size : 1);
+}
+
+// Blocks are taken with malloc() above, GCC only sees the new
+// expressions that get here
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    std::free(p);
+}
+
+#if defined(__GNUC__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+#endif  // ALLOCATION_COUNTER_HH
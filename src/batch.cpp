@@ -0,0 +1,245 @@
+#include "batch.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "calculation-tree.hh"
+#include "numbers.hh"
+#include "parsing.hh"
+#include "parsing-exceptions.hh"
+
+namespace io {
+
+using calculation::Numbers;
+using calculation::Operand;
+using calculation::Serializer;
+using infix_parsing::ParserError;
+
+const size_t BatchProcessor::block_size;
+const size_t ParallelBatch::default_chunk_size;
+
+
+namespace {
+
+size_t read_some(int fd, char *buffer, size_t size)
+{
+    for (;;) {
+        const ssize_t got = ::read(fd, buffer, size);
+        if (got >= 0)
+            return got;
+        if (errno != EINTR)
+            throw std::system_error(errno, std::generic_category(), "Reading expressions failed");
+    }
+}
+
+void write_all(int fd, const std::string &data)
+{
+    const char *pos = data.data();
+    const char *const end = pos + data.size();
+    while (pos < end) {
+        const ssize_t done = ::write(fd, pos, end - pos);
+        if (done < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "Writing results failed");
+        }
+        pos += done;
+    }
+}
+
+void append_number(double value, std::string &out)
+{
+    char number[Numbers::max_length];
+    out.append(number, Numbers::format(value, number));
+}
+
+}   // namespace
+
+
+BatchProcessor::BatchProcessor(Output output, const infix_parsing::ParsingContext &context)
+    : context_(context), output_(output), serializer_(Serializer::infix), lines_(0), failures_(0)
+{}
+
+
+size_t BatchProcessor::process(const char *begin, const char *end, std::string &out, size_t first_line)
+{
+    table_ = context_.snapshot();
+    size_t count = 0;
+    while (begin < end) {
+        const char *feed = static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+        process_line(begin, feed ? feed : end, out, first_line + count);
+        ++count;
+        begin = feed ? feed + 1 : end;
+    }
+    lines_ += count;
+    return count;
+}
+
+void BatchProcessor::process_line(const char *begin, const char *end, std::string &out, size_t number)
+{
+    if (begin < end && end[-1] == '\r')
+        --end;
+    if (begin == end) {
+        if (output_ != errors)
+            out += '\n';
+        return;
+    }
+
+    line_.assign(begin, end);
+    std::shared_ptr<Operand> res;
+    try {
+        res = infix_parsing::parse_expression(line_, *table_);
+    } catch (const ParserError &e) {
+        ++failures_;
+        out += "error\t";
+        append_number(number, out);
+        out += '\t';
+        append_number(e.position, out);
+        out += '\t';
+        out += e.what();
+        out += '\n';
+        return;
+    }
+
+    switch (output_) {
+    case value:
+        append_number(res->evaluate(), out);
+        out += '\n';
+        break;
+    case tree:
+        serializer_.write(*res, out);
+        out += '\t';
+        append_number(res->evaluate(), out);
+        out += '\n';
+        break;
+    case errors:
+        break;
+    }
+}
+
+
+void BatchProcessor::run(int in, int out)
+{
+    std::vector<char> input(block_size);
+    std::string output;
+    output.reserve(block_size + block_size / 4);
+    size_t end = 0;
+    size_t number = lines_ + 1;
+    bool eof = false;
+    while (!eof) {
+        // Only a line longer than the buffer gets here
+        if (end == input.size())
+            input.resize(input.size() * 2);
+        const size_t got = read_some(in, input.data() + end, input.size() - end);
+        eof = got == 0;
+        end += got;
+
+        // Whole lines only, the rest waits for the next read. What was
+        // kept from before has no line feeds, so only the new bytes are
+        // looked at.
+        size_t whole = end;
+        if (!eof) {
+            const size_t kept = end - got;
+            while (whole > kept && input[whole - 1] != '\n')
+                --whole;
+            if (whole == kept)
+                continue;
+        }
+        number += process(input.data(), input.data() + whole, output, number);
+        std::memmove(input.data(), input.data() + whole, end - whole);
+        end -= whole;
+
+        if (output.size() >= block_size || eof) {
+            write_all(out, output);
+            output.clear();
+        }
+    }
+}
+
+
+
+ParallelBatch::ParallelBatch(BatchProcessor::Output output, size_t threads, size_t chunk_size,
+                             const infix_parsing::ParsingContext &context)
+    : context_(context), output_(output), chunk_size_(chunk_size),
+      chunks_(threads * 4), lines_(0), failures_(0), pool_(threads)
+{
+    if (chunk_size == 0)
+        throw std::invalid_argument("Chunk size cannot be zero.");
+}
+
+
+void ParallelBatch::run(const char *begin, const char *end, int out)
+{
+    const size_t window = chunks_.size();
+    size_t submitted = 0;
+    size_t written = 0;
+    size_t line = lines_ + 1;
+    const char *pos = begin;
+    while (written < submitted || pos < end) {
+        while (pos < end && submitted - written < window) {
+            Chunk &chunk = chunks_[submitted % window];
+            chunk.begin = pos;
+            pos += std::min(chunk_size_, size_t(end - pos));
+            const char *feed = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+            pos = feed ? feed + 1 : end;
+            chunk.end = pos;
+
+            // Numbering the lines ahead is cheap next to evaluating them
+            chunk.first_line = line;
+            line += std::count(chunk.begin, chunk.end, '\n') + (chunk.end[-1] != '\n');
+            chunk.done = false;
+            chunk.error = nullptr;
+            pool_.submit([this, &chunk] { process(chunk); });
+            ++submitted;
+        }
+
+        Chunk &chunk = chunks_[written % window];
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            chunk_done_.wait(lock, [&chunk] { return chunk.done; });
+        }
+        if (chunk.error) {
+            pool_.wait();
+            std::rethrow_exception(chunk.error);
+        }
+        try {
+            write_all(out, chunk.out);
+        } catch (...) {
+            pool_.wait();
+            throw;
+        }
+        lines_ += chunk.lines;
+        failures_ += chunk.failures;
+        chunk.out.clear();
+        ++written;
+    }
+}
+
+void ParallelBatch::process(Chunk &chunk)
+{
+    try {
+        BatchProcessor processor(output_, context_);
+        processor.process(chunk.begin, chunk.end, chunk.out, chunk.first_line);
+        chunk.lines = processor.lines();
+        chunk.failures = processor.failures();
+    } catch (...) {
+        chunk.error = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        chunk.done = true;
+    }
+    chunk_done_.notify_all();
+}
+
+}   // namespace io
@@ -0,0 +1,140 @@
+#pragma once
+#ifndef BATCH_HH
+#define BATCH_HH
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "parsing-table.hh"
+#include "serializer.hh"
+#include "thread-pool.hh"
+
+namespace io {
+
+/*
+ * Evaluates a file of expressions, one per line, without a terminal in
+ * the way: input is read and output is written in large blocks and
+ * nothing is flushed until a block is full.
+ *
+ * A line that fails to parse doesn't stop the batch, it is reported with
+ * a record
+ *
+ *     error <TAB> line <TAB> position <TAB> message
+ *
+ * where lines are counted from 1 and positions are bytes from the start
+ * of the line, the same as the parser's. Empty lines give empty output
+ * lines, so in the value and tree outputs the n-th output line is always
+ * about the n-th input line.
+ */
+class BatchProcessor {
+public:
+    enum Output : uint8_t {
+        value,      // the value
+        tree,       // infix form of the tree <TAB> the value
+        errors,     // error records only
+    };
+
+    static const size_t block_size = 1 << 20;
+
+    explicit BatchProcessor(Output output = value,
+                            const infix_parsing::ParsingContext &context = infix_parsing::ParsingContext::global());
+    BatchProcessor(const BatchProcessor &) = delete;
+
+    /*
+     * Evaluates the lines of the range and appends the results to out.
+     * The last line doesn't need a line feed. Returns the number of
+     * lines, first_line is the number the first of them gets in error
+     * records.
+     */
+    size_t process(const char *begin, const char *end, std::string &out, size_t first_line = 1);
+
+    /*
+     * Reads the file descriptor to its end and writes the results to the
+     * other one. Errors of reading and writing are thrown as
+     * std::system_error.
+     */
+    void run(int in, int out);
+
+    size_t lines() const { return lines_; }
+    size_t failures() const { return failures_; }
+private:
+    void process_line(const char *begin, const char *end, std::string &out, size_t number);
+
+    const infix_parsing::ParsingContext &context_;
+    std::shared_ptr<const infix_parsing::SymbolTable> table_;
+    Output output_;
+    calculation::Serializer serializer_;
+
+    std::string line_;
+    size_t lines_;
+    size_t failures_;
+};
+
+
+/*
+ * Batch over a file that is already in memory, usually a MappedFile,
+ * spread across threads. The text is cut into chunks at line ends, every
+ * chunk is evaluated by a BatchProcessor of its own into a buffer of its
+ * own, and the buffers are written out in input order as soon as the
+ * chunks before them are written. Output is the same as a single
+ * BatchProcessor gives.
+ *
+ * Only a few chunks per thread are in flight at a time, so memory doesn't
+ * grow with the size of the file.
+ */
+class ParallelBatch {
+public:
+    static const size_t default_chunk_size = 4 << 20;
+
+    explicit ParallelBatch(BatchProcessor::Output output = BatchProcessor::value,
+                           size_t threads = concurrency::ThreadPool::default_size(),
+                           size_t chunk_size = default_chunk_size,
+                           const infix_parsing::ParsingContext &context = infix_parsing::ParsingContext::global());
+    ParallelBatch(const ParallelBatch &) = delete;
+
+    /*
+     * Evaluates the lines of the range and writes the results to the file
+     * descriptor. Errors of writing are thrown as std::system_error.
+     */
+    void run(const char *begin, const char *end, int out);
+
+    size_t lines() const { return lines_; }
+    size_t failures() const { return failures_; }
+private:
+    struct Chunk {
+        const char *begin;
+        const char *end;
+        size_t first_line;
+
+        std::string out;
+        size_t lines;
+        size_t failures;
+        bool done;
+        std::exception_ptr error;
+    };
+
+    void process(Chunk &chunk);
+
+    const infix_parsing::ParsingContext &context_;
+    BatchProcessor::Output output_;
+    size_t chunk_size_;
+
+    std::vector<Chunk> chunks_;
+    std::mutex mutex_;
+    std::condition_variable chunk_done_;
+
+    size_t lines_;
+    size_t failures_;
+
+    concurrency::ThreadPool pool_;
+};
+
+}   // namespace io
+
+#endif  // BATCH_HH
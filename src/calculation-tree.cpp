@@ -3,43 +3,65 @@
 #include <stdexcept>
 #include <string>
 
+#include "instrumentation.hh"
+#include "numbers.hh"
+#include "serializer.hh"
+#include "symbols.hh"
+
 namespace calculation {
 
 double Expression::evaluate() const
 {
+    INSTRUMENT_PHASE(evaluate);
     if (!root_)
         throw std::logic_error("Evaluating empty expression.");
     return root_->calculate();
 }
 
+std::string Expression::str() const
+{
+    return Serializer().str(*this);
+}
+
 
 std::string Constant::str() const
 {
-    if (name_.empty())
-        return std::to_string(value_);
-    return name_;
+    if (name_ != Symbols::none)
+        return Symbols::name(name_);
+    char buffer[Numbers::max_length];
+    return std::string(buffer, Numbers::format(value_, buffer));
 }
 
 
 double UnaryOperator::calculate() const
 {
-    if (!operator_)
+    if (!descriptor_->function)
         throw std::logic_error("Calculation of non-bind operator.");
     else if (!operand_)
         throw std::logic_error("Calculation of operator with no operand.");
-    return operator_(operand_->evaluate());
+    return descriptor_->function(operand_->evaluate());
+}
+
+std::string UnaryOperator::str() const
+{
+    return Serializer().str(*this);
 }
 
 
 double BinaryOperator::calculate() const
 {
-    if (!operator_)
+    if (!descriptor_->function)
         throw std::logic_error("Calculation of non-bind operator.");
     else if (!left_)
         throw std::logic_error("Calculation of operator with no left operand.");
     else if (!right_)
         throw std::logic_error("Calculation of operator with no right operand.");
-    return operator_(left_->evaluate(), right_->evaluate());
+    return descriptor_->function(left_->evaluate(), right_->evaluate());
+}
+
+std::string BinaryOperator::str() const
+{
+    return Serializer().str(*this);
 }
 
 }   // namespace calculation
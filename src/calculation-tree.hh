@@ -6,6 +6,8 @@
 #include <memory>
 #include <string>
 
+#include "symbols.hh"
+
 namespace calculation {
 
 
@@ -44,9 +46,9 @@ public:
 class Constant : public Operand {
 public:
     Constant() = delete;
-    Constant(double value) : value_(value) {}
+    Constant(double value) : name_(Symbols::none), value_(value) {}
     Constant(double value, const std::string &name)
-        : name_(name), value_(value)
+        : name_(Symbols::intern(name)), value_(value)
     {}
     Constant(const Constant &other)
         : name_(other.name_), value_(other.value_)
@@ -55,7 +57,36 @@ public:
 
     double evaluate() const { return value_; }
 
+    Symbols::Id name() const { return name_; }
+
+    /*
+     * Unnamed constants are printed as the shortest decimal number that
+     * reads back as the same value.
+     */
     std::string str() const;
+private:
+    Symbols::Id name_;
+    double value_;
+};
+
+
+/*
+ * Variable is an operand, which value is not known at parsetime and is
+ * set from outside of the tree. All the references to a variable in a
+ * tree share the same Variable object.
+ */
+class Variable : public Operand {
+public:
+    Variable() = delete;
+    Variable(const std::string &name, double value = 0)
+        : name_(name), value_(value)
+    {}
+
+    void set_value(double value) { value_ = value; }
+
+    double evaluate() const { return value_; }
+
+    std::string str() const { return name_; }
 private:
     std::string name_;
     double value_;
@@ -73,83 +104,133 @@ public:
      * Sets a root operator for the expression calculation tree.
      */
     void set_root(const std::shared_ptr<Operator> &op) { root_ = op; }
-    std::shared_ptr<Operator> get_root() { return root_; }
+    std::shared_ptr<Operator> get_root() const { return root_; }
 
     double evaluate() const;
 
-    std::string str() const { return root_->str(); }
+    /*
+     * Prefix notation, see Serializer for other notations.
+     */
+    std::string str() const;
 private:
     std::shared_ptr<Operator> root_;
 };
 
 
+/*
+ * Unary operator node. The name and the function live in a descriptor
+ * that is shared by every node of the same operator, so creating a node
+ * copies neither a string nor a std::function.
+ */
 class UnaryOperator : public Operator {
 public:
+    /*
+     * Immutable part of an operator, owned by the symbol table and kept
+     * alive by the nodes that refer to it.
+     */
+    struct Descriptor {
+        Descriptor(const std::string &str, std::function<double(double)> f)
+            : name(Symbols::intern(str)), function(f)
+        {}
+
+        const Symbols::Id name;
+        const std::function<double(double)> function;
+    };
 
     UnaryOperator() = delete;
-    // UnaryOperator(double (*f)(double)) : operator_(f) {}
+    explicit UnaryOperator(std::shared_ptr<const Descriptor> descriptor)
+        : descriptor_(descriptor)
+    {}
     UnaryOperator(const std::string &str, std::function<double(double)> f)
-        : operator_(f), str_(str)
+        : descriptor_(std::make_shared<const Descriptor>(str, f))
     {}
     UnaryOperator(const UnaryOperator &other)
-        : operator_(other.operator_), str_(other.str_)
+        : descriptor_(other.descriptor_)
     {}
     UnaryOperator(UnaryOperator &&other)
-        : operator_(other.operator_), str_(other.str_)
+        : descriptor_(other.descriptor_)
     {
         operand_.swap(other.operand_);
     }
 
     void set_operand(std::shared_ptr<Operand> op) { operand_ = op; }
-    std::shared_ptr<Operand> get_operand() { return operand_; }
+    std::shared_ptr<Operand> get_operand() const { return operand_; }
 
     double calculate() const;
+    /*
+     * Applies the underlying function to an already known value.
+     */
+    double apply(double arg) const { return descriptor_->function(arg); }
+    const std::function<double(double)> &function() const { return descriptor_->function; }
+    const std::shared_ptr<const Descriptor> &descriptor() const { return descriptor_; }
 
-    std::string repr() const { return str_; }
-    std::string str() const { return str_ + " " + operand_->str(); }
+    Symbols::Id name() const { return descriptor_->name; }
+
+    std::string repr() const { return Symbols::name(name()); }
+    std::string str() const;
 private:
-    std::function<double(double)> operator_;
-    std::string str_;
+    std::shared_ptr<const Descriptor> descriptor_;
     std::shared_ptr<Operand> operand_;
 };
 
 
+/*
+ * Binary operator node, see UnaryOperator on descriptors.
+ */
 class BinaryOperator : public Operator {
 public:
+    struct Descriptor {
+        Descriptor(const std::string &str, std::function<double(double, double)> f, unsigned order)
+            : name(Symbols::intern(str)), function(f), order(order)
+        {}
+
+        const Symbols::Id name;
+        const std::function<double(double, double)> function;
+        const unsigned order;
+    };
+
     BinaryOperator() = delete;
+    explicit BinaryOperator(std::shared_ptr<const Descriptor> descriptor)
+        : descriptor_(descriptor)
+    {}
     BinaryOperator(const std::string &str, std::function<double(double, double)> f, unsigned order)
-        : operator_(f), str_(str), order_(order)
+        : descriptor_(std::make_shared<const Descriptor>(str, f, order))
     {}
     BinaryOperator(const BinaryOperator &other)
-        : operator_(other.operator_), str_(other.str_), order_(other.order_)
+        : descriptor_(other.descriptor_)
     {}
     BinaryOperator(BinaryOperator &&other)
-        : operator_(other.operator_), str_(other.str_), order_(other.order_)
+        : descriptor_(other.descriptor_)
     {
         left_.swap(other.left_);
         right_.swap(other.right_);
     }
 
     void set_left(std::shared_ptr<Operand> op) { left_ = op; }
-    std::shared_ptr<Operand> get_left() { return left_; }
+    std::shared_ptr<Operand> get_left() const { return left_; }
 
     void set_right(std::shared_ptr<Operand> op) { right_ = op; }
-    std::shared_ptr<Operand> get_right() { return right_; }
+    std::shared_ptr<Operand> get_right() const { return right_; }
 
-    unsigned order() const { return order_; }
+    unsigned order() const { return descriptor_->order; }
 
-    std::string repr() const { return str_; }
-    std::string str() const { return str_ + " " + left_->str() + " " + right_->str(); }
+    Symbols::Id name() const { return descriptor_->name; }
+
+    std::string repr() const { return Symbols::name(name()); }
+    std::string str() const;
 
     double calculate() const;
+    /*
+     * Applies the underlying function to already known values.
+     */
+    double apply(double left, double right) const { return descriptor_->function(left, right); }
+    const std::function<double(double, double)> &function() const { return descriptor_->function; }
+    const std::shared_ptr<const Descriptor> &descriptor() const { return descriptor_; }
 private:
-    std::function<double(double, double)> operator_;
-    std::string str_;
+    std::shared_ptr<const Descriptor> descriptor_;
 
     std::shared_ptr<Operand> left_;
     std::shared_ptr<Operand> right_;
-
-    unsigned order_;
 };
 
 
@@ -0,0 +1,164 @@
+#include "compact-tree.hh"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "numbers.hh"
+#include "postfix-machine.hh"
+#include "symbols.hh"
+
+namespace calculation {
+
+static_assert(int(CompactTree::constant) == int(PostfixMachine::push)
+    && int(CompactTree::unary) == int(PostfixMachine::unary)
+    && int(CompactTree::binary) == int(PostfixMachine::binary),
+    "Opcodes are the machine's steps.");
+
+
+CompactTree::CompactTree(const std::shared_ptr<Operand> &tree) : max_stack_(0)
+{
+    if (!tree)
+        throw std::invalid_argument("Cannot compact an empty tree.");
+    flatten(tree);
+    opcodes_.shrink_to_fit();
+    symbols_.shrink_to_fit();
+    payloads_.shrink_to_fit();
+
+    // Operands stay on the stack until their operator is reached
+    size_t depth = 0;
+    for (auto op : opcodes_) {
+        if (op == constant)
+            ++depth;
+        else if (op == binary)
+            --depth;
+        max_stack_ = std::max(max_stack_, depth);
+    }
+}
+
+
+void CompactTree::flatten(const std::shared_ptr<Operand> &operand)
+{
+    std::shared_ptr<Expression> exp = std::dynamic_pointer_cast<Expression>(operand);
+    if (exp) {
+        if (!exp->get_root())
+            throw std::logic_error("Compacting empty expression.");
+        return flatten(exp->get_root());
+    }
+    const Constant *c = dynamic_cast<const Constant *>(operand.get());
+    if (!c)
+        throw std::invalid_argument("Only constants can be compacted.");
+    Payload payload;
+    payload.value = c->evaluate();
+    opcodes_.push_back(constant);
+    symbols_.push_back(c->name());
+    payloads_.push_back(payload);
+}
+
+void CompactTree::flatten(const std::shared_ptr<Operator> &op)
+{
+    Payload payload;
+    std::shared_ptr<UnaryOperator> u = std::dynamic_pointer_cast<UnaryOperator>(op);
+    std::shared_ptr<BinaryOperator> b = std::dynamic_pointer_cast<BinaryOperator>(op);
+    if (u) {
+        flatten(u->get_operand());
+        payload.function = unary_slot(*u);
+        opcodes_.push_back(unary);
+        symbols_.push_back(u->name());
+    } else if (b) {
+        flatten(b->get_left());
+        flatten(b->get_right());
+        payload.function = binary_slot(*b);
+        opcodes_.push_back(binary);
+        symbols_.push_back(b->name());
+    } else {
+        throw std::invalid_argument("Unknown operator cannot be compacted.");
+    }
+    payloads_.push_back(payload);
+}
+
+uint32_t CompactTree::unary_slot(const UnaryOperator &op)
+{
+    for (size_t i = 0; i < unary_.size(); ++i) {
+        if (unary_[i] == op.descriptor())
+            return i;
+    }
+    unary_.push_back(op.descriptor());
+    return unary_.size() - 1;
+}
+
+uint32_t CompactTree::binary_slot(const BinaryOperator &op)
+{
+    for (size_t i = 0; i < binary_.size(); ++i) {
+        if (binary_[i] == op.descriptor())
+            return i;
+    }
+    binary_.push_back(op.descriptor());
+    return binary_.size() - 1;
+}
+
+
+double CompactTree::evaluate() const
+{
+    return PostfixMachine::run(*this, opcodes_.size(), max_stack_);
+}
+
+
+std::string CompactTree::str() const
+{
+    // A node's subtree ends with the node, starts[i] is its first node
+    const size_t n = opcodes_.size();
+    std::vector<size_t> starts(n);
+    for (size_t i = 0; i < n; ++i) {
+        switch (opcodes_[i]) {
+        case constant:
+            starts[i] = i;
+            break;
+        case unary:
+            starts[i] = starts[i - 1];
+            break;
+        case binary:
+            starts[i] = starts[starts[i - 1] - 1];
+            break;
+        }
+    }
+
+    // Nodes are written operator first, the right operand waits below
+    // the left one
+    std::string out;
+    std::vector<size_t> pending(1, n - 1);
+    while (!pending.empty()) {
+        const size_t i = pending.back();
+        pending.pop_back();
+        if (!out.empty())
+            out += ' ';
+        if (symbols_[i] == Symbols::none) {
+            char buffer[Numbers::max_length];
+            out.append(buffer, Numbers::format(payloads_[i].value, buffer));
+        } else {
+            out += Symbols::name(symbols_[i]);
+        }
+        if (opcodes_[i] == unary) {
+            pending.push_back(i - 1);
+        } else if (opcodes_[i] == binary) {
+            pending.push_back(i - 1);
+            pending.push_back(starts[i - 1] - 1);
+        }
+    }
+    return out;
+}
+
+
+size_t CompactTree::memory() const
+{
+    return opcodes_.capacity() * sizeof(uint8_t)
+        + symbols_.capacity() * sizeof(Symbols::Id)
+        + payloads_.capacity() * sizeof(Payload)
+        + unary_.capacity() * sizeof(unary_[0])
+        + binary_.capacity() * sizeof(binary_[0]);
+}
+
+}   // namespace calculation
@@ -0,0 +1,91 @@
+#pragma once
+#ifndef COMPACT_TREE_HH
+#define COMPACT_TREE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "postfix-machine.hh"
+#include "symbols.hh"
+
+namespace calculation {
+
+/*
+ * Compact tree is an operand that keeps a whole calculation tree in three
+ * parallel arrays, one entry per node in postfix order:
+ *
+ *     opcodes   what the node is
+ *     symbols   interned name of the node, Symbols::none for numbers
+ *     payloads  constant's value or operator's function slot
+ *
+ * A node takes 13 bytes, names are rebuilt from the intern table and
+ * every distinct operator descriptor is referred to once per tree. The
+ * arrays are evaluated by PostfixMachine.
+ */
+class CompactTree : public Operand {
+public:
+    enum Opcode : uint8_t {
+        constant = 0,
+        unary = 1,
+        binary = 2,
+    };
+
+    union Payload {
+        double value;
+        uint32_t function;
+    };
+
+    CompactTree() = delete;
+    /*
+     * Flattens the tree. Only constants, unary and binary operators are
+     * supported, variables are rejected.
+     */
+    explicit CompactTree(const std::shared_ptr<Operand> &tree);
+
+    double evaluate() const;
+
+    /*
+     * Prefix notation, the same as the source tree's str().
+     */
+    std::string str() const;
+
+    size_t size() const { return opcodes_.size(); }
+    /*
+     * Bytes taken by the nodes and the function slots.
+     */
+    size_t memory() const;
+
+    Opcode opcode(size_t i) const { return Opcode(opcodes_.at(i)); }
+    Symbols::Id symbol(size_t i) const { return symbols_.at(i); }
+    Payload payload(size_t i) const { return payloads_.at(i); }
+private:
+    friend class PostfixMachine;
+
+    PostfixMachine::Step step(size_t i) const { return PostfixMachine::Step(opcodes_[i]); }
+    double value(size_t i) const { return payloads_[i].value; }
+    double apply(size_t i, double x) const { return unary_[payloads_[i].function]->function(x); }
+    double apply(size_t i, double x, double y) const { return binary_[payloads_[i].function]->function(x, y); }
+
+    void flatten(const std::shared_ptr<Operand> &operand);
+    void flatten(const std::shared_ptr<Operator> &op);
+
+    uint32_t unary_slot(const UnaryOperator &op);
+    uint32_t binary_slot(const BinaryOperator &op);
+
+    std::vector<uint8_t> opcodes_;
+    std::vector<Symbols::Id> symbols_;
+    std::vector<Payload> payloads_;
+
+    std::vector<std::shared_ptr<const UnaryOperator::Descriptor>> unary_;
+    std::vector<std::shared_ptr<const BinaryOperator::Descriptor>> binary_;
+
+    size_t max_stack_;
+};
+
+}   // namespace calculation
+
+#endif  // COMPACT_TREE_HH
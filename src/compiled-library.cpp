@@ -0,0 +1,297 @@
+#include "compiled-library.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "mapped-file.hh"
+#include "parsing-table.hh"
+#include "postfix-machine.hh"
+
+namespace infix_parsing {
+
+using calculation::Operand;
+using calculation::Constant;
+using calculation::Variable;
+using calculation::Expression;
+
+using calculation::Operator;
+using calculation::UnaryOperator;
+using calculation::BinaryOperator;
+
+using namespace compiled;
+
+namespace {
+
+static_assert(int(push_constant) == int(calculation::PostfixMachine::push)
+    && int(apply_unary) == int(calculation::PostfixMachine::unary)
+    && int(apply_binary) == int(calculation::PostfixMachine::binary),
+    "Opcodes are the machine's steps.");
+
+/*
+ * Nodes of one expression in the image, with the bound symbols.
+ */
+struct EntryProgram {
+    const Node *nodes;
+    const double *constants;
+    const std::shared_ptr<const UnaryOperator::Descriptor> *unary;
+    const std::shared_ptr<const BinaryOperator::Descriptor> *binary;
+
+    calculation::PostfixMachine::Step step(size_t i) const
+    {
+        return calculation::PostfixMachine::Step(nodes[i].opcode);
+    }
+
+    double value(size_t i) const { return constants[nodes[i].arg]; }
+    double apply(size_t i, double x) const { return unary[nodes[i].arg]->function(x); }
+    double apply(size_t i, double x, double y) const { return binary[nodes[i].arg]->function(x, y); }
+};
+
+}   // namespace
+
+
+void CompiledLibraryWriter::add(const std::string &name, const std::shared_ptr<Operand> &tree)
+{
+    if (!tree)
+        throw std::invalid_argument("Cannot compile an empty tree.");
+    Entry entry = {};
+    entry.name_length = name.length();
+    entry.name_offset = add_string(name);
+    entry.first_node = nodes_.size();
+    entry.max_stack = flatten(tree);
+    entry.node_count = nodes_.size() - entry.first_node;
+    entries_.push_back(entry);
+}
+
+uint32_t CompiledLibraryWriter::flatten(const std::shared_ptr<Operand> &operand)
+{
+    std::shared_ptr<Expression> exp = std::dynamic_pointer_cast<Expression>(operand);
+    if (exp) {
+        if (!exp->get_root())
+            throw std::logic_error("Compiling empty expression.");
+        return flatten(exp->get_root());
+    }
+    if (dynamic_cast<const Variable *>(operand.get()))
+        throw std::invalid_argument("Variables cannot be compiled.");
+    if (!dynamic_cast<const Constant *>(operand.get()))
+        throw std::invalid_argument("Unknown operand cannot be compiled.");
+    Node node = {};
+    node.opcode = push_constant;
+    node.arg = constants_.size();
+    constants_.push_back(operand->evaluate());
+    nodes_.push_back(node);
+    return 1;
+}
+
+uint32_t CompiledLibraryWriter::flatten(const std::shared_ptr<Operator> &op)
+{
+    Node node = {};
+    uint32_t depth;
+    std::shared_ptr<UnaryOperator> unary = std::dynamic_pointer_cast<UnaryOperator>(op);
+    std::shared_ptr<BinaryOperator> binary = std::dynamic_pointer_cast<BinaryOperator>(op);
+    if (unary) {
+        depth = flatten(unary->get_operand());
+        node.opcode = apply_unary;
+        node.arg = add_symbol(unary->repr(), unary_symbol);
+    } else if (binary) {
+        uint32_t left = flatten(binary->get_left());
+        uint32_t right = flatten(binary->get_right());
+        depth = std::max(left, right + 1);
+        node.opcode = apply_binary;
+        node.arg = add_symbol(binary->repr(), binary_symbol);
+    } else {
+        throw std::invalid_argument("Unknown operator cannot be compiled.");
+    }
+    nodes_.push_back(node);
+    return depth;
+}
+
+uint32_t CompiledLibraryWriter::add_string(const std::string &str)
+{
+    uint32_t offset = strings_.size();
+    strings_ += str;
+    return offset;
+}
+
+uint32_t CompiledLibraryWriter::add_symbol(const std::string &name, SymbolKind kind)
+{
+    std::pair<uint32_t, std::string> key(kind, name);
+    auto it = symbol_index_.find(key);
+    if (it != symbol_index_.end())
+        return it->second;
+    Symbol symbol = {};
+    symbol.name_length = name.length();
+    symbol.name_offset = add_string(name);
+    symbol.kind = kind;
+    symbols_.push_back(symbol);
+    symbol_index_.emplace(key, symbols_.size() - 1);
+    return symbols_.size() - 1;
+}
+
+
+void CompiledLibraryWriter::write(std::ostream &out) const
+{
+    Header header = {};
+    header.magic = magic;
+    header.version = version;
+    header.expression_count = entries_.size();
+    header.node_count = nodes_.size();
+    header.constant_count = constants_.size();
+    header.symbol_count = symbols_.size();
+    header.string_size = strings_.size();
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(entries_.data()), entries_.size() * sizeof(Entry));
+    out.write(reinterpret_cast<const char *>(nodes_.data()), nodes_.size() * sizeof(Node));
+    out.write(reinterpret_cast<const char *>(constants_.data()), constants_.size() * sizeof(double));
+    out.write(reinterpret_cast<const char *>(symbols_.data()), symbols_.size() * sizeof(Symbol));
+    out.write(strings_.data(), strings_.size());
+    if (!out)
+        throw std::runtime_error("Failed to write compiled library.");
+}
+
+void CompiledLibraryWriter::save(const std::string &path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        throw std::runtime_error("Cannot open \"" + path + "\" for writing.");
+    write(out);
+}
+
+
+CompiledLibrary::CompiledLibrary(const void *data, size_t size, const ParsingContext &context)
+{
+    bind(data, size, *context.snapshot());
+}
+
+CompiledLibrary::CompiledLibrary(const std::string &path, const ParsingContext &context)
+    : file_(new io::MappedFile(path))
+{
+    bind(file_->data(), file_->size(), *context.snapshot());
+}
+
+
+void CompiledLibrary::bind(const void *data, size_t size, const SymbolTable &table)
+{
+    const char *base = static_cast<const char *>(data);
+    if (reinterpret_cast<uintptr_t>(base) % alignof(double) != 0)
+        throw FormatError("image is not aligned.");
+    if (size < sizeof(Header))
+        throw FormatError("image is too small.");
+    header_ = reinterpret_cast<const Header *>(base);
+    if (header_->magic != magic)
+        throw FormatError("wrong magic number.");
+    if (header_->version != version)
+        throw FormatError("unsupported version " + std::to_string(header_->version) + ".");
+
+    // Sections are computed in 64 bits, so no count can overflow them
+    uint64_t offset = sizeof(Header);
+    const uint64_t entries_offset = offset;
+    offset += uint64_t(header_->expression_count) * sizeof(Entry);
+    const uint64_t nodes_offset = offset;
+    offset += uint64_t(header_->node_count) * sizeof(Node);
+    const uint64_t constants_offset = offset;
+    offset += uint64_t(header_->constant_count) * sizeof(double);
+    const uint64_t symbols_offset = offset;
+    offset += uint64_t(header_->symbol_count) * sizeof(Symbol);
+    const uint64_t strings_offset = offset;
+    offset += header_->string_size;
+    if (offset > size)
+        throw FormatError("image is truncated.");
+
+    entries_ = reinterpret_cast<const Entry *>(base + entries_offset);
+    nodes_ = reinterpret_cast<const Node *>(base + nodes_offset);
+    constants_ = reinterpret_cast<const double *>(base + constants_offset);
+    symbols_ = reinterpret_cast<const Symbol *>(base + symbols_offset);
+    strings_ = base + strings_offset;
+
+    unary_.assign(header_->symbol_count, nullptr);
+    binary_.assign(header_->symbol_count, nullptr);
+    for (uint32_t i = 0; i < header_->symbol_count; ++i) {
+        const Symbol &symbol = symbols_[i];
+        if (uint64_t(symbol.name_offset) + symbol.name_length > header_->string_size)
+            throw FormatError("symbol name is out of range.");
+        std::string name(strings_ + symbol.name_offset, symbol.name_length);
+        if (symbol.kind == unary_symbol)
+            unary_[i] = table.get_unary_descriptor(name);
+        else if (symbol.kind == binary_symbol)
+            binary_[i] = table.get_binary_descriptor(name);
+        else
+            throw FormatError("unknown symbol kind.");
+    }
+
+    /*
+     * Every expression is run through once on the stack depth only, so
+     * evaluate() doesn't have to check anything.
+     */
+    for (uint32_t i = 0; i < header_->expression_count; ++i) {
+        const Entry &entry = entries_[i];
+        if (uint64_t(entry.name_offset) + entry.name_length > header_->string_size)
+            throw FormatError("expression name is out of range.");
+        if (entry.node_count == 0
+            || uint64_t(entry.first_node) + entry.node_count > header_->node_count)
+            throw FormatError("expression nodes are out of range.");
+        uint32_t depth = 0;
+        uint32_t max_depth = 0;
+        for (uint32_t j = 0; j < entry.node_count; ++j) {
+            const Node &node = nodes_[entry.first_node + j];
+            switch (node.opcode) {
+            case push_constant:
+                if (node.arg >= header_->constant_count)
+                    throw FormatError("constant is out of range.");
+                ++depth;
+                break;
+            case apply_unary:
+                if (node.arg >= header_->symbol_count || !unary_[node.arg] || depth < 1)
+                    throw FormatError("invalid unary operator.");
+                break;
+            case apply_binary:
+                if (node.arg >= header_->symbol_count || !binary_[node.arg] || depth < 2)
+                    throw FormatError("invalid binary operator.");
+                --depth;
+                break;
+            default:
+                throw FormatError("unknown opcode.");
+            }
+            max_depth = std::max(max_depth, depth);
+        }
+        if (depth != 1 || max_depth > entry.max_stack)
+            throw FormatError("unbalanced expression.");
+    }
+}
+
+
+std::string CompiledLibrary::name(size_t i) const
+{
+    if (i >= size())
+        throw std::out_of_range("Index out of range.");
+    return std::string(strings_ + entries_[i].name_offset, entries_[i].name_length);
+}
+
+size_t CompiledLibrary::find(const std::string &name) const
+{
+    for (size_t i = 0; i < size(); ++i) {
+        const Entry &entry = entries_[i];
+        if (entry.name_length == name.length()
+            && std::memcmp(strings_ + entry.name_offset, name.data(), name.length()) == 0)
+            return i;
+    }
+    throw ParsingTable::NameSearchError(name);
+}
+
+
+double CompiledLibrary::evaluate(size_t i) const
+{
+    if (i >= size())
+        throw std::out_of_range("Index out of range.");
+    const Entry &entry = entries_[i];
+    const EntryProgram program = {nodes_ + entry.first_node, constants_, unary_.data(), binary_.data()};
+    return calculation::PostfixMachine::run(program, entry.node_count, entry.max_stack);
+}
+
+}   // namespace infix_parsing
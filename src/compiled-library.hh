@@ -0,0 +1,176 @@
+#pragma once
+#ifndef COMPILED_LIBRARY_HH
+#define COMPILED_LIBRARY_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "mapped-file.hh"
+#include "parsing-table.hh"
+
+namespace infix_parsing {
+
+/*
+ * Compiled library is a flat binary image of named expressions. Each
+ * expression is stored as a postfix sequence of nodes, which refer to
+ * constants and symbols by index, so the image can be mapped anywhere
+ * and evaluated in place.
+ *
+ * Layout (native byte order, every section is 8-byte aligned):
+ *
+ *     Header
+ *     Entry    entries[expression_count]
+ *     Node     nodes[node_count]
+ *     double   constants[constant_count]
+ *     Symbol   symbols[symbol_count]
+ *     char     strings[string_size]
+ *
+ * Symbols are kept by name and bound to a parsing context's table on load.
+ */
+namespace compiled {
+
+const uint32_t magic = 0x58534441;     // "ADSX" in little endian
+const uint32_t version = 1;
+
+enum Opcode : uint8_t {
+    push_constant = 0,
+    apply_unary = 1,
+    apply_binary = 2,
+};
+
+enum SymbolKind : uint32_t {
+    unary_symbol = 0,
+    binary_symbol = 1,
+};
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t expression_count;
+    uint32_t node_count;
+    uint32_t constant_count;
+    uint32_t symbol_count;
+    uint32_t string_size;
+    uint32_t reserved;
+};
+
+struct Entry {
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t first_node;
+    uint32_t node_count;
+    uint32_t max_stack;
+    uint32_t reserved;
+};
+
+struct Node {
+    uint8_t opcode;
+    uint8_t reserved[3];
+    uint32_t arg;
+};
+
+struct Symbol {
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t kind;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 32, "Header layout must be fixed.");
+static_assert(sizeof(Entry) == 24, "Entry layout must be fixed.");
+static_assert(sizeof(Node) == 8, "Node layout must be fixed.");
+static_assert(sizeof(Symbol) == 16, "Symbol layout must be fixed.");
+
+
+class FormatError : public std::runtime_error {
+public:
+    FormatError(const std::string &about)
+        : runtime_error("Malformed compiled library: " + about)
+    {}
+};
+
+}   // namespace compiled
+
+
+/*
+ * Collects parsed expressions and writes them as a compiled library.
+ */
+class CompiledLibraryWriter {
+public:
+    CompiledLibraryWriter() = default;
+
+    /*
+     * Flattens the tree. Only constants, unary and binary operators can
+     * be compiled, variables are rejected.
+     */
+    void add(const std::string &name, const std::shared_ptr<calculation::Operand> &tree);
+
+    void write(std::ostream &out) const;
+    void save(const std::string &path) const;
+private:
+    uint32_t flatten(const std::shared_ptr<calculation::Operand> &operand);
+    uint32_t flatten(const std::shared_ptr<calculation::Operator> &op);
+    uint32_t add_string(const std::string &str);
+    uint32_t add_symbol(const std::string &name, compiled::SymbolKind kind);
+
+    std::vector<compiled::Entry> entries_;
+    std::vector<compiled::Node> nodes_;
+    std::vector<double> constants_;
+    std::vector<compiled::Symbol> symbols_;
+    std::string strings_;
+
+    std::map<std::pair<uint32_t, std::string>, uint32_t> symbol_index_;
+};
+
+
+/*
+ * Read-only view of a compiled library. The image is validated and its
+ * symbols are bound once, after that evaluation works on the image
+ * directly without any allocations.
+ */
+class CompiledLibrary {
+public:
+    CompiledLibrary() = delete;
+    /*
+     * Uses the image in place, it has to outlive the library.
+     */
+    CompiledLibrary(const void *data, size_t size, const ParsingContext &context = ParsingContext::global());
+    /*
+     * Maps the file into memory.
+     */
+    explicit CompiledLibrary(const std::string &path, const ParsingContext &context = ParsingContext::global());
+    CompiledLibrary(const CompiledLibrary &) = delete;
+    CompiledLibrary(CompiledLibrary &&) = default;
+
+    size_t size() const { return header_->expression_count; }
+
+    std::string name(size_t i) const;
+    size_t find(const std::string &name) const;
+
+    double evaluate(size_t i) const;
+private:
+    void bind(const void *data, size_t size, const SymbolTable &table);
+
+    std::unique_ptr<io::MappedFile> file_;
+
+    const compiled::Header *header_;
+    const compiled::Entry *entries_;
+    const compiled::Node *nodes_;
+    const double *constants_;
+    const compiled::Symbol *symbols_;
+    const char *strings_;
+
+    std::vector<std::shared_ptr<const calculation::UnaryOperator::Descriptor>> unary_;
+    std::vector<std::shared_ptr<const calculation::BinaryOperator::Descriptor>> binary_;
+};
+
+}   // namespace infix_parsing
+
+#endif  // COMPILED_LIBRARY_HH
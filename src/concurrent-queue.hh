@@ -0,0 +1,310 @@
+#pragma once
+#ifndef CONCURRENT_QUEUE_HH
+#define CONCURRENT_QUEUE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "hazard-pointers.hh"
+
+namespace data_structs {
+
+/*
+ * Unbounded first-in first-out queue that any number of threads push to
+ * and pop from at once without locks, after Michael and Scott. The list
+ * always starts with a dummy node, the first element is the one after
+ * it. Popping moves the element out and makes its node the new dummy,
+ * the old dummy is retired to HazardPointers.
+ *
+ * Nodes come from the global allocator rather than a NodePool: they're
+ * mostly freed by consumer threads, so a per-thread pool would only
+ * fill up on one side and run dry on the other.
+ *
+ * Pushing and popping follow the names of List, but there's no
+ * iteration: the contents may change under any iterator.
+ */
+template<class T>
+class ConcurrentQueue {
+public:
+    ConcurrentQueue();
+    ConcurrentQueue(const ConcurrentQueue &) = delete;
+
+    /*
+     * Must not race with any other call.
+     */
+    ~ConcurrentQueue();
+
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+    template<class... Args>
+    void emplace_back(Args &&...args);
+    /*
+     * Moves the first element out, returns false if there's none.
+     */
+    bool pop_front(T &value);
+
+    /*
+     * Only a snapshot, other threads may change it right away.
+     */
+    bool empty() const;
+private:
+    struct Node {
+        std::atomic<Node *> next;
+        bool has_value;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T *value() { return reinterpret_cast<T *>(&storage); }
+    };
+
+    static Node *create_node();
+    static void destroy_node(void *node);
+
+    // Pushers and poppers don't share a cache line. Padding rather than
+    // alignas(), the queue may be allocated with new
+    std::atomic<Node *> head_;
+    char padding_[64];
+    std::atomic<Node *> tail_;
+};
+
+
+template<class T>
+typename ConcurrentQueue<T>::Node *ConcurrentQueue<T>::create_node()
+{
+    Node *node = static_cast<Node *>(::operator new(sizeof(Node)));
+    new (&node->next) std::atomic<Node *>(nullptr);
+    node->has_value = false;
+    return node;
+}
+
+template<class T>
+void ConcurrentQueue<T>::destroy_node(void *p)
+{
+    Node *node = static_cast<Node *>(p);
+    if (node->has_value)
+        node->value()->~T();
+    ::operator delete(node);
+}
+
+
+template<class T>
+ConcurrentQueue<T>::ConcurrentQueue()
+{
+    Node *dummy = create_node();
+    head_.store(dummy, std::memory_order_relaxed);
+    tail_.store(dummy, std::memory_order_relaxed);
+}
+
+template<class T>
+ConcurrentQueue<T>::~ConcurrentQueue()
+{
+    Node *node = head_.load(std::memory_order_relaxed);
+    while (node) {
+        Node *next = node->next.load(std::memory_order_relaxed);
+        destroy_node(node);
+        node = next;
+    }
+}
+
+
+template<class T>
+template<class... Args>
+void ConcurrentQueue<T>::emplace_back(Args &&...args)
+{
+    Node *node = create_node();
+    try {
+        new (&node->storage) T(std::forward<Args>(args)...);
+    } catch (...) {
+        destroy_node(node);
+        throw;
+    }
+    node->has_value = true;
+
+    for (;;) {
+        Node *tail = HazardPointers::protect(0, tail_);
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (tail != tail_.load(std::memory_order_acquire))
+            continue;
+        if (next) {
+            // Another push linked its node but didn't move the tail yet
+            tail_.compare_exchange_weak(tail, next, std::memory_order_release, std::memory_order_relaxed);
+            continue;
+        }
+        if (tail->next.compare_exchange_weak(next, node, std::memory_order_release, std::memory_order_relaxed)) {
+            tail_.compare_exchange_strong(tail, node, std::memory_order_release, std::memory_order_relaxed);
+            break;
+        }
+    }
+    HazardPointers::clear(0);
+}
+
+template<class T>
+bool ConcurrentQueue<T>::pop_front(T &value)
+{
+    for (;;) {
+        Node *head = HazardPointers::protect(0, head_);
+        Node *tail = tail_.load(std::memory_order_acquire);
+        Node *next = HazardPointers::protect(1, head->next);
+        if (head != head_.load(std::memory_order_acquire))
+            continue;
+        if (!next) {
+            HazardPointers::clear(0);
+            HazardPointers::clear(1);
+            return false;
+        }
+        if (head == tail) {
+            // The tail lags behind, help the push that left it there
+            tail_.compare_exchange_weak(tail, next, std::memory_order_release, std::memory_order_relaxed);
+            continue;
+        }
+        if (head_.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            // Winning the exchange gives the element of next to this
+            // thread, the slot keeps next alive while it's moved out
+            value = std::move(*next->value());
+            HazardPointers::clear(0);
+            HazardPointers::clear(1);
+            HazardPointers::retire(head, &destroy_node);
+            return true;
+        }
+    }
+}
+
+template<class T>
+bool ConcurrentQueue<T>::empty() const
+{
+    Node *head = HazardPointers::protect(0, head_);
+    const bool res = head->next.load(std::memory_order_acquire) == nullptr;
+    HazardPointers::clear(0);
+    return res;
+}
+
+
+/*
+ * Fixed capacity first-in first-out queue for any number of producers
+ * and consumers, after Vyukov. Every cell carries a sequence number that
+ * tells whose turn it is: the producer of round r waits for r * capacity
+ * plus the cell's index, its consumer for one more. Producers and
+ * consumers only contend on their own counter, and nothing is allocated
+ * after construction.
+ */
+template<class T>
+class BoundedQueue {
+    static_assert(std::is_nothrow_move_constructible<T>::value, "Elements must be moved without exceptions.");
+public:
+    /*
+     * Capacity must be a power of two.
+     */
+    explicit BoundedQueue(size_t capacity);
+    BoundedQueue(const BoundedQueue &) = delete;
+
+    ~BoundedQueue();
+
+    /*
+     * Return false if the queue is full. It's also full while the cell
+     * to take is still being popped from by a consumer a lap behind.
+     */
+    bool push_back(const T &value) { return emplace_back(value); }
+    bool push_back(T &&value) { return emplace_back(std::move(value)); }
+    template<class... Args>
+    bool emplace_back(Args &&...args);
+    /*
+     * Moves the first element out, returns false if there's none.
+     */
+    bool pop_front(T &value);
+
+    size_t capacity() const { return mask_ + 1; }
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        T *value() { return reinterpret_cast<T *>(&storage); }
+    };
+
+    Cell *cells_;
+    const size_t mask_;
+
+    char padding_[64];
+    std::atomic<size_t> tail_;
+    char padding_between_[64];
+    std::atomic<size_t> head_;
+};
+
+
+template<class T>
+BoundedQueue<T>::BoundedQueue(size_t capacity)
+    : cells_(nullptr), mask_(capacity - 1), tail_(0), head_(0)
+{
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+        throw std::invalid_argument("Queue capacity must be a power of two.");
+    cells_ = static_cast<Cell *>(::operator new(capacity * sizeof(Cell)));
+    for (size_t i = 0; i < capacity; ++i)
+        new (&cells_[i].sequence) std::atomic<size_t>(i);
+}
+
+template<class T>
+BoundedQueue<T>::~BoundedQueue()
+{
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    for (size_t pos = head_.load(std::memory_order_relaxed); pos != tail; ++pos)
+        cells_[pos & mask_].value()->~T();
+    ::operator delete(cells_);
+}
+
+
+template<class T>
+template<class... Args>
+bool BoundedQueue<T>::emplace_back(Args &&...args)
+{
+    // Built before a cell is taken, a taken cell can't be given back
+    T value(std::forward<Args>(args)...);
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+        cell = &cells_[pos & mask_];
+        const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const ptrdiff_t diff = ptrdiff_t(sequence) - ptrdiff_t(pos);
+        if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+    new (&cell->storage) T(std::move(value));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T>
+bool BoundedQueue<T>::pop_front(T &value)
+{
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+        cell = &cells_[pos & mask_];
+        const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const ptrdiff_t diff = ptrdiff_t(sequence) - ptrdiff_t(pos + 1);
+        if (diff == 0) {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+    value = std::move(*cell->value());
+    cell->value()->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+}
+
+}   // namespace data_structs
+
+#endif  // CONCURRENT_QUEUE_HH
@@ -0,0 +1,159 @@
+#include "expression-library.hh"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "mapped-file.hh"
+#include "parsing.hh"
+#include "parsing-exceptions.hh"
+#include "parsing-table.hh"
+#include "scanner.hh"
+
+namespace infix_parsing {
+
+using calculation::Operand;
+
+namespace {
+
+bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+}   // namespace
+
+
+void ExpressionLibrary::index()
+{
+    size_t line = 0;
+    size_t begin = 0;
+    while (begin < size_) {
+        ++line;
+        size_t end = begin;
+        while (end < size_ && data_[end] != '\n')
+            ++end;
+        size_t pos = begin;
+        while (pos < end && is_blank(data_[pos]))
+            ++pos;
+        if (pos == end || data_[pos] == '#') {
+            begin = end + 1;
+            continue;
+        }
+
+        size_t colon = pos;
+        while (colon < end && data_[colon] != ':')
+            ++colon;
+        if (colon == end)
+            throw EntryError("", "Entry name must be followed by ':'.", pos, line, pos - begin + 1);
+        size_t name_end = colon;
+        while (name_end > pos && is_blank(data_[name_end - 1]))
+            --name_end;
+        std::string name(data_ + pos, name_end - pos);
+        if (!ParsingTable::is_valid_name(name))
+            throw EntryError(name, "Invalid entry name.", pos, line, pos - begin + 1);
+        if (!names_.emplace(name, entries_.size()).second)
+            throw EntryError(name, "Name is already defined.", pos, line, pos - begin + 1);
+
+        entries_.emplace_back();
+        Entry &entry = entries_.back();
+        entry.name = name;
+        entry.offset = colon + 1;
+        entry.length = end - colon - 1;
+        entry.line = line;
+        entry.line_start = begin;
+        begin = end + 1;
+    }
+}
+
+
+size_t ExpressionLibrary::find(const std::string &name) const
+{
+    auto it = names_.find(name);
+    if (it == names_.end())
+        throw ParsingTable::NameSearchError(name);
+    return it->second;
+}
+
+
+std::shared_ptr<Operand> ExpressionLibrary::get(size_t i)
+{
+    Entry &entry = entries_.at(i);
+    std::call_once(entry.once, [&] {
+        std::string text(data_ + entry.offset, entry.length);
+        try {
+            if (std::all_of(text.begin(), text.end(), Scanner::is_space))
+                throw OperandExpectationUnsatisfied(text.length());
+            entry.expression = parse_expression(text, *context_.snapshot());
+        } catch (const ParserError &e) {
+            size_t pos = entry.offset + e.position;
+            throw EntryError(entry.name, e.what(), pos, entry.line, pos - entry.line_start + 1);
+        }
+        entry.parsed.store(true);
+    });
+    return entry.expression;
+}
+
+size_t ExpressionLibrary::parsed_count() const
+{
+    size_t res = 0;
+    for (auto &entry : entries_)
+        res += entry.parsed.load();
+    return res;
+}
+
+
+std::vector<ExpressionLibrary::EntryError> ExpressionLibrary::parse_all(concurrency::ThreadPool &pool)
+{
+    std::vector<EntryError> errors;
+    std::mutex errors_mutex;
+
+    // A few chunks per thread, so the ones with long expressions even out
+    const size_t n = entries_.size();
+    const size_t chunk = std::max<size_t>(1, n / (pool.size() * 8));
+    for (size_t from = 0; from < n; from += chunk) {
+        const size_t to = std::min(n, from + chunk);
+        pool.submit([this, from, to, &errors, &errors_mutex] {
+            for (size_t i = from; i < to; ++i) {
+                try {
+                    get(i);
+                } catch (const EntryError &e) {
+                    std::lock_guard<std::mutex> lock(errors_mutex);
+                    errors.push_back(e);
+                }
+            }
+        });
+    }
+    pool.wait();
+
+    std::sort(errors.begin(), errors.end(), [](const EntryError &a, const EntryError &b) {
+        return a.position < b.position;
+    });
+    return errors;
+}
+
+
+std::shared_ptr<ExpressionLibrary> open_library(const std::string &path, const ParsingContext &context)
+{
+    std::shared_ptr<ExpressionLibrary> res(new ExpressionLibrary(context));
+    res->file_.reset(new io::MappedFile(path));
+    res->data_ = res->file_->data();
+    res->size_ = res->file_->size();
+    res->index();
+    return res;
+}
+
+std::shared_ptr<ExpressionLibrary> index_library(const std::string &text, const ParsingContext &context)
+{
+    std::shared_ptr<ExpressionLibrary> res(new ExpressionLibrary(context));
+    res->text_ = text;
+    res->data_ = res->text_.data();
+    res->size_ = res->text_.size();
+    res->index();
+    return res;
+}
+
+}   // namespace infix_parsing
@@ -0,0 +1,129 @@
+#pragma once
+#ifndef EXPRESSION_LIBRARY_HH
+#define EXPRESSION_LIBRARY_HH
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "mapped-file.hh"
+#include "parsing-exceptions.hh"
+#include "parsing-table.hh"
+#include "thread-pool.hh"
+
+namespace infix_parsing {
+
+/*
+ * Expression library is a text of named expressions, one per line:
+ *
+ *     # comment
+ *     area: pi * 2 ^ 2
+ *     half: 1 / 2
+ *
+ * Loading a library only indexes the names, each expression is parsed
+ * on its first use. Blank lines and lines starting with '#' are skipped.
+ *
+ * Entries are parsed with the context's table at the time of their first
+ * use, the context has to outlive the library.
+ */
+class ExpressionLibrary {
+public:
+    class EntryError;
+
+    ExpressionLibrary(const ExpressionLibrary &) = delete;
+    ExpressionLibrary(ExpressionLibrary &&) = delete;
+
+    size_t size() const { return entries_.size(); }
+
+    const std::string &name(size_t i) const { return entries_.at(i).name; }
+    size_t find(const std::string &name) const;
+
+    /*
+     * Returns the parsed expression, parsing it if it's the first use.
+     * Safe to call from many threads, an entry is parsed only once.
+     */
+    std::shared_ptr<calculation::Operand> get(size_t i);
+    std::shared_ptr<calculation::Operand> get(const std::string &name) { return get(find(name)); }
+
+    bool is_parsed(size_t i) const { return entries_.at(i).parsed.load(); }
+    size_t parsed_count() const;
+
+    /*
+     * Eagerly parses every entry on the pool. Errors don't stop parsing
+     * of the other entries, they are all returned ordered by line.
+     */
+    std::vector<EntryError> parse_all(concurrency::ThreadPool &pool);
+
+    friend std::shared_ptr<ExpressionLibrary> open_library(const std::string &path, const ParsingContext &context);
+    friend std::shared_ptr<ExpressionLibrary> index_library(const std::string &text, const ParsingContext &context);
+private:
+    struct Entry {
+        Entry() : offset(0), length(0), line(0), line_start(0), parsed(false) {}
+
+        std::string name;
+        // Expression text bounds in the library
+        size_t offset;
+        size_t length;
+        size_t line;
+        size_t line_start;
+
+        std::once_flag once;
+        std::atomic<bool> parsed;
+        std::shared_ptr<calculation::Operand> expression;
+    };
+
+    explicit ExpressionLibrary(const ParsingContext &context)
+        : context_(context), data_(nullptr), size_(0)
+    {}
+
+    void index();
+
+    const ParsingContext &context_;
+
+    std::unique_ptr<io::MappedFile> file_;
+    std::string text_;
+    const char *data_;
+    size_t size_;
+
+    // Deque keeps entries in place, once_flag can be neither copied nor moved
+    std::deque<Entry> entries_;
+    std::unordered_map<std::string, size_t> names_;
+};
+
+
+/*
+ * ParserError of a library entry. Position is absolute in the library
+ * text, line and column start from 1.
+ */
+class ExpressionLibrary::EntryError : public ParserError {
+public:
+    EntryError(const std::string &name, const std::string &about, size_t pos, size_t line, size_t column)
+        : ParserError(std::to_string(line) + ":" + std::to_string(column) + ": "
+                + (name.empty() ? "" : name + ": ") + about, pos),
+          name(name), line(line), column(column)
+    {}
+
+    std::string name;
+    size_t line;
+    size_t column;
+};
+
+
+/*
+ * Maps the library file and indexes its entries.
+ */
+std::shared_ptr<ExpressionLibrary> open_library(const std::string &path, const ParsingContext &context = ParsingContext::global());
+/*
+ * Indexes the library given as a string.
+ */
+std::shared_ptr<ExpressionLibrary> index_library(const std::string &text, const ParsingContext &context = ParsingContext::global());
+
+}   // namespace infix_parsing
+
+#endif  // EXPRESSION_LIBRARY_HH
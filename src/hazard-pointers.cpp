@@ -0,0 +1,157 @@
+#include "hazard-pointers.hh"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace data_structs {
+
+namespace {
+
+/*
+ * Slots of one thread. Records are never freed, a thread that exits
+ * leaves its record to the next thread that starts.
+ */
+struct Record {
+    std::atomic<void *> hazards[HazardPointers::slots];
+    std::atomic<bool> active;
+    Record *next;
+};
+
+std::atomic<Record *> records(nullptr);
+std::atomic<size_t> record_count(0);
+
+struct Retired {
+    void *pointer;
+    void (*deleter)(void *);
+};
+
+/*
+ * Pointers left behind by exited threads. Those still there when the
+ * process exits are deleted then, every thread is gone by that time.
+ */
+struct Orphans {
+    ~Orphans()
+    {
+        for (auto &r : list)
+            r.deleter(r.pointer);
+    }
+
+    std::mutex mutex;
+    std::vector<Retired> list;
+};
+
+Orphans orphans;
+
+Record *acquire_record()
+{
+    for (Record *r = records.load(std::memory_order_acquire); r; r = r->next) {
+        bool expected = false;
+        if (!r->active.load(std::memory_order_relaxed)
+            && r->active.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            return r;
+    }
+    Record *r = new Record;
+    for (auto &h : r->hazards)
+        h.store(nullptr, std::memory_order_relaxed);
+    r->active.store(true, std::memory_order_relaxed);
+    r->next = records.load(std::memory_order_relaxed);
+    while (!records.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed))
+        ;
+    record_count.fetch_add(1, std::memory_order_relaxed);
+    return r;
+}
+
+class ThreadState {
+public:
+    ThreadState() : record(acquire_record()) {}
+    ~ThreadState();
+
+    void scan();
+
+    Record *record;
+    std::vector<Retired> retired;
+};
+
+ThreadState::~ThreadState()
+{
+    for (auto &h : record->hazards)
+        h.store(nullptr, std::memory_order_release);
+    scan();
+    if (!retired.empty()) {
+        std::lock_guard<std::mutex> lock(orphans.mutex);
+        orphans.list.insert(orphans.list.end(), retired.begin(), retired.end());
+    }
+    record->active.store(false, std::memory_order_release);
+}
+
+void ThreadState::scan()
+{
+    {
+        std::unique_lock<std::mutex> lock(orphans.mutex, std::try_to_lock);
+        if (lock.owns_lock() && !orphans.list.empty()) {
+            retired.insert(retired.end(), orphans.list.begin(), orphans.list.end());
+            orphans.list.clear();
+        }
+    }
+
+    std::vector<void *> protected_pointers;
+    for (Record *r = records.load(std::memory_order_acquire); r; r = r->next) {
+        for (auto &h : r->hazards) {
+            void *p = h.load(std::memory_order_seq_cst);
+            if (p)
+                protected_pointers.push_back(p);
+        }
+    }
+    std::sort(protected_pointers.begin(), protected_pointers.end());
+
+    std::vector<Retired> kept;
+    for (auto &r : retired) {
+        if (std::binary_search(protected_pointers.begin(), protected_pointers.end(), r.pointer))
+            kept.push_back(r);
+        else
+            r.deleter(r.pointer);
+    }
+    retired.swap(kept);
+}
+
+ThreadState &state()
+{
+    static thread_local ThreadState state;
+    return state;
+}
+
+}   // namespace
+
+
+std::atomic<void *> &HazardPointers::hazard(size_t slot)
+{
+    return state().record->hazards[slot];
+}
+
+void HazardPointers::clear(size_t slot)
+{
+    hazard(slot).store(nullptr, std::memory_order_release);
+}
+
+void HazardPointers::retire(void *pointer, void (*deleter)(void *))
+{
+    ThreadState &s = state();
+    s.retired.push_back({pointer, deleter});
+    // Scans cost the same for any number of pointers, so they're let
+    // pile up beyond what all the slots can hold
+    if (s.retired.size() >= 2 * slots * record_count.load(std::memory_order_relaxed) + 64)
+        s.scan();
+}
+
+void HazardPointers::scan()
+{
+    state().scan();
+}
+
+size_t HazardPointers::retired()
+{
+    return state().retired.size();
+}
+
+}   // namespace data_structs
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef HAZARD_POINTERS_HH
+#define HAZARD_POINTERS_HH
+
+#include <atomic>
+#include <cstddef>
+
+namespace data_structs {
+
+/*
+ * Safe memory reclamation for lock-free containers. A thread publishes
+ * the nodes it's about to dereference in its hazard slots, and a node
+ * that's taken out of a container is retired instead of deleted: it's
+ * deleted only once no thread has it in a slot.
+ *
+ * Every thread gets its slots on first use and gives them back when it
+ * exits. Whatever it retired and couldn't delete by then is left to the
+ * threads that are still running.
+ */
+class HazardPointers {
+public:
+    HazardPointers() = delete;
+
+    static const size_t slots = 2;
+
+    /*
+     * Loads the pointer and publishes it in the slot, repeating until
+     * the pointer didn't change in between, so it's safe to use until
+     * the slot is cleared or reused.
+     */
+    template<class T>
+    static T *protect(size_t slot, const std::atomic<T *> &source);
+    static void clear(size_t slot);
+
+    static void retire(void *pointer, void (*deleter)(void *));
+    /*
+     * Deletes every retired pointer that isn't protected. Runs by itself
+     * once a thread retires enough of them.
+     */
+    static void scan();
+
+    /*
+     * Number of pointers retired by the calling thread and not deleted.
+     */
+    static size_t retired();
+private:
+    static std::atomic<void *> &hazard(size_t slot);
+};
+
+
+template<class T>
+T *HazardPointers::protect(size_t slot, const std::atomic<T *> &source)
+{
+    std::atomic<void *> &h = hazard(slot);
+    T *p = source.load(std::memory_order_acquire);
+    for (;;) {
+        h.store(p, std::memory_order_seq_cst);
+        T *again = source.load(std::memory_order_seq_cst);
+        if (again == p)
+            return p;
+        p = again;
+    }
+}
+
+}   // namespace data_structs
+
+#endif  // HAZARD_POINTERS_HH
@@ -0,0 +1,229 @@
+#include "instrumentation.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace diagnostics {
+
+namespace {
+
+struct Event {
+    Stats::Phase phase;
+    unsigned thread;
+    uint64_t begin;
+    uint64_t end;
+};
+
+struct Totals {
+    std::atomic<uint64_t> calls[Stats::phase_count];
+    std::atomic<uint64_t> time[Stats::phase_count];
+    std::atomic<uint64_t> counters[Stats::counter_count];
+
+    std::atomic<size_t (*)()> allocations;
+    size_t allocations_start;
+
+    std::atomic<bool> tracing;
+    // Timestamps of the trace are counted from here
+    std::atomic<uint64_t> epoch;
+    std::mutex mutex;
+    std::vector<Event> events;
+    uint64_t dropped;
+};
+
+Totals totals;
+
+uint64_t now()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Small numbers for threads, in the order they first record an event.
+ */
+unsigned thread_number()
+{
+    static std::atomic<unsigned> next(1);
+    static thread_local unsigned number = next.fetch_add(1, std::memory_order_relaxed);
+    return number;
+}
+
+// Phases running on this thread, one bit each
+thread_local unsigned running_phases = 0;
+
+bool counted(Stats::Counter counter)
+{
+    return counter != Stats::allocations || totals.allocations.load(std::memory_order_relaxed);
+}
+
+/*
+ * Microseconds with three decimals, the unit of the trace format.
+ */
+void write_microseconds(std::ostream &out, uint64_t ns)
+{
+    const char fill = out.fill('0');
+    out << ns / 1000 << '.' << std::setw(3) << ns % 1000;
+    out.fill(fill);
+}
+
+}   // namespace
+
+
+std::atomic<bool> Stats::enabled_(false);
+const size_t Stats::max_events;
+
+
+void Stats::count_allocations(size_t (*total)())
+{
+    totals.allocations.store(total, std::memory_order_relaxed);
+}
+
+void Stats::enable(bool trace)
+{
+    if (size_t (*total)() = totals.allocations.load(std::memory_order_relaxed))
+        totals.allocations_start = total();
+    totals.tracing.store(trace, std::memory_order_relaxed);
+    totals.epoch.store(now(), std::memory_order_relaxed);
+    enabled_.store(true, std::memory_order_release);
+}
+
+void Stats::disable()
+{
+    enabled_.store(false, std::memory_order_release);
+    if (size_t (*total)() = totals.allocations.load(std::memory_order_relaxed))
+        add(allocations, total() - totals.allocations_start);
+}
+
+void Stats::reset()
+{
+    for (unsigned p = 0; p < phase_count; ++p) {
+        totals.calls[p].store(0, std::memory_order_relaxed);
+        totals.time[p].store(0, std::memory_order_relaxed);
+    }
+    for (auto &c : totals.counters)
+        c.store(0, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(totals.mutex);
+    totals.events.clear();
+    totals.dropped = 0;
+    totals.epoch.store(now(), std::memory_order_relaxed);
+}
+
+
+void Stats::add(Counter counter, uint64_t n)
+{
+    totals.counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t Stats::count(Counter counter)
+{
+    return totals.counters[counter].load(std::memory_order_relaxed);
+}
+
+uint64_t Stats::calls(Phase phase)
+{
+    return totals.calls[phase].load(std::memory_order_relaxed);
+}
+
+uint64_t Stats::time(Phase phase)
+{
+    return totals.time[phase].load(std::memory_order_relaxed);
+}
+
+
+const char *Stats::name(Phase phase)
+{
+    static const char *const names[phase_count] = {"parse", "lex", "lookup", "build", "evaluate"};
+    return names[phase];
+}
+
+const char *Stats::name(Counter counter)
+{
+    static const char *const names[counter_count] = {"tokens", "nodes", "lookups", "exceptions", "allocations"};
+    return names[counter];
+}
+
+
+void Stats::report(std::ostream &out)
+{
+    out << std::left << std::setw(12) << "phase" << std::right
+        << std::setw(12) << "calls" << std::setw(16) << "total us" << std::setw(12) << "mean ns" << '\n';
+    for (unsigned p = 0; p < phase_count; ++p) {
+        const Phase phase = Phase(p);
+        const uint64_t n = calls(phase);
+        out << std::left << std::setw(12) << name(phase) << std::right
+            << std::setw(12) << n << std::setw(16) << time(phase) / 1000
+            << std::setw(12) << (n ? time(phase) / n : 0) << '\n';
+    }
+    out << '\n' << std::left << std::setw(12) << "counter" << std::right << std::setw(12) << "value" << '\n';
+    for (unsigned c = 0; c < counter_count; ++c) {
+        const Counter counter = Counter(c);
+        if (!counted(counter))
+            continue;
+        out << std::left << std::setw(12) << name(counter) << std::right << std::setw(12) << count(counter) << '\n';
+    }
+}
+
+void Stats::write_trace(std::ostream &out)
+{
+    std::lock_guard<std::mutex> lock(totals.mutex);
+    const uint64_t epoch = totals.epoch.load(std::memory_order_relaxed);
+    uint64_t last = 0;
+    out << "{\"traceEvents\":[\n";
+    for (const Event &e : totals.events) {
+        out << "{\"name\":\"" << name(e.phase) << "\",\"cat\":\"calculator\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+            << ",\"ts\":";
+        write_microseconds(out, e.begin - epoch);
+        out << ",\"dur\":";
+        write_microseconds(out, e.end - e.begin);
+        out << "},\n";
+        if (e.end - epoch > last)
+            last = e.end - epoch;
+    }
+    // Counters are shown as a single sample at the end
+    out << "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":";
+    write_microseconds(out, last);
+    out << ",\"args\":{";
+    const char *separator = "";
+    for (unsigned c = 0; c < counter_count; ++c) {
+        if (!counted(Counter(c)))
+            continue;
+        out << separator << '"' << name(Counter(c)) << "\":" << count(Counter(c));
+        separator = ",";
+    }
+    out << "}}\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":\"" << totals.dropped << "\"}}\n";
+}
+
+
+void Stats::Timer::start()
+{
+    const unsigned bit = 1u << phase_;
+    if (running_phases & bit)
+        return;
+    running_phases |= bit;
+    running_ = true;
+    begin_ = now();
+}
+
+void Stats::Timer::stop()
+{
+    const uint64_t end = now();
+    running_phases &= ~(1u << phase_);
+    totals.calls[phase_].fetch_add(1, std::memory_order_relaxed);
+    totals.time[phase_].fetch_add(end - begin_, std::memory_order_relaxed);
+    if (!totals.tracing.load(std::memory_order_relaxed))
+        return;
+    const unsigned thread = thread_number();
+    std::lock_guard<std::mutex> lock(totals.mutex);
+    if (totals.events.size() < max_events)
+        totals.events.push_back({phase_, thread, begin_, end});
+    else
+        ++totals.dropped;
+}
+
+}   // namespace diagnostics
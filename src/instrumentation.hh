@@ -0,0 +1,146 @@
+#pragma once
+#ifndef INSTRUMENTATION_HH
+#define INSTRUMENTATION_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace diagnostics {
+
+/*
+ * Phase timers and event counters of the parser and the evaluator,
+ * collected while statistics are enabled. Optionally every timed phase
+ * is also kept as an event, to be written as a Chrome trace that
+ * chrome://tracing or Perfetto can open.
+ *
+ * Probes are placed with the INSTRUMENT_ macros below. Unless the build
+ * defines INSTRUMENTATION they expand to nothing, compiled in they cost
+ * a relaxed load and a branch while statistics are off.
+ *
+ * A phase entered again while it's running on the same thread is not
+ * timed again, so a recursive function is timed once from its outermost
+ * call. Different phases may nest.
+ *
+ * Allocations are counted only by executables that replace the global
+ * allocator and tell where to read the count, see count_allocations().
+ */
+class Stats {
+public:
+    enum Phase : unsigned {
+        parse,
+        lex,
+        lookup,
+        build,
+        evaluate,
+        phase_count,
+    };
+
+    enum Counter : unsigned {
+        tokens,
+        nodes,
+        lookups,
+        exceptions,
+        allocations,
+        counter_count,
+    };
+
+    class Timer;
+
+    /*
+     * Most events a trace keeps, later ones are only counted.
+     */
+    static const size_t max_events = 1 << 20;
+
+    Stats() = delete;
+    Stats(const Stats &) = delete;
+    Stats(Stats &&) = delete;
+
+    /*
+     * Sets the function that returns how many allocations the process
+     * has made, like AllocationCounter::count() of the executables that
+     * include allocation-counter.hh. The allocations made while enabled
+     * are counted from it. Without one the counter is left out of the
+     * report and the trace.
+     */
+    static void count_allocations(size_t (*total)());
+
+    static void enable(bool trace = false);
+    static void disable();
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    /*
+     * Zeroes the counters and timers and drops the trace.
+     */
+    static void reset();
+
+    static void add(Counter counter, uint64_t n = 1);
+    static uint64_t count(Counter counter);
+    /*
+     * Times the phase was entered and nanoseconds spent in it.
+     */
+    static uint64_t calls(Phase phase);
+    static uint64_t time(Phase phase);
+
+    static const char *name(Phase phase);
+    static const char *name(Counter counter);
+
+    /*
+     * Writes a table of phases and counters.
+     */
+    static void report(std::ostream &out);
+    /*
+     * Writes the events in the Chrome trace event format.
+     */
+    static void write_trace(std::ostream &out);
+private:
+    ~Stats() = default;
+
+    static std::atomic<bool> enabled_;
+};
+
+
+class Stats::Timer {
+public:
+    explicit Timer(Phase phase) : phase_(phase), running_(false), begin_(0)
+    {
+        if (Stats::enabled())
+            start();
+    }
+    Timer(const Timer &) = delete;
+
+    ~Timer()
+    {
+        if (running_)
+            stop();
+    }
+private:
+    void start();
+    void stop();
+
+    const Phase phase_;
+    bool running_;
+    uint64_t begin_;
+};
+
+}   // namespace diagnostics
+
+
+#ifdef INSTRUMENTATION
+/*
+ * Times the rest of the enclosing block as the phase, one per block.
+ */
+#define INSTRUMENT_PHASE(phase) \
+    diagnostics::Stats::Timer instrument_timer_(diagnostics::Stats::phase)
+#define INSTRUMENT_COUNT(counter, n) \
+    do { \
+        if (diagnostics::Stats::enabled()) \
+            diagnostics::Stats::add(diagnostics::Stats::counter, n); \
+    } while (0)
+#else
+#define INSTRUMENT_PHASE(phase) do {} while (0)
+#define INSTRUMENT_COUNT(counter, n) do {} while (0)
+#endif
+
+#endif  // INSTRUMENTATION_HH
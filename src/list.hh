@@ -2,63 +2,149 @@
 #ifndef LIST_HH
 #define LIST_HH
 
-#include <memory>
+#include <cstddef>
+#include <new>
 #include <stdexcept>
+#include <utility>
 
-namespace data_structs {
+#include "node-pool.hh"
 
+namespace data_structs {
 
+/*
+ * Doubly linked list. Nodes are linked with plain pointers, the list owns
+ * all of them, and they're taken from and given back to a NodePool.
+ * Iterators don't keep nodes alive, they're valid as long as the node
+ * they point to is in the list.
+ */
 template<class T>
 class List {
 public:
     class Iterator;
+    class Range;
 
     Iterator begin();
     Iterator end();
+    Range range();
 
     List() : head_(nullptr), tail_(nullptr), size_(0) {}
     List(const List &src);
-    List(List &&src);
+    List(List &&src) noexcept;
 
     List(Iterator begin, const Iterator &end);
 
     ~List() { clear(); }
 
-    void push_back(const T &value);
-    void push_front(const T &value);
+    List &operator=(const List &src);
+    List &operator=(List &&src) noexcept;
+
+    void swap(List &other) noexcept;
+
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+    void push_front(const T &value) { emplace_front(value); }
+    void push_front(T &&value) { emplace_front(std::move(value)); }
+    /*
+     * Construct the element in its node from the arguments.
+     */
+    template<class... Args>
+    T &emplace_back(Args &&...args);
+    template<class... Args>
+    T &emplace_front(Args &&...args);
     void pop_back();
     void pop_front();
 
     T &at(size_t i);
-    void insert(const T &value, size_t i);
+    void insert(const T &value, size_t i) { insert_at(i, value); }
+    void insert(T &&value, size_t i) { insert_at(i, std::move(value)); }
     void remove(size_t i);
 
+    /*
+     * Inserts before the position, which may be past the end. Returns
+     * the inserted element.
+     */
+    Iterator insert(const Iterator &pos, const T &value) { return emplace(pos, value); }
+    Iterator insert(const Iterator &pos, T &&value) { return emplace(pos, std::move(value)); }
+    template<class... Args>
+    Iterator emplace(const Iterator &pos, Args &&...args);
+    /*
+     * Returns the element after the erased one.
+     */
+    Iterator erase(const Iterator &pos);
+
+    /*
+     * Moves elements of the other list before the position without
+     * copying them. Moving a whole list or a single element takes
+     * constant time, moving a range takes the time to count it. The
+     * position must not be within what's moved.
+     */
+    void splice(const Iterator &pos, List &other);
+    void splice(const Iterator &pos, List &other, const Iterator &it);
+    void splice(const Iterator &pos, List &other, const Iterator &first, const Iterator &last);
+
     void clear();
 
     size_t size() { return size_; }
     bool empty() { return size_ == 0; }
 private:
-    template<class U>
     struct Node;
 
-    std::shared_ptr<Node<T>> head_;
-    std::shared_ptr<Node<T>> tail_;
+    template<class... Args>
+    static Node *create_node(Args &&...args);
+    static void destroy_node(Node *node);
+
+    template<class... Args>
+    void insert_at(size_t i, Args &&...args);
+
+    /*
+     * Node an insertion goes before, null for the end.
+     */
+    static Node *position(const Iterator &pos);
+    /*
+     * Chains of nodes from first to last inclusive.
+     */
+    void link(Node *first, Node *last, Node *next);
+    void unlink(Node *first, Node *last);
+
+    Node *head_;
+    Node *tail_;
     size_t size_;
 };
 
 
 template<class T>
-template<class U>
 struct List<T>::Node {
-    Node(const U &data) : next(nullptr), prev(nullptr), data(data) {}
+    template<class... Args>
+    Node(Args &&...args) : next(nullptr), prev(nullptr), data(std::forward<Args>(args)...) {}
 
-    std::shared_ptr<Node> next;
-    std::shared_ptr<Node> prev;
+    Node *next;
+    Node *prev;
 
-    U data;
+    T data;
 };
 
 
+template<class T>
+template<class... Args>
+typename List<T>::Node *List<T>::create_node(Args &&...args)
+{
+    void *block = NodePool<sizeof(Node)>::allocate();
+    try {
+        return new (block) Node(std::forward<Args>(args)...);
+    } catch (...) {
+        NodePool<sizeof(Node)>::deallocate(block);
+        throw;
+    }
+}
+
+template<class T>
+void List<T>::destroy_node(Node *node)
+{
+    node->~Node();
+    NodePool<sizeof(Node)>::deallocate(node);
+}
+
+
 template<class T>
 typename List<T>::Iterator List<T>::begin()
 {
@@ -76,22 +162,25 @@ typename List<T>::Iterator List<T>::end()
     return it;
 }
 
+template<class T>
+typename List<T>::Range List<T>::range()
+{
+    return Range(begin(), end(), size_);
+}
+
 
 template<class T>
-List<T>::List(const List<T> &src) : size_(0)
+List<T>::List(const List<T> &src) : List()
 {
-    std::shared_ptr<Node<T>> cur = src.head_;
-    while (cur) {
+    for (Node *cur = src.head_; cur; cur = cur->next)
         push_back(cur->data);
-        cur = cur->next;
-    }
 }
 
 template<class T>
-List<T>::List(List<T> &&src) : size_(src.size_), size_(src.size_)
+List<T>::List(List<T> &&src) noexcept : head_(src.head_), tail_(src.tail_), size_(src.size_)
 {
-    head_.swap(src.head_);
-    tail_.swap(src.tail_);
+    src.head_ = src.tail_ = nullptr;
+    src.size_ = 0;
 }
 
 template<class T>
@@ -106,9 +195,39 @@ List<T>::List(List<T>::Iterator begin, const List<T>::Iterator &end)
 
 
 template<class T>
-void List<T>::push_back(const T &value)
+List<T> &List<T>::operator=(const List<T> &src)
+{
+    if (this != &src) {
+        List<T> copy(src);
+        swap(copy);
+    }
+    return *this;
+}
+
+template<class T>
+List<T> &List<T>::operator=(List<T> &&src) noexcept
+{
+    if (this != &src) {
+        clear();
+        swap(src);
+    }
+    return *this;
+}
+
+template<class T>
+void List<T>::swap(List<T> &other) noexcept
 {
-    std::shared_ptr<Node<T>> node(new Node<T>(value));
+    std::swap(head_, other.head_);
+    std::swap(tail_, other.tail_);
+    std::swap(size_, other.size_);
+}
+
+
+template<class T>
+template<class... Args>
+T &List<T>::emplace_back(Args &&...args)
+{
+    Node *node = create_node(std::forward<Args>(args)...);
     if (!tail_) {
         head_ = node;
     } else {
@@ -117,12 +236,14 @@ void List<T>::push_back(const T &value)
     }
     tail_ = node;
     ++size_;
+    return node->data;
 }
 
 template<class T>
-void List<T>::push_front(const T &value)
+template<class... Args>
+T &List<T>::emplace_front(Args &&...args)
 {
-    std::shared_ptr<Node<T>> node(new Node<T>(value));
+    Node *node = create_node(std::forward<Args>(args)...);
     if (!head_) {
         tail_ = node;
     } else {
@@ -131,17 +252,20 @@ void List<T>::push_front(const T &value)
     }
     head_ = node;
     ++size_;
+    return node->data;
 }
 
 template<class T>
 void List<T>::pop_back()
 {
     if (!empty()) {
+        Node *node = tail_;
         tail_ = tail_->prev;
         if (!tail_)
             head_ = nullptr;
         else
             tail_->next = nullptr;
+        destroy_node(node);
         --size_;
     }
 }
@@ -150,11 +274,13 @@ template<class T>
 void List<T>::pop_front()
 {
     if (!empty()) {
+        Node *node = head_;
         head_ = head_->next;
         if (!head_)
             tail_ = nullptr;
         else
             head_->prev = nullptr;
+        destroy_node(node);
         --size_;
     }
 }
@@ -170,23 +296,27 @@ T &List<T>::at(size_t i)
     } else if (i == size_ - 1) {
         return tail_->data;
     }
-    std::shared_ptr<Node<T>> tmp = head_->next;
+    Node *tmp = head_->next;
     for (size_t j = 1; j != i; ++j)
         tmp = tmp->next;
     return tmp->data;
 }
 
 template<class T>
-void List<T>::insert(const T &value, size_t i)
+template<class... Args>
+void List<T>::insert_at(size_t i, Args &&...args)
 {
-    if (i > size_) // if i == size_, node will be inserted after the last
+    if (i > size_) { // if i == size_, node will be inserted after the last
         throw std::out_of_range("Index out of range.");
-    else if (i == 0)
-        return push_front(value);
-    else if (i == size_)
-        return push_back(value);
-    std::shared_ptr<Node<T>> node(new Node<T>(value));
-    std::shared_ptr<Node<T>> tmp;
+    } else if (i == 0) {
+        emplace_front(std::forward<Args>(args)...);
+        return;
+    } else if (i == size_) {
+        emplace_back(std::forward<Args>(args)...);
+        return;
+    }
+    Node *node = create_node(std::forward<Args>(args)...);
+    Node *tmp;
     if (i == size_ - 1) {
         tmp = tail_;
     } else {
@@ -211,25 +341,140 @@ void List<T>::remove(size_t i)
     } else if (i == size_ - 1) {
         return pop_back();
     }
-    std::shared_ptr<Node<T>> tmp = head_->next;
+    Node *tmp = head_->next;
     for (size_t j = 1; j != i; ++j)
         tmp = tmp->next;
     tmp->prev->next = tmp->next;
     tmp->next->prev = tmp->prev;
+    destroy_node(tmp);
     --size_;
 }
 
 
 template<class T>
-void List<T>::clear()
+typename List<T>::Node *List<T>::position(const Iterator &pos)
 {
-    if (empty())
+    if (!pos.past_the_end_ && !pos.cur_)
+        throw std::logic_error("Position given by unbound iterator.");
+    return pos.cur_;
+}
+
+template<class T>
+void List<T>::link(Node *first, Node *last, Node *next)
+{
+    Node *prev = next ? next->prev : tail_;
+    first->prev = prev;
+    last->next = next;
+    if (prev)
+        prev->next = first;
+    else
+        head_ = first;
+    if (next)
+        next->prev = last;
+    else
+        tail_ = last;
+}
+
+template<class T>
+void List<T>::unlink(Node *first, Node *last)
+{
+    if (first->prev)
+        first->prev->next = last->next;
+    else
+        head_ = last->next;
+    if (last->next)
+        last->next->prev = first->prev;
+    else
+        tail_ = first->prev;
+}
+
+
+template<class T>
+template<class... Args>
+typename List<T>::Iterator List<T>::emplace(const Iterator &pos, Args &&...args)
+{
+    Node *next = position(pos);
+    Node *node = create_node(std::forward<Args>(args)...);
+    link(node, node, next);
+    ++size_;
+    return Iterator(node);
+}
+
+template<class T>
+typename List<T>::Iterator List<T>::erase(const Iterator &pos)
+{
+    if (pos.past_the_end_)
+        throw std::out_of_range("Erasing past-the-end iterator.");
+    if (!pos.cur_)
+        throw std::out_of_range("Erasing unbound iterator.");
+    Node *node = pos.cur_;
+    Node *next = node->next;
+    unlink(node, node);
+    destroy_node(node);
+    --size_;
+    return next ? Iterator(next) : end();
+}
+
+
+template<class T>
+void List<T>::splice(const Iterator &pos, List &other)
+{
+    if (&other == this)
+        throw std::invalid_argument("Splicing a list into itself.");
+    Node *next = position(pos);
+    if (other.empty())
         return;
-    tail_.reset();
+    link(other.head_, other.tail_, next);
+    size_ += other.size_;
+    other.head_ = other.tail_ = nullptr;
+    other.size_ = 0;
+}
+
+template<class T>
+void List<T>::splice(const Iterator &pos, List &other, const Iterator &it)
+{
+    Node *next = position(pos);
+    if (it.past_the_end_ || !it.cur_)
+        throw std::out_of_range("Splicing past-the-end iterator.");
+    Node *node = it.cur_;
+    if (node == next)
+        return;
+    other.unlink(node, node);
+    --other.size_;
+    link(node, node, next);
+    ++size_;
+}
+
+template<class T>
+void List<T>::splice(const Iterator &pos, List &other, const Iterator &first, const Iterator &last)
+{
+    Node *next = position(pos);
+    Node *end = position(last);
+    Node *from = position(first);
+    if (from == end)
+        return;
+    if (!from)
+        throw std::out_of_range("Splicing past-the-end iterator.");
+    size_t count = 1;
+    Node *to = from;
+    for (; to->next != end; to = to->next)
+        ++count;
+    other.unlink(from, to);
+    other.size_ -= count;
+    link(from, to, next);
+    size_ += count;
+}
+
+
+template<class T>
+void List<T>::clear()
+{
     while (head_) {
-       head_->prev.reset();
-       head_ = head_->next;
+        Node *next = head_->next;
+        destroy_node(head_);
+        head_ = next;
     }
+    tail_ = nullptr;
     size_ = 0;
 }
 
@@ -241,13 +486,11 @@ public:
     Iterator(const Iterator &other)
         : cur_(other.cur_), past_the_end_(other.past_the_end_)
     {}
-    Iterator(Iterator &&other);
-    Iterator(const std::shared_ptr<Node<T>> node)
+    explicit Iterator(Node *node)
         : cur_(node), past_the_end_(false)
     {}
 
-    Iterator &operator=(const Iterator &other);
-    Iterator &operator=(Iterator &&other);
+    Iterator &operator=(const Iterator &other) = default;
 
     ~Iterator() = default;
 
@@ -264,10 +507,10 @@ public:
 
     operator bool() const { return past_the_end_ || !cur_; }
 
-    friend Iterator List<T>::begin();
-    friend Iterator List<T>::end();
+    friend class List<T>;
+    friend class Range;
 private:
-    std::shared_ptr<Node<T>> cur_;
+    Node *cur_;
     /*
      * Past the end status may be obtained in three ways:
      * 1. By copying another past the end iterator.
@@ -278,35 +521,6 @@ private:
 };
 
 
-template<class T>
-List<T>::Iterator::Iterator(typename List<T>::Iterator &&other)
-    : past_the_end_(other.past_the_end_)
-{
-    cur_.swap(other.cur_);
-}
-
-
-template<class T>
-typename List<T>::Iterator &List<T>::Iterator::operator=(const Iterator &other)
-{
-    if (this != &other) {
-        cur_ = other.cur_;
-        past_the_end_ = other.past_the_end_;
-    }
-    return *this;
-}
-
-template<class T>
-typename List<T>::Iterator &List<T>::Iterator::operator=(Iterator &&other)
-{
-    if (this != &other) {
-        cur_.swap(other.cur_);
-        past_the_end_ = other.past_the_end_;
-    }
-    return *this;
-}
-
-
 template<class T>
 typename List<T>::Iterator &List<T>::Iterator::operator++()
 {
@@ -376,6 +590,61 @@ T &List<T>::Iterator::operator*()
     return cur_->data;
 }
 
+
+
+/*
+ * Non-owning view of a part of a list from begin up to but not including
+ * end. The view knows its size, so it's split around an element without
+ * walking or copying anything. It's valid as long as the list keeps its
+ * nodes.
+ */
+template<class T>
+class List<T>::Range {
+public:
+    Range() : first_(nullptr), end_(nullptr), size_(0) {}
+    Range(const Iterator &begin, const Iterator &end, size_t size)
+        : first_(size ? begin.cur_ : end.cur_), end_(end.cur_), size_(size)
+    {}
+
+    Iterator begin() const;
+    Iterator end() const;
+
+    T &front() const;
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+private:
+    Node *first_;
+    // Null when the view reaches the end of the list
+    Node *end_;
+    size_t size_;
+};
+
+
+template<class T>
+typename List<T>::Iterator List<T>::Range::begin() const
+{
+    return first_ == end_ ? end() : Iterator(first_);
+}
+
+template<class T>
+typename List<T>::Iterator List<T>::Range::end() const
+{
+    if (end_)
+        return Iterator(end_);
+    Iterator it;
+    it.past_the_end_ = true;
+    return it;
+}
+
+template<class T>
+T &List<T>::Range::front() const
+{
+    if (empty())
+        throw std::out_of_range("Front of an empty range.");
+    return first_->data;
+}
+
 }   // namespace data_structs
 
 #endif  // LIST_HH
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "server.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char usage[] =
+    "Usage: calculator-load SOCKET [--connections=N] [--depth=N] [--requests=N] [--inputs]\n"
+    "\n"
+    "Sends requests to a calculator --serve=SOCKET from N connections at\n"
+    "once, keeping --depth requests of each connection in flight, and\n"
+    "reports requests per second and latency percentiles. Requests are\n"
+    "evaluations of an expression text, or of a parsed formula with two\n"
+    "inputs with --inputs.\n";
+
+struct Options {
+    const char *path = nullptr;
+    size_t connections = 4;
+    size_t depth = 16;
+    size_t requests = 100000;
+    bool inputs = false;
+};
+
+/*
+ * Runs one connection, leaves a latency in nanoseconds for every request.
+ */
+void connection(const Options &options, size_t requests, std::vector<uint64_t> &latencies)
+{
+    server::Client client(options.path);
+    uint32_t formula = 0;
+    if (options.inputs)
+        formula = client.parse("x * sin y + abs (x - y) / 2", {"x", "y"});
+
+    std::vector<Clock::time_point> sent(requests);
+    latencies.resize(requests);
+    auto send = [&](uint32_t id) {
+        sent[id] = Clock::now();
+        if (options.inputs)
+            client.send_evaluate(id, formula, {double(id), 0.5});
+        else
+            client.send_evaluate(id, "2 * (3 + 4) - sin (pi / 6) * " + std::to_string(id % 1000));
+    };
+
+    uint32_t next = 0;
+    while (next < requests && next < options.depth)
+        send(next++);
+    for (size_t done = 0; done < requests; ++done) {
+        server::Client::Response response = client.receive();
+        const Clock::time_point now = Clock::now();
+        if (response.status != server::protocol::ok)
+            throw std::runtime_error("Request failed: " + response.message);
+        latencies[response.id] = std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent[response.id]).count();
+        if (next < requests)
+            send(next++);
+    }
+}
+
+size_t number(const char *arg, const char *prefix)
+{
+    const size_t length = std::strlen(prefix);
+    if (std::strncmp(arg, prefix, length) != 0)
+        return 0;
+    const long long value = std::atoll(arg + length);
+    return value > 0 ? value : 0;
+}
+
+}   // namespace
+
+int main(int argc, char **argv)
+{
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        size_t value;
+        if ((value = number(argv[i], "--connections="))) {
+            options.connections = value;
+        } else if ((value = number(argv[i], "--depth="))) {
+            options.depth = value;
+        } else if ((value = number(argv[i], "--requests="))) {
+            options.requests = value;
+        } else if (!std::strcmp(argv[i], "--inputs")) {
+            options.inputs = true;
+        } else if (argv[i][0] != '-' && !options.path) {
+            options.path = argv[i];
+        } else {
+            std::cerr << usage;
+            return 2;
+        }
+    }
+    if (!options.path) {
+        std::cerr << usage;
+        return 2;
+    }
+
+    std::vector<std::vector<uint64_t>> latencies(options.connections);
+    std::vector<std::exception_ptr> errors(options.connections);
+    std::vector<std::thread> threads;
+    const Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < options.connections; ++i) {
+        const size_t requests = options.requests / options.connections + (i < options.requests % options.connections);
+        threads.emplace_back([&, i, requests] {
+            try {
+                connection(options, requests, latencies[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (auto &error : errors) {
+        try {
+            if (error)
+                std::rethrow_exception(error);
+        } catch (const std::exception &e) {
+            std::cerr << "calculator-load: " << e.what() << '\n';
+            return 1;
+        }
+    }
+
+    std::vector<uint64_t> all;
+    for (auto &part : latencies)
+        all.insert(all.end(), part.begin(), part.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) {
+        return all.empty() ? 0.0 : all[std::min(all.size() - 1, size_t(p * all.size()))] / 1000.0;
+    };
+    std::printf("requests  %zu\n", all.size());
+    std::printf("seconds   %.3f\n", seconds);
+    std::printf("rps       %.0f\n", all.size() / seconds);
+    std::printf("p50       %.1f us\n", percentile(0.50));
+    std::printf("p99       %.1f us\n", percentile(0.99));
+    std::printf("max       %.1f us\n", all.empty() ? 0.0 : all.back() / 1000.0);
+    return 0;
+}
@@ -1,21 +1,63 @@
-#include <iomanip>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
 
+#include <unistd.h>
+
+#include "batch.hh"
 #include "calculation-tree.hh"
+#include "instrumentation.hh"
+#include "mapped-file.hh"
+#include "numbers.hh"
 #include "parsing.hh"
 #include "parsing-exceptions.hh"
+#include "profiler.hh"
+#include "serializer.hh"
+#include "server.hh"
 
 using namespace calculation;
 using namespace infix_parsing;
+using diagnostics::Stats;
+
+namespace {
+
+const char usage[] =
+    "Usage: calculator [--batch [--output=value|tree|errors] [--threads=N] [FILE]]\n"
+    "       calculator --serve=SOCKET [--threads=N]\n"
+    "       calculator --profile[=RUNS] [FILE]\n"
+    "\n"
+    "Without options expressions are read from the terminal one by one,\n"
+    "until an empty line. With --batch every line of FILE or of the\n"
+    "standard input is evaluated and the results are written to the\n"
+    "standard output, one line each; lines that fail are reported as\n"
+    "\n"
+    "    error <TAB> line <TAB> position <TAB> message\n"
+    "\n"
+    "A FILE is mapped into memory and evaluated on all cores, or on N\n"
+    "threads if --threads is given.\n"
+    "\n"
+    "With --serve requests are taken on a Unix domain socket until the\n"
+    "process is interrupted, see server.hh for the protocol.\n"
+    "\n"
+    "With --profile every line is evaluated RUNS times, 10000 by default.\n"
+    "The time of its operators is written to the standard output as\n"
+    "collapsed stacks for flame graphs, and summed up by symbol on the\n"
+    "standard error.\n"
+    "\n"
+    "In any mode --stats prints the time spent in each phase of parsing\n"
+    "and evaluation and a few counters to the standard error on exit, and\n"
+    "--trace=FILE writes every timed phase to FILE as a Chrome trace.\n";
 
-int main()
+int interactive()
 {
-    init_table();
-    std::cout << std::defaultfloat;
     std::string buffer;
     std::shared_ptr<Operand> res;
+    Serializer serializer(Serializer::prefix);
     do {
         std::cout << "> ";
         std::getline(std::cin, buffer);
@@ -31,8 +73,171 @@ int main()
             std::cout << e.what() << std::endl;
             continue;
         }
-        std::cout << res->str() << std::endl;
-        std::cout << res->evaluate() << std::endl;
+        serializer.write(*res, std::cout);
+        std::cout << '\n';
+        char number[Numbers::max_length];
+        std::cout.write(number, Numbers::format(res->evaluate(), number));
+        std::cout << std::endl;
     } while (true);
     return 0;
 }
+
+int batch(io::BatchProcessor::Output output, const char *path, size_t threads)
+{
+    try {
+        if (path) {
+            io::MappedFile file(path);
+            io::ParallelBatch processor(output, threads);
+            processor.run(file.data(), file.data() + file.size(), STDOUT_FILENO);
+        } else {
+            io::BatchProcessor processor(output);
+            processor.run(STDIN_FILENO, STDOUT_FILENO);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "calculator: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+int profile(const char *path, unsigned long runs)
+{
+    std::ifstream file;
+    if (path) {
+        file.open(path);
+        if (!file) {
+            std::cerr << "calculator: cannot open " << path << '\n';
+            return 1;
+        }
+    }
+    std::istream &in = path ? file : std::cin;
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number) {
+        if (line.empty())
+            continue;
+        try {
+            std::shared_ptr<Operand> tree = parse_expression(line);
+            Profiler profiler(*tree);
+            for (unsigned long i = 0; i < runs; ++i)
+                profiler.evaluate();
+            profiler.write_collapsed(std::cout);
+            std::cerr << "line " << number << ": ";
+            profiler.write_report(std::cerr);
+        } catch (const ParserError &e) {
+            std::cerr << "error\t" << number << '\t' << e.position << '\t' << e.what() << '\n';
+        }
+    }
+    return 0;
+}
+
+server::Server *running = nullptr;
+
+void interrupt(int)
+{
+    running->stop();
+}
+
+int serve(const char *path, size_t threads)
+{
+    try {
+        server::Server server(path, threads);
+        running = &server;
+        std::signal(SIGINT, interrupt);
+        std::signal(SIGTERM, interrupt);
+        server.run();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+    } catch (const std::exception &e) {
+        std::cerr << "calculator: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+#ifdef INSTRUMENTATION
+bool stop_stats(bool print, const char *trace)
+{
+    Stats::disable();
+    if (print)
+        Stats::report(std::cerr);
+    if (trace) {
+        std::ofstream out(trace);
+        Stats::write_trace(out);
+        if (!out) {
+            std::cerr << "calculator: cannot write trace to " << trace << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+}   // namespace
+
+int main(int argc, char **argv)
+{
+    init_table();
+    bool batch_mode = false;
+    io::BatchProcessor::Output output = io::BatchProcessor::value;
+    const char *path = nullptr;
+    const char *socket = nullptr;
+    unsigned long runs = 0;
+    bool stats = false;
+    const char *trace = nullptr;
+    size_t threads = concurrency::ThreadPool::default_size();
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--batch")) {
+            batch_mode = true;
+        } else if (!std::strcmp(argv[i], "--output=value")) {
+            output = io::BatchProcessor::value;
+        } else if (!std::strcmp(argv[i], "--output=tree")) {
+            output = io::BatchProcessor::tree;
+        } else if (!std::strcmp(argv[i], "--output=errors")) {
+            output = io::BatchProcessor::errors;
+        } else if (!std::strncmp(argv[i], "--threads=", 10) && std::atoi(argv[i] + 10) > 0) {
+            threads = std::atoi(argv[i] + 10);
+        } else if (!std::strncmp(argv[i], "--serve=", 8) && argv[i][8]) {
+            socket = argv[i] + 8;
+        } else if (!std::strcmp(argv[i], "--profile")) {
+            runs = 10000;
+        } else if (!std::strncmp(argv[i], "--profile=", 10) && std::atol(argv[i] + 10) > 0) {
+            runs = std::atol(argv[i] + 10);
+        } else if (!std::strcmp(argv[i], "--stats")) {
+            stats = true;
+        } else if (!std::strncmp(argv[i], "--trace=", 8) && argv[i][8]) {
+            trace = argv[i] + 8;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            std::cerr << usage;
+            return 2;
+        }
+    }
+    if ((path && !batch_mode && !runs) || (socket && (batch_mode || path)) || (runs && (batch_mode || socket))) {
+        std::cerr << usage;
+        return 2;
+    }
+#ifdef INSTRUMENTATION
+    if (stats || trace)
+        Stats::enable(trace != nullptr);
+#else
+    if (stats || trace) {
+        std::cerr << "calculator: built without instrumentation\n";
+        return 2;
+    }
+#endif
+
+    int status;
+    if (socket)
+        status = serve(socket, threads);
+    else if (runs)
+        status = profile(path, runs);
+    else
+        status = batch_mode ? batch(output, path, threads) : interactive();
+
+#ifdef INSTRUMENTATION
+    if ((stats || trace) && !stop_stats(stats, trace) && status == 0)
+        status = 1;
+#endif
+    return status;
+}
@@ -0,0 +1,52 @@
+#include "mapped-file.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace io {
+
+MappedFile::MappedFile(const std::string &path) : data_(nullptr), size_(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw OpenError(path, std::strerror(errno));
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw OpenError(path, std::strerror(err));
+    }
+    size_ = st.st_size;
+    // Zero length mappings are not allowed, empty files stay unmapped
+    if (size_ > 0) {
+        void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw OpenError(path, std::strerror(err));
+        }
+        data_ = static_cast<const char *>(p);
+    }
+    ::close(fd);
+}
+
+MappedFile::MappedFile(MappedFile &&other)
+    : data_(other.data_), size_(other.size_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+        ::munmap(const_cast<char *>(data_), size_);
+}
+
+}   // namespace io
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef MAPPED_FILE_HH
+#define MAPPED_FILE_HH
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+namespace io {
+
+/*
+ * Read-only memory mapping of a whole file. The mapping lives as long as
+ * the object does.
+ */
+class MappedFile {
+public:
+    class OpenError;
+
+    MappedFile() = delete;
+    explicit MappedFile(const std::string &path);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other);
+
+    ~MappedFile();
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+private:
+    const char *data_;
+    size_t size_;
+};
+
+
+class MappedFile::OpenError : public std::runtime_error {
+public:
+    OpenError(const std::string &path, const std::string &reason)
+        : runtime_error("Cannot map \"" + path + "\": " + reason + ".")
+    {}
+};
+
+}   // namespace io
+
+#endif  // MAPPED_FILE_HH
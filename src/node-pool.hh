@@ -0,0 +1,115 @@
+#pragma once
+#ifndef NODE_POOL_HH
+#define NODE_POOL_HH
+
+#include <cstddef>
+#include <new>
+
+namespace data_structs {
+
+/*
+ * Free list of raw blocks of one size, kept per thread. Containers that
+ * are built and thrown away over and over, like the parser's operand and
+ * operator lists, get their nodes back from here instead of going to the
+ * global allocator every time.
+ *
+ * Blocks come from operator new one by one, so a block freed by another
+ * thread than the one that allocated it just joins that other thread's
+ * list. A thread keeps at most max_cached blocks, the rest are deleted,
+ * and its whole list is deleted when the thread exits. Thread locals
+ * and statics destroyed after that, like the global parsing context at
+ * the exit of the main thread, go straight to the global allocator.
+ */
+template<size_t Size>
+class NodePool {
+public:
+    NodePool() = delete;
+
+    static const size_t max_cached = 4096;
+
+    static void *allocate();
+    static void deallocate(void *block);
+
+    /*
+     * Number of blocks the calling thread holds.
+     */
+    static size_t cached() { return destroyed() ? 0 : cache().count; }
+private:
+    struct Block {
+        Block *next;
+    };
+
+    struct Cache {
+        Block *head = nullptr;
+        size_t count = 0;
+
+        ~Cache();
+    };
+
+    static_assert(Size >= sizeof(Block), "Blocks must fit a free list link.");
+
+    static Cache &cache()
+    {
+        static thread_local Cache cache;
+        return cache;
+    }
+
+    /*
+     * Set once the thread's cache is gone. Trivially destructible, so it
+     * can still be read after every thread local destructor has run.
+     */
+    static bool &destroyed()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+};
+
+
+template<size_t Size>
+NodePool<Size>::Cache::~Cache()
+{
+    destroyed() = true;
+    while (head) {
+        Block *next = head->next;
+        ::operator delete(head);
+        head = next;
+    }
+}
+
+
+template<size_t Size>
+void *NodePool<Size>::allocate()
+{
+    if (destroyed())
+        return ::operator new(Size);
+    Cache &c = cache();
+    if (!c.head)
+        return ::operator new(Size);
+    Block *block = c.head;
+    c.head = block->next;
+    --c.count;
+    return block;
+}
+
+template<size_t Size>
+void NodePool<Size>::deallocate(void *block)
+{
+    if (destroyed()) {
+        ::operator delete(block);
+        return;
+    }
+    Cache &c = cache();
+    if (c.count == max_cached) {
+        ::operator delete(block);
+        return;
+    }
+    Block *b = static_cast<Block *>(block);
+    b->next = c.head;
+    c.head = b;
+    ++c.count;
+}
+
+}   // namespace data_structs
+
+#endif  // NODE_POOL_HH
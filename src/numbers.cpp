@@ -0,0 +1,809 @@
+#include "numbers.hh"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace calculation {
+
+namespace {
+
+/*
+ * Unsigned integer of a fixed capacity, big enough for any value met
+ * while converting doubles (about 3700 bits at most). It lives on the
+ * stack and never allocates.
+ */
+class Big {
+public:
+    static const size_t capacity = 130;
+
+    Big() : size_(0) {}
+    explicit Big(uint64_t value) { assign(value); }
+    // Only the words in use are copied
+    Big(const Big &other) : size_(other.size_)
+    {
+        std::memcpy(words_, other.words_, size_ * sizeof(uint32_t));
+    }
+    Big &operator=(const Big &other) = delete;
+
+    void assign(uint64_t value)
+    {
+        size_ = 0;
+        while (value) {
+            words_[size_++] = uint32_t(value);
+            value >>= 32;
+        }
+    }
+
+    /*
+     * this = this * factor + addend
+     */
+    void multiply_add(uint32_t factor, uint32_t addend)
+    {
+        uint64_t carry = addend;
+        for (size_t i = 0; i < size_; ++i) {
+            uint64_t t = uint64_t(words_[i]) * factor + carry;
+            words_[i] = uint32_t(t);
+            carry = t >> 32;
+        }
+        if (carry)
+            push(uint32_t(carry));
+    }
+
+    void multiply_pow10(unsigned exponent)
+    {
+        static const uint32_t powers[] = {
+            1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+        };
+        for (; exponent >= 9; exponent -= 9)
+            multiply_add(powers[9], 0);
+        if (exponent)
+            multiply_add(powers[exponent], 0);
+    }
+
+    void shift_left(unsigned bits)
+    {
+        if (size_ == 0)
+            return;
+        const size_t words = bits / 32;
+        bits %= 32;
+        if (size_ + words + 1 > capacity)
+            throw std::overflow_error("Number is too long.");
+        words_[size_ + words] = 0;
+        for (size_t i = size_; i-- > 0;) {
+            words_[i + words + 1] |= bits ? words_[i] >> (32 - bits) : 0;
+            words_[i + words] = words_[i] << bits;
+        }
+        for (size_t i = 0; i < words; ++i)
+            words_[i] = 0;
+        size_ += words + 1;
+        trim();
+    }
+
+    void add(const Big &other)
+    {
+        uint64_t carry = 0;
+        size_t i = 0;
+        for (; i < other.size_; ++i) {
+            if (i == size_)
+                push(0);
+            uint64_t t = uint64_t(words_[i]) + other.words_[i] + carry;
+            words_[i] = uint32_t(t);
+            carry = t >> 32;
+        }
+        for (; carry && i < size_; ++i) {
+            uint64_t t = uint64_t(words_[i]) + carry;
+            words_[i] = uint32_t(t);
+            carry = t >> 32;
+        }
+        if (carry)
+            push(uint32_t(carry));
+    }
+
+    /*
+     * this = this - other, this must not be less than other.
+     */
+    void subtract(const Big &other)
+    {
+        int64_t borrow = 0;
+        for (size_t i = 0; i < size_; ++i) {
+            int64_t t = int64_t(words_[i]) - borrow - (i < other.size_ ? other.words_[i] : 0);
+            borrow = t < 0;
+            words_[i] = uint32_t(t);
+        }
+        trim();
+    }
+
+    size_t bit_length() const
+    {
+        if (size_ == 0)
+            return 0;
+        size_t res = 32 * (size_ - 1);
+        for (uint32_t top = words_[size_ - 1]; top; top >>= 1)
+            ++res;
+        return res;
+    }
+
+    bool bit(size_t position) const
+    {
+        return position / 32 < size_ && (words_[position / 32] >> (position % 32)) & 1;
+    }
+
+    static int compare(const Big &a, const Big &b)
+    {
+        if (a.size_ != b.size_)
+            return a.size_ < b.size_ ? -1 : 1;
+        for (size_t i = a.size_; i-- > 0;) {
+            if (a.words_[i] != b.words_[i])
+                return a.words_[i] < b.words_[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    /*
+     * Compares a + b with c.
+     */
+    static int compare_sum(const Big &a, const Big &b, const Big &c)
+    {
+        // The sum is at most one word longer than the longer term
+        const size_t longer = a.size_ > b.size_ ? a.size_ : b.size_;
+        if (longer + 1 < c.size_)
+            return -1;
+        if (longer > c.size_)
+            return 1;
+        Big sum(a);
+        sum.add(b);
+        return compare(sum, c);
+    }
+private:
+    void push(uint32_t word)
+    {
+        if (size_ == capacity)
+            throw std::overflow_error("Number is too long.");
+        words_[size_++] = word;
+    }
+
+    void trim()
+    {
+        while (size_ && words_[size_ - 1] == 0)
+            --size_;
+    }
+
+    uint32_t words_[capacity];
+    size_t size_;
+};
+
+
+const int mantissa_bits = 52;
+const uint64_t hidden_bit = uint64_t(1) << mantissa_bits;
+// Exponents of the lowest bit of the mantissa
+const int min_exponent = -1074;
+const int max_exponent = 971;
+
+/*
+ * Splits a finite non-negative double into mantissa * 2^exponent.
+ */
+void decompose(double value, uint64_t &mantissa, int &exponent)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const int biased = int(bits >> mantissa_bits) & 0x7ff;
+    mantissa = bits & (hidden_bit - 1);
+    if (biased == 0) {
+        exponent = min_exponent;
+    } else {
+        mantissa |= hidden_bit;
+        exponent = biased + min_exponent - 1;
+    }
+}
+
+/*
+ * Floating point number with a 64 bit mantissa, f * 2^e.
+ */
+struct Fp {
+    uint64_t f;
+    int e;
+};
+
+Fp normalize(Fp x)
+{
+    while (!(x.f >> 63)) {
+        x.f <<= 1;
+        --x.e;
+    }
+    return x;
+}
+
+/*
+ * Product rounded to 64 bits, it is within half a unit of the exact one.
+ */
+Fp multiply(Fp x, Fp y)
+{
+    const uint64_t mask = 0xffffffff;
+    const uint64_t a = x.f >> 32, b = x.f & mask;
+    const uint64_t c = y.f >> 32, d = y.f & mask;
+    const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t middle = (bd >> 32) + (ad & mask) + (bc & mask);
+    middle += uint64_t(1) << 31;
+    Fp res = { ac + (ad >> 32) + (bc >> 32) + (middle >> 32), x.e + y.e + 64 };
+    return res;
+}
+
+/*
+ * Normalized powers of ten 10^-348, 10^-340, ..., 10^340, rounded to the
+ * nearest 64 bit mantissa. They are computed exactly once, on first use.
+ */
+class CachedPowers {
+public:
+    static const int first = -348;
+    static const int step = 8;
+    static const int count = 87;
+
+    static const CachedPowers &get()
+    {
+        static const CachedPowers table;
+        return table;
+    }
+
+    /*
+     * Power with the largest exponent not above the given one.
+     */
+    Fp below(int exponent, int &power) const
+    {
+        const int i = (exponent - first) / step;
+        power = first + i * step;
+        return powers_[i];
+    }
+
+    /*
+     * Power that brings a number with the binary exponent into the range
+     * the digit generation works with, 2^-60 to 2^-32 times 2^64.
+     */
+    Fp scaling(int exponent, int &power) const
+    {
+        const int k = int(std::ceil((-60 - exponent + 63) * 0.30102999566398114));
+        const int i = (k - first - 1) / step + 1;
+        power = first + i * step;
+        return powers_[i];
+    }
+private:
+    CachedPowers()
+    {
+        for (int i = 0; i < count; ++i)
+            powers_[i] = compute(first + i * step);
+    }
+
+    static Fp compute(int power)
+    {
+        Big value(1);
+        uint64_t f = 0;
+        bool round;
+        int e;
+        if (power >= 0) {
+            value.multiply_pow10(power);
+            const size_t length = value.bit_length();
+            for (size_t i = 0; i < 64; ++i)
+                f |= uint64_t(length >= 64 - i && value.bit(length - 64 + i)) << i;
+            round = length > 64 && value.bit(length - 65);
+            e = int(length) - 64;
+        } else {
+            // 2^length / 10^-power is in (1, 2), long division gives its bits
+            Big divisor(1);
+            divisor.multiply_pow10(-power);
+            const size_t length = divisor.bit_length();
+            Big rest(1);
+            rest.shift_left(length);
+            rest.subtract(divisor);
+            f = 1;
+            for (int i = 0; i < 64; ++i) {
+                rest.shift_left(1);
+                const bool one = Big::compare(rest, divisor) >= 0;
+                if (one)
+                    rest.subtract(divisor);
+                if (i < 63)
+                    f = f << 1 | one;
+                else
+                    round = one;
+            }
+            e = -63 - int(length);
+        }
+        if (round && ++f == 0) {
+            f = uint64_t(1) << 63;
+            ++e;
+        }
+        Fp res = { f, e };
+        return res;
+    }
+
+    Fp powers_[count];
+};
+
+/*
+ * Removes the last digit while that brings it closer to the value and
+ * tells if the digits are surely the closest shortest ones.
+ */
+bool round_weed(char *digits, int count, uint64_t distance_high_w, uint64_t unsafe_interval,
+                uint64_t rest, uint64_t ten_kappa, uint64_t unit)
+{
+    const uint64_t small_distance = distance_high_w - unit;
+    const uint64_t big_distance = distance_high_w + unit;
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa
+           && (rest + ten_kappa < small_distance
+               || small_distance - rest >= rest + ten_kappa - small_distance)) {
+        --digits[count - 1];
+        rest += ten_kappa;
+    }
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa
+        && (rest + ten_kappa < big_distance
+            || big_distance - rest > rest + ten_kappa - big_distance))
+        return false;
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+/*
+ * Shortest digits by Loitsch's Grisu3 on 64 bit integers. It gives up on
+ * a small fraction of values, where it can't prove the digits are right.
+ */
+bool grisu(double value, char *digits, int &count, int &point)
+{
+    uint64_t f;
+    int e;
+    decompose(value, f, e);
+    const bool unequal = f == hidden_bit && e > min_exponent;
+    Fp w = { f, e };
+    w = normalize(w);
+    Fp high = { (f << 1) + 1, e - 1 };
+    high = normalize(high);
+    Fp low = unequal ? Fp{ (f << 2) - 1, e - 2 } : Fp{ (f << 1) - 1, e - 1 };
+    low.f <<= low.e - high.e;
+    low.e = high.e;
+
+    int power;
+    const Fp scale = CachedPowers::get().scaling(w.e + 64, power);
+    w = multiply(w, scale);
+    low = multiply(low, scale);
+    high = multiply(high, scale);
+
+    // The scaled boundaries are within a unit of the exact ones
+    uint64_t unit = 1;
+    const uint64_t too_low = low.f - unit;
+    const uint64_t too_high = high.f + unit;
+    uint64_t unsafe_interval = too_high - too_low;
+    const int shift = -w.e;
+    const uint64_t one = uint64_t(1) << shift;
+    uint32_t integrals = uint32_t(too_high >> shift);
+    uint64_t fractionals = too_high & (one - 1);
+
+    uint32_t divisor = 0;
+    int kappa = 0;
+    for (uint64_t p = 1; p <= integrals; p *= 10) {
+        divisor = uint32_t(p);
+        ++kappa;
+    }
+    count = 0;
+    while (kappa > 0) {
+        digits[count++] = char('0' + integrals / divisor);
+        integrals %= divisor;
+        --kappa;
+        const uint64_t rest = (uint64_t(integrals) << shift) + fractionals;
+        if (rest < unsafe_interval) {
+            point = count + kappa - power;
+            return round_weed(digits, count, too_high - w.f, unsafe_interval, rest,
+                              uint64_t(divisor) << shift, unit);
+        }
+        divisor /= 10;
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+        digits[count++] = char('0' + (fractionals >> shift));
+        fractionals &= one - 1;
+        --kappa;
+        if (fractionals < unsafe_interval) {
+            point = count + kappa - power;
+            return round_weed(digits, count, (too_high - w.f) * unit, unsafe_interval,
+                              fractionals, one, unit);
+        }
+    }
+}
+
+/*
+ * Shortest digits of a positive finite value, by Burger and Dybvig's free
+ * format algorithm on big integers. The value is 0.digits * 10^point.
+ */
+int shortest(double value, char *digits, int &point)
+{
+    uint64_t f;
+    int e;
+    decompose(value, f, e);
+    const bool even = (f & 1) == 0;
+    // The gap below a power of two is half the gap above it
+    const bool unequal = f == hidden_bit && e > min_exponent;
+
+    // value = r / s, the neighbours are half way at r -+ m_minus, m_plus
+    Big r(f), s(1), m_plus(1), m_minus(1);
+    if (e >= 0) {
+        r.shift_left(e + 1 + unequal);
+        s.shift_left(1 + unequal);
+        m_plus.shift_left(e + unequal);
+        m_minus.shift_left(e);
+    } else {
+        r.shift_left(1 + unequal);
+        s.shift_left(1 - e + unequal);
+        m_plus.shift_left(unequal);
+    }
+
+    int bits = 0;
+    for (uint64_t t = f; t; t >>= 1)
+        ++bits;
+    int k = int(std::ceil((e + bits - 1) * 0.30102999566398114 - 1e-10));
+    if (k >= 0) {
+        s.multiply_pow10(k);
+    } else {
+        r.multiply_pow10(-k);
+        m_plus.multiply_pow10(-k);
+        m_minus.multiply_pow10(-k);
+    }
+
+    // The estimate may be one too small
+    int high = Big::compare_sum(r, m_plus, s);
+    if (even ? high >= 0 : high > 0) {
+        ++k;
+    } else {
+        r.multiply_add(10, 0);
+        m_plus.multiply_add(10, 0);
+        m_minus.multiply_add(10, 0);
+    }
+    point = k;
+
+    int count = 0;
+    for (;;) {
+        int digit = 0;
+        while (Big::compare(r, s) >= 0) {
+            r.subtract(s);
+            ++digit;
+        }
+        const int low = Big::compare(r, m_minus);
+        high = Big::compare_sum(r, m_plus, s);
+        const bool low_done = even ? low <= 0 : low < 0;
+        const bool high_done = even ? high >= 0 : high > 0;
+        if (!low_done && !high_done) {
+            digits[count++] = char('0' + digit);
+            r.multiply_add(10, 0);
+            m_plus.multiply_add(10, 0);
+            m_minus.multiply_add(10, 0);
+            continue;
+        }
+        if (low_done && high_done) {
+            Big twice(r);
+            twice.add(r);
+            if (Big::compare(twice, s) >= 0)
+                ++digit;
+        } else if (high_done) {
+            ++digit;
+        }
+        digits[count++] = char('0' + digit);
+        return count;
+    }
+}
+
+/*
+ * Digits of an integer below 2^53, which are the shortest ones already.
+ */
+int integer_digits(uint64_t value, char *digits, int &point)
+{
+    char reversed[20];
+    int count = 0;
+    for (; value; value /= 10)
+        reversed[count++] = char('0' + value % 10);
+    point = count;
+    int start = 0;
+    while (start < count && reversed[start] == '0')
+        ++start;
+    for (int i = count; i-- > start;)
+        *digits++ = reversed[i];
+    return count - start;
+}
+
+char *write_exponent(char *p, int exponent)
+{
+    *p++ = 'e';
+    *p++ = exponent < 0 ? '-' : '+';
+    if (exponent < 0)
+        exponent = -exponent;
+    char reversed[4];
+    int count = 0;
+    do {
+        reversed[count++] = char('0' + exponent % 10);
+        exponent /= 10;
+    } while (exponent);
+    while (count)
+        *p++ = reversed[--count];
+    return p;
+}
+
+
+/*
+ * Decimal number digits * 10^exponent. Only as many digits are kept as
+ * needed to tell the halfway points between doubles apart, the rest only
+ * leave a trace in a trailing non-zero digit.
+ */
+struct Decimal {
+    static const int max_digits = 768;
+
+    unsigned char digits[max_digits + 1];
+    int count;
+    int exponent;
+};
+
+/*
+ * Compares the decimal with mantissa * 2^exponent.
+ */
+int compare(const Decimal &decimal, uint64_t mantissa, int exponent)
+{
+    Big left, right(mantissa);
+    for (int i = 0; i < decimal.count; ++i)
+        left.multiply_add(10, decimal.digits[i]);
+    if (decimal.exponent >= 0)
+        left.multiply_pow10(decimal.exponent);
+    else
+        right.multiply_pow10(-decimal.exponent);
+    if (exponent >= 0)
+        right.shift_left(exponent);
+    else
+        left.shift_left(-exponent);
+    return Big::compare(left, right);
+}
+
+const double exact_powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+    1e21, 1e22,
+};
+const int max_exact_power = 22;
+
+/*
+ * Nearest double to a non-zero decimal of a magnitude parse() accepts.
+ * Ambiguous cases are settled exactly on big integers.
+ */
+double convert(const Decimal &decimal)
+{
+    // Leading digits make a good enough approximation
+    const int taken = decimal.count < 19 ? decimal.count : 19;
+    uint64_t leading = 0;
+    for (int i = 0; i < taken; ++i)
+        leading = leading * 10 + decimal.digits[i];
+    int scale = decimal.exponent + decimal.count - taken;
+
+    // Clinger's fast path, both factors and the result are exact
+    if (taken == decimal.count && leading <= hidden_bit * 2) {
+        if (scale >= 0 && scale <= max_exact_power)
+            return double(leading) * exact_powers[scale];
+        if (scale < 0 && -scale <= max_exact_power)
+            return double(leading) / exact_powers[-scale];
+    }
+
+    /*
+     * The estimate is off by at most error units of its last bit, the
+     * result is known unless that covers the halfway point between doubles.
+     */
+    Fp x = { leading, 0 };
+    x = normalize(x);
+    uint64_t error = taken == decimal.count ? 0 : uint64_t(1) << -x.e;
+    int power;
+    const Fp cached = CachedPowers::get().below(scale, power);
+    if (scale != power) {
+        Fp adjustment = { uint64_t(exact_powers[scale - power]), 0 };
+        x = normalize(multiply(x, normalize(adjustment)));
+        error = (error + 1) * 2;
+    }
+    x = normalize(multiply(x, cached));
+    error = (error + 2) * 2;
+
+    uint64_t m = x.f >> 11;
+    int q = x.e + 11;
+    const uint64_t low = x.f & 0x7ff;
+    const uint64_t half = 0x400;
+    const bool ambiguous = low + error >= half && low <= half + error;
+    if (q >= min_exponent && !ambiguous) {
+        if (low > half && ++m == hidden_bit * 2) {
+            m = hidden_bit;
+            ++q;
+        }
+        if (q > max_exponent)
+            throw std::out_of_range("Number is too big.");
+        return std::ldexp(double(m), q);
+    }
+    if (q > max_exponent) {
+        m = hidden_bit * 2 - 1;
+        q = max_exponent;
+    } else if (q < min_exponent) {
+        decompose(std::ldexp(double(x.f), x.e), m, q);
+    }
+
+    // Moving to the neighbour until the decimal is within half a step
+    for (;;) {
+        int c = compare(decimal, 2 * m + 1, q - 1);
+        if (c > 0 || (c == 0 && (m & 1))) {
+            if (++m == hidden_bit * 2) {
+                m = hidden_bit;
+                ++q;
+            }
+            if (q > max_exponent)
+                throw std::out_of_range("Number is too big.");
+            if (c == 0)
+                break;
+            continue;
+        }
+        if (m == 0)
+            break;
+        const bool narrow = m == hidden_bit && q > min_exponent;
+        c = narrow
+            ? compare(decimal, 4 * m - 1, q - 2)
+            : compare(decimal, 2 * m - 1, q - 1);
+        if (c < 0 || (c == 0 && (m & 1))) {
+            if (narrow) {
+                m = hidden_bit * 2 - 1;
+                --q;
+            } else {
+                --m;
+            }
+            if (c == 0)
+                break;
+            continue;
+        }
+        break;
+    }
+    return std::ldexp(double(m), q);
+}
+
+const int CachedPowers::first;
+const int CachedPowers::step;
+const int CachedPowers::count;
+
+bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+}   // namespace
+
+
+const size_t Numbers::max_length;
+
+size_t Numbers::format(double value, char *buffer)
+{
+    char *p = buffer;
+    if (std::isnan(value)) {
+        std::memcpy(buffer, "nan", 4);
+        return 3;
+    }
+    if (std::signbit(value)) {
+        *p++ = '-';
+        value = -value;
+    }
+    if (std::isinf(value)) {
+        std::memcpy(p, "inf", 4);
+        return p + 3 - buffer;
+    }
+    if (value == 0) {
+        std::memcpy(p, "0", 2);
+        return p + 1 - buffer;
+    }
+
+    char digits[20];
+    int point;
+    int count;
+    if (value < double(hidden_bit * 2) && value == std::floor(value))
+        count = integer_digits(uint64_t(value), digits, point);
+    else if (!grisu(value, digits, count, point))
+        count = shortest(value, digits, point);
+
+    const int exponent = point - 1;
+    if (exponent < -6 || exponent > 20) {
+        *p++ = digits[0];
+        if (count > 1) {
+            *p++ = '.';
+            std::memcpy(p, digits + 1, count - 1);
+            p += count - 1;
+        }
+        p = write_exponent(p, exponent);
+    } else if (point <= 0) {
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = point; i < 0; ++i)
+            *p++ = '0';
+        std::memcpy(p, digits, count);
+        p += count;
+    } else if (point >= count) {
+        std::memcpy(p, digits, count);
+        p += count;
+        for (int i = count; i < point; ++i)
+            *p++ = '0';
+    } else {
+        std::memcpy(p, digits, point);
+        p += point;
+        *p++ = '.';
+        std::memcpy(p, digits + point, count - point);
+        p += count - point;
+    }
+    *p = '\0';
+    return p - buffer;
+}
+
+
+size_t Numbers::parse(const char *begin, const char *end, double &value)
+{
+    const char *p = begin;
+    const bool negative = p != end && *p == '-';
+    if (negative)
+        ++p;
+    if (p == end || !is_digit(*p))
+        return 0;
+
+    Decimal decimal;
+    decimal.count = 0;
+    decimal.exponent = 0;
+    bool truncated = false;
+    bool fraction = false;
+    for (; p != end; ++p) {
+        if (*p == '.' && !fraction) {
+            fraction = true;
+            continue;
+        }
+        if (!is_digit(*p))
+            break;
+        if (fraction)
+            --decimal.exponent;
+        if (decimal.count == 0 && *p == '0')
+            continue;
+        if (decimal.count < Decimal::max_digits) {
+            decimal.digits[decimal.count++] = *p - '0';
+        } else {
+            ++decimal.exponent;
+            truncated = truncated || *p != '0';
+        }
+    }
+
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        const bool minus = q != end && *q == '-';
+        if (q != end && (*q == '-' || *q == '+'))
+            ++q;
+        if (q != end && is_digit(*q)) {
+            int exponent = 0;
+            for (; q != end && is_digit(*q); ++q) {
+                if (exponent < 100000)
+                    exponent = exponent * 10 + (*q - '0');
+            }
+            decimal.exponent += minus ? -exponent : exponent;
+            p = q;
+        }
+    }
+
+    // The discarded digits only matter for being not all zeros
+    if (truncated) {
+        decimal.digits[decimal.count++] = 1;
+        --decimal.exponent;
+    }
+    while (decimal.count && decimal.digits[decimal.count - 1] == 0) {
+        --decimal.count;
+        ++decimal.exponent;
+    }
+
+    const int magnitude = decimal.count + decimal.exponent;
+    if (decimal.count == 0 || magnitude < -323)
+        value = 0;
+    else if (magnitude > 310)
+        throw std::out_of_range("Number is too big.");
+    else
+        value = convert(decimal);
+    if (negative)
+        value = -value;
+    return p - begin;
+}
+
+}   // namespace calculation
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef NUMBERS_HH
+#define NUMBERS_HH
+
+#include <cstddef>
+
+namespace calculation {
+
+/*
+ * Conversions between doubles and decimal text. Both directions are
+ * exact, don't depend on the locale and never allocate.
+ *
+ * Numbers are printed with the fewest significant digits that read back
+ * as the same double, in plain notation for exponents from -6 to 20 and
+ * in scientific notation otherwise: "0.1", "1500", "1e+21", "5e-324".
+ *
+ * The text accepted is
+ *
+ *     [-] digits [. [digits]] [(e|E) [+|-] digits]
+ *
+ * rounded to the nearest double, ties to even.
+ */
+class Numbers {
+public:
+    /*
+     * Longest text format() produces, the terminating zero included.
+     */
+    static const size_t max_length = 32;
+
+    Numbers() = delete;
+    Numbers(const Numbers &) = delete;
+    Numbers(Numbers &&) = delete;
+
+    /*
+     * Writes a zero terminated number into the buffer of at least
+     * max_length bytes, returns its length.
+     */
+    static size_t format(double value, char *buffer);
+
+    /*
+     * Reads a number at the beginning of the range, returns the number of
+     * characters taken or 0 if there's no number there. Numbers too big
+     * for a double throw std::out_of_range, too small ones become zeros.
+     */
+    static size_t parse(const char *begin, const char *end, double &value);
+private:
+    ~Numbers() = default;
+};
+
+}   // namespace calculation
+
+#endif  // NUMBERS_HH
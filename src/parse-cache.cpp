@@ -0,0 +1,151 @@
+#include "parse-cache.hh"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "calculation-tree.hh"
+#include "parsing.hh"
+#include "scanner.hh"
+
+namespace infix_parsing {
+
+using calculation::Operand;
+using calculation::Expression;
+
+using calculation::Operator;
+using calculation::UnaryOperator;
+using calculation::BinaryOperator;
+
+namespace {
+
+/*
+ * Approximate size of a tree node together with its shared_ptr control
+ * block and the operator's name and function.
+ */
+const size_t node_cost = 128;
+
+size_t count_nodes(const std::shared_ptr<Operand> &operand)
+{
+    std::shared_ptr<Expression> exp = std::dynamic_pointer_cast<Expression>(operand);
+    if (!exp || !exp->get_root())
+        return 1;
+    std::shared_ptr<Operator> root = exp->get_root();
+    std::shared_ptr<UnaryOperator> unary = std::dynamic_pointer_cast<UnaryOperator>(root);
+    if (unary)
+        return 2 + count_nodes(unary->get_operand());
+    std::shared_ptr<BinaryOperator> binary = std::dynamic_pointer_cast<BinaryOperator>(root);
+    if (binary)
+        return 2 + count_nodes(binary->get_left()) + count_nodes(binary->get_right());
+    return 2;
+}
+
+}   // namespace
+
+
+ParseCache::ParseCache(size_t memory_limit, size_t shards, const ParsingContext &context)
+    : context_(context), memory_limit_(memory_limit), hits_(0), misses_(0), evictions_(0)
+{
+    if (shards == 0)
+        throw std::invalid_argument("Cache must have at least one shard.");
+    shard_limit_ = memory_limit / shards;
+    for (size_t i = 0; i < shards; ++i)
+        shards_.emplace_back(new Shard);
+}
+
+
+std::string ParseCache::normalise(const std::string &text)
+{
+    std::string res;
+    res.reserve(text.length());
+    bool space = false;
+    for (auto c : text) {
+        if (Scanner::is_space(c)) {
+            space = !res.empty();
+            continue;
+        }
+        if (space)
+            res += ' ';
+        space = false;
+        res += c;
+    }
+    return res;
+}
+
+size_t ParseCache::cost(const std::string &key, const std::shared_ptr<Operand> &tree)
+{
+    // The key is stored both in the list and in the index
+    return sizeof(Entry) + 2 * key.capacity() + count_nodes(tree) * node_cost;
+}
+
+
+ParseCache::Shard &ParseCache::shard(const std::string &key)
+{
+    return *shards_[std::hash<std::string>()(key) % shards_.size()];
+}
+
+
+std::shared_ptr<const Operand> ParseCache::parse(const std::string &text)
+{
+    std::string key = normalise(text);
+    Shard &s = shard(key);
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = s.index.find(key);
+        if (it != s.index.end()) {
+            s.lru.splice(s.lru.begin(), s.lru, it->second);
+            ++hits_;
+            return it->second->tree;
+        }
+    }
+    ++misses_;
+
+    // Parsing is done unlocked, the same text may be parsed twice at worst
+    std::shared_ptr<Operand> tree = parse_expression(text, *context_.snapshot());
+    const size_t entry_cost = cost(key, tree);
+    if (entry_cost > shard_limit_)
+        return tree;
+
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.index.find(key);
+    if (it != s.index.end()) {
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        return it->second->tree;
+    }
+    while (s.memory + entry_cost > shard_limit_) {
+        s.memory -= s.lru.back().cost;
+        s.index.erase(s.lru.back().key);
+        s.lru.pop_back();
+        ++evictions_;
+    }
+    s.lru.push_front({key, tree, entry_cost});
+    s.index.emplace(key, s.lru.begin());
+    s.memory += entry_cost;
+    return tree;
+}
+
+
+ParseCache::Statistics ParseCache::statistics() const
+{
+    Statistics res = {hits_.load(), misses_.load(), evictions_.load(), 0, 0};
+    for (auto &s : shards_) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        res.entries += s->lru.size();
+        res.memory += s->memory;
+    }
+    return res;
+}
+
+void ParseCache::clear()
+{
+    for (auto &s : shards_) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->index.clear();
+        s->lru.clear();
+        s->memory = 0;
+    }
+}
+
+}   // namespace infix_parsing
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef PARSE_CACHE_HH
+#define PARSE_CACHE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "parsing-table.hh"
+
+namespace infix_parsing {
+
+/*
+ * Bounded LRU cache in front of parse_expression(). Expressions are keyed
+ * by their normalised text, so "1 + 2" and " 1 +\t 2 " share an entry;
+ * "1+2" and "1 + 2" do not, the spacing between tokens is kept.
+ * Cached trees are shared between callers and must not be modified.
+ *
+ * The cache is split into shards with their own locks and an equal part
+ * of the memory limit, so concurrent lookups rarely wait for each other.
+ *
+ * Expressions are parsed with the context's current table. Entries parsed
+ * before a registration are kept as they are, clear() drops them.
+ */
+class ParseCache {
+public:
+    struct Statistics {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        size_t entries;
+        size_t memory;
+    };
+
+    ParseCache() = delete;
+    explicit ParseCache(size_t memory_limit, size_t shards = 16, const ParsingContext &context = ParsingContext::global());
+    ParseCache(const ParseCache &) = delete;
+    ParseCache(ParseCache &&) = delete;
+
+    /*
+     * Returns the cached expression or parses and caches it. Parser errors
+     * are not cached and refer to positions in the given text.
+     */
+    std::shared_ptr<const calculation::Operand> parse(const std::string &text);
+
+    Statistics statistics() const;
+    void clear();
+
+    size_t memory_limit() const { return memory_limit_; }
+
+    /*
+     * Trims the text and collapses every whitespace run into a single space.
+     * Whitespace is never a part of a token, so that doesn't change the
+     * meaning of the expression.
+     */
+    static std::string normalise(const std::string &text);
+    /*
+     * Rough estimate of memory taken by an entry.
+     */
+    static size_t cost(const std::string &key, const std::shared_ptr<calculation::Operand> &tree);
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const calculation::Operand> tree;
+        size_t cost;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        // Most recently used entries are at the front
+        std::list<Entry> lru;
+        std::unordered_map<std::string, std::list<Entry>::iterator> index;
+        size_t memory = 0;
+    };
+
+    Shard &shard(const std::string &key);
+
+    const ParsingContext &context_;
+
+    size_t memory_limit_;
+    size_t shard_limit_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> evictions_;
+};
+
+}   // namespace infix_parsing
+
+#endif  // PARSE_CACHE_HH
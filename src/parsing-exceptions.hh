@@ -4,13 +4,17 @@
 
 #include <stdexcept>
 
+#include "instrumentation.hh"
+
 namespace infix_parsing {
 
 class ParserError : public std::runtime_error {
 public:
     ParserError(const std::string about, size_t pos)
         : runtime_error(about), position(pos)
-    {}
+    {
+        INSTRUMENT_COUNT(exceptions, 1);
+    }
 
     size_t position;
 };
@@ -53,6 +57,13 @@ public:
     {}
 };
 
+class AssignmentExpectationUnsatisfied : public UnsatisfiedExpectation {
+public:
+    AssignmentExpectationUnsatisfied(size_t pos)
+        : UnsatisfiedExpectation("Assignment was expected, but couldn't be found.", pos)
+    {}
+};
+
 class TooBigNumber : public ParserError {
 public:
     TooBigNumber(size_t pos)
@@ -60,6 +71,20 @@ public:
     {}
 };
 
+class NameRedefinition : public ParserError {
+public:
+    NameRedefinition(size_t pos)
+        : ParserError("Name is already defined.", pos)
+    {}
+};
+
+class CyclicDependency : public ParserError {
+public:
+    CyclicDependency(size_t pos)
+        : ParserError("Statement depends on itself.", pos)
+    {}
+};
+
 }   // namespace infix_parsing
 
 #endif  // PARSING_EXCEPTIONS_HH
@@ -1,27 +1,26 @@
 #include "parsing-table.hh"
 
-#include <cctype>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 
 #include "list.hh"
-
-#include "parsing-table.hh"
+#include "scanner.hh"
+#include "symbols.hh"
 
 namespace infix_parsing {
 
-data_structs::List<ParsingTable::ConstantEntry> ParsingTable::constants_;
-data_structs::List<ParsingTable::UnaryOperatorEntry> ParsingTable::unary_operators_;
-data_structs::List<ParsingTable::BinaryOperatorEntry> ParsingTable::binary_operators_;
-
-
 bool ParsingTable::is_valid_name(const std::string &name)
 {
     if (name.length() == 0)
         return false;
-    if (std::isdigit(name[0]))
+    if (Scanner::is_digit(name[0]))
         return false;
     for (auto c : name) {
-        if (!std::isgraph(c))
+        if (!Scanner::is_graph(c))
             return false;
     }
     return true;
@@ -30,95 +29,283 @@ bool ParsingTable::is_valid_name(const std::string &name)
 
 void ParsingTable::register_constant(const std::string &name, const double value)
 {
-    if (!is_valid_name(name))
-        throw InvalidNameError(name);
-    constants_.push_back({name, value});
+    ParsingContext::global().register_constant(name, value);
 }
 
 void ParsingTable::register_unary(const std::string &name, std::function<double (double)> f)
 {
-    if (!is_valid_name(name))
-        throw InvalidNameError(name);
+    ParsingContext::global().register_unary(name, f);
+}
+
+void ParsingTable::register_binary(const std::string &name, std::function<double (double, double)> f, unsigned order)
+{
+    ParsingContext::global().register_binary(name, f, order);
+}
+
+
+bool ParsingTable::is_constant(const std::string &name)
+{
+    return ParsingContext::global().current().is_constant(name);
+}
+
+bool ParsingTable::is_unary_operator(const std::string &name)
+{
+    return ParsingContext::global().current().is_unary_operator(name);
+}
+
+bool ParsingTable::is_binary_operator(const std::string &name)
+{
+    return ParsingContext::global().current().is_binary_operator(name);
+}
+
+
+std::shared_ptr<calculation::Constant> ParsingTable::get_constant(const std::string &name)
+{
+    return ParsingContext::global().current().get_constant(name);
+}
+
+std::shared_ptr<calculation::UnaryOperator> ParsingTable::get_unary_operator(const std::string &name)
+{
+    return ParsingContext::global().current().get_unary_operator(name);
+}
+
+std::shared_ptr<calculation::BinaryOperator> ParsingTable::get_binary_operator(const std::string &name)
+{
+    return ParsingContext::global().current().get_binary_operator(name);
+}
+
+
+void SymbolTable::register_constant(const std::string &name, const double value)
+{
+    if (!ParsingTable::is_valid_name(name))
+        throw ParsingTable::InvalidNameError(name);
+    size_t i = 0;
+    for (auto &c : constants_) {
+        if (calculation::Symbols::name(c.data.name()) == name) {
+            constants_.remove(i);
+            break;
+        }
+        ++i;
+    }
+    constants_.push_back({name, value});
+    longest_name_ = std::max(longest_name_, name.length());
+}
+
+void SymbolTable::register_unary(const std::string &name, std::function<double (double)> f)
+{
+    if (!ParsingTable::is_valid_name(name))
+        throw ParsingTable::InvalidNameError(name);
     if (!f)
         throw std::invalid_argument("Operator cannot be null.");
-    unary_operators_.push_back({name, f});
+    size_t i = 0;
+    for (auto &op : unary_operators_) {
+        if (calculation::Symbols::name(op->name) == name) {
+            unary_operators_.remove(i);
+            break;
+        }
+        ++i;
+    }
+    unary_operators_.push_back(std::make_shared<const calculation::UnaryOperator::Descriptor>(name, f));
+    longest_name_ = std::max(longest_name_, name.length());
 }
 
-void ParsingTable::register_binary(const std::string &name, std::function<double (double, double)> f, unsigned order)
+void SymbolTable::register_binary(const std::string &name, std::function<double (double, double)> f, unsigned order)
 {
-    if (!is_valid_name(name))
-        throw InvalidNameError(name);
+    if (!ParsingTable::is_valid_name(name))
+        throw ParsingTable::InvalidNameError(name);
     if (!f)
         throw std::invalid_argument("Operator cannot be null.");
-    binary_operators_.push_back({name, f, order});
+    size_t i = 0;
+    for (auto &op : binary_operators_) {
+        if (calculation::Symbols::name(op->name) == name) {
+            binary_operators_.remove(i);
+            break;
+        }
+        ++i;
+    }
+    binary_operators_.push_back(std::make_shared<const calculation::BinaryOperator::Descriptor>(name, f, order));
+    longest_name_ = std::max(longest_name_, name.length());
 }
 
 
-bool ParsingTable::is_constant(const std::string &name)
+bool SymbolTable::is_constant(const std::string &name) const
 {
-    if (!is_valid_name(name))
+    if (!ParsingTable::is_valid_name(name))
         return false;
     for (auto &c : constants_) {
-        if (c.data.str() == name)
+        if (calculation::Symbols::name(c.data.name()) == name)
             return true;
     }
     return false;
 }
 
-bool ParsingTable::is_unary_operator(const std::string &name)
+bool SymbolTable::is_unary_operator(const std::string &name) const
 {
-    if (!is_valid_name(name))
+    if (!ParsingTable::is_valid_name(name))
         return false;
     for (auto &c : unary_operators_) {
-        if (c.data.repr() == name)
+        if (calculation::Symbols::name(c->name) == name)
             return true;
     }
     return false;
 }
 
-bool ParsingTable::is_binary_operator(const std::string &name)
+bool SymbolTable::is_binary_operator(const std::string &name) const
 {
-    if (!is_valid_name(name))
+    if (!ParsingTable::is_valid_name(name))
         return false;
     for (auto &c : binary_operators_) {
-        if (c.data.repr() == name)
+        if (calculation::Symbols::name(c->name) == name)
             return true;
     }
     return false;
 }
 
 
-std::shared_ptr<calculation::Constant> ParsingTable::get_constant(const std::string &name)
+std::shared_ptr<calculation::Constant> SymbolTable::get_constant(const std::string &name) const
 {
-    if (!is_valid_name(name))
-        throw InvalidNameError(name);
+    if (!ParsingTable::is_valid_name(name))
+        throw ParsingTable::InvalidNameError(name);
     for (auto &c : constants_) {
-        if (name == c.data.str())
+        if (name == calculation::Symbols::name(c.data.name()))
             return std::shared_ptr<calculation::Constant>(new calculation::Constant(c.data));
     }
-    throw NameSearchError(name);
+    throw ParsingTable::NameSearchError(name);
 }
 
-std::shared_ptr<calculation::UnaryOperator> ParsingTable::get_unary_operator(const std::string &name)
+double SymbolTable::get_constant_value(const std::string &name) const
+{
+    if (!ParsingTable::is_valid_name(name))
+        throw ParsingTable::InvalidNameError(name);
+    for (auto &c : constants_) {
+        if (name == calculation::Symbols::name(c.data.name()))
+            return c.data.evaluate();
+    }
+    throw ParsingTable::NameSearchError(name);
+}
+
+std::shared_ptr<calculation::UnaryOperator> SymbolTable::get_unary_operator(const std::string &name) const
+{
+    return std::make_shared<calculation::UnaryOperator>(get_unary_descriptor(name));
+}
+
+std::shared_ptr<calculation::BinaryOperator> SymbolTable::get_binary_operator(const std::string &name) const
+{
+    return std::make_shared<calculation::BinaryOperator>(get_binary_descriptor(name));
+}
+
+
+std::shared_ptr<const calculation::UnaryOperator::Descriptor> SymbolTable::get_unary_descriptor(const std::string &name) const
 {
-    if (!is_valid_name(name))
-        throw InvalidNameError(name);
+    if (!ParsingTable::is_valid_name(name))
+        throw ParsingTable::InvalidNameError(name);
     for (auto &op : unary_operators_) {
-        if (name == op.data.repr())
-            return std::shared_ptr<calculation::UnaryOperator>(new calculation::UnaryOperator(op.data));
+        if (name == calculation::Symbols::name(op->name))
+            return op;
     }
-    throw NameSearchError(name);
+    throw ParsingTable::NameSearchError(name);
 }
 
-std::shared_ptr<calculation::BinaryOperator> ParsingTable::get_binary_operator(const std::string &name)
+std::shared_ptr<const calculation::BinaryOperator::Descriptor> SymbolTable::get_binary_descriptor(const std::string &name) const
 {
-    if (!is_valid_name(name))
-        throw InvalidNameError(name);
+    if (!ParsingTable::is_valid_name(name))
+        throw ParsingTable::InvalidNameError(name);
     for (auto &op : binary_operators_) {
-        if (name == op.data.repr())
-            return std::shared_ptr<calculation::BinaryOperator>(new calculation::BinaryOperator(op.data));
+        if (name == calculation::Symbols::name(op->name))
+            return op;
     }
-    throw NameSearchError(name);
+    throw ParsingTable::NameSearchError(name);
+}
+
+
+namespace {
+
+std::atomic<uint64_t> next_stamp(1);
+
+/*
+ * Snapshots recently taken by a thread, replaced round robin.
+ */
+struct SnapshotCache {
+    static const size_t size = 4;
+
+    uint64_t stamps[size] = {};
+    std::shared_ptr<const SymbolTable> tables[size];
+    size_t next = 0;
+};
+
+thread_local SnapshotCache snapshot_cache;
+
+}   // namespace
+
+
+ParsingContext::ParsingContext()
+    : table_(std::make_shared<const SymbolTable>()), stamp_(next_stamp++)
+{}
+
+ParsingContext &ParsingContext::global()
+{
+    static ParsingContext context;
+    return context;
+}
+
+
+std::shared_ptr<const SymbolTable> ParsingContext::snapshot() const
+{
+    return cached();
+}
+
+const SymbolTable &ParsingContext::current() const
+{
+    return *cached();
+}
+
+const std::shared_ptr<const SymbolTable> &ParsingContext::cached() const
+{
+    SnapshotCache &cache = snapshot_cache;
+    const uint64_t stamp = stamp_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < SnapshotCache::size; ++i) {
+        if (cache.stamps[i] == stamp)
+            return cache.tables[i];
+    }
+
+    std::shared_ptr<const SymbolTable> table;
+    uint64_t table_stamp;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        table = table_;
+        table_stamp = stamp_.load(std::memory_order_relaxed);
+    }
+    // The replaced table may be the last reference, it's freed unlocked
+    const size_t i = cache.next;
+    cache.next = (i + 1) % SnapshotCache::size;
+    cache.stamps[i] = table_stamp;
+    cache.tables[i] = std::move(table);
+    return cache.tables[i];
+}
+
+
+void ParsingContext::register_constant(const std::string &name, const double value)
+{
+    update([&](SymbolTable &table) { table.register_constant(name, value); });
+}
+
+void ParsingContext::register_unary(const std::string &name, std::function<double (double)> f)
+{
+    update([&](SymbolTable &table) { table.register_unary(name, f); });
+}
+
+void ParsingContext::register_binary(const std::string &name, std::function<double (double, double)> f, unsigned order)
+{
+    update([&](SymbolTable &table) { table.register_binary(name, f, order); });
+}
+
+void ParsingContext::update(const std::function<void(SymbolTable &)> &f)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<SymbolTable> next = std::make_shared<SymbolTable>(*table_);
+    f(*next);
+    table_ = next;
+    stamp_.store(next_stamp++, std::memory_order_release);
 }
 
 }   // namespace infix_parsing
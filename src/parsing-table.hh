@@ -2,19 +2,27 @@
 #ifndef PARSING_TABLE_HH
 #define PARSING_TABLE_HH
 
-#include <cctype>
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 
 #include "calculation-tree.hh"
 #include "list.hh"
+#include "scanner.hh"
 
 namespace infix_parsing {
 
+class ParsingContext;
+
+
 /*
- * A static table that holds entries on how to decode text into math
+ * A static table that holds entries on how to decode text into math.
+ * It works with the global parsing context, see ParsingContext for
+ * independent tables.
  */
 class ParsingTable {
 public:
@@ -26,8 +34,8 @@ public:
     ParsingTable(ParsingTable &&) = delete;
 
     static bool is_valid_name(const std::string &name);
-    static bool is_starting_digit(char c) { return std::isdigit(c); }
-    static bool is_digit(char c) { return std::isdigit(c) || c == '.'; }
+    static bool is_starting_digit(char c) { return Scanner::is_digit(c); }
+    static bool is_digit(char c) { return Scanner::is_number(c); }
 
     static void register_constant(const std::string &name, const double value);
     static void register_unary(const std::string &name, std::function<double (double)> f);
@@ -41,15 +49,7 @@ public:
     static std::shared_ptr<calculation::UnaryOperator> get_unary_operator(const std::string &name);
     static std::shared_ptr<calculation::BinaryOperator> get_binary_operator(const std::string &name);
 private:
-    struct ConstantEntry;
-    struct UnaryOperatorEntry;
-    struct BinaryOperatorEntry;
-
     ~ParsingTable() = default;
-
-    static data_structs::List<ConstantEntry> constants_;
-    static data_structs::List<UnaryOperatorEntry> unary_operators_;
-    static data_structs::List<BinaryOperatorEntry> binary_operators_;
 };
 
 
@@ -69,33 +69,122 @@ public:
 };
 
 
-struct ParsingTable::ConstantEntry {
-    ConstantEntry() = delete;
-    ConstantEntry(const std::string &name, const double value)
-        : data(value, name)
-    {}
+/*
+ * Set of constants and operators of a single parsing context. Registering
+ * a name that is already there replaces the old entry.
+ *
+ * Operators are kept as shared descriptors, nodes returned by the getters
+ * point to them, so copying the table or creating a node never copies
+ * names or functions. Replaced descriptors live on while nodes use them.
+ */
+class SymbolTable {
+public:
+    SymbolTable() : longest_name_(0) {}
+    SymbolTable(const SymbolTable &) = default;
 
-    const calculation::Constant data;
-};
+    void register_constant(const std::string &name, const double value);
+    void register_unary(const std::string &name, std::function<double (double)> f);
+    void register_binary(const std::string &name, std::function<double (double, double)> f, unsigned order);
 
+    bool is_constant(const std::string &name) const;
+    bool is_unary_operator(const std::string &name) const;
+    bool is_binary_operator(const std::string &name) const;
 
-struct ParsingTable::UnaryOperatorEntry {
-    UnaryOperatorEntry() = delete;
-    UnaryOperatorEntry(const std::string &name, std::function<double(double)> f)
-        : data(name, f)
-    {}
+    std::shared_ptr<calculation::Constant> get_constant(const std::string &name) const;
+    std::shared_ptr<calculation::UnaryOperator> get_unary_operator(const std::string &name) const;
+    std::shared_ptr<calculation::BinaryOperator> get_binary_operator(const std::string &name) const;
+
+    /*
+     * Value of the constant without creating a node for it.
+     */
+    double get_constant_value(const std::string &name) const;
 
-    const calculation::UnaryOperator data;
+    std::shared_ptr<const calculation::UnaryOperator::Descriptor> get_unary_descriptor(const std::string &name) const;
+    std::shared_ptr<const calculation::BinaryOperator::Descriptor> get_binary_descriptor(const std::string &name) const;
+
+    /*
+     * No registered name is longer, useful for scanning names in a stream.
+     */
+    size_t longest_name() const { return longest_name_; }
+private:
+    struct ConstantEntry;
+    using UnaryOperatorEntry = std::shared_ptr<const calculation::UnaryOperator::Descriptor>;
+    using BinaryOperatorEntry = std::shared_ptr<const calculation::BinaryOperator::Descriptor>;
+
+    /*
+     * List has no const iteration, lookups don't modify the lists anyway.
+     */
+    mutable data_structs::List<ConstantEntry> constants_;
+    mutable data_structs::List<UnaryOperatorEntry> unary_operators_;
+    mutable data_structs::List<BinaryOperatorEntry> binary_operators_;
+
+    size_t longest_name_;
 };
 
 
-struct ParsingTable::BinaryOperatorEntry {
-    BinaryOperatorEntry() = delete;
-    BinaryOperatorEntry(const std::string &name, std::function<double(double, double)> f, unsigned order)
-        : data(name, f, order)
+struct SymbolTable::ConstantEntry {
+    ConstantEntry() = delete;
+    ConstantEntry(const std::string &name, const double value)
+        : data(value, name)
     {}
 
-    const calculation::BinaryOperator data;
+    const calculation::Constant data;
+};
+
+
+/*
+ * Parsing context owns a symbol table, so different users of the parser
+ * may have different sets of functions.
+ *
+ * The table is published as an immutable snapshot. Registration copies
+ * the current table, modifies the copy and publishes it under a new
+ * stamp. Snapshots already taken stay valid as long as someone holds
+ * them.
+ *
+ * Every thread keeps the last few snapshots it took along with their
+ * stamps, so taking a snapshot of an unchanged table is an atomic load
+ * and a copy of the cached pointer. Only the first snapshot after a
+ * registration locks the context. A cached table is released when the
+ * thread exits or takes snapshots of other tables.
+ */
+class ParsingContext {
+public:
+    ParsingContext();
+    ParsingContext(const ParsingContext &) = delete;
+    ParsingContext(ParsingContext &&) = delete;
+
+    /*
+     * The context used by ParsingTable and by the parsing functions that
+     * don't take a context.
+     */
+    static ParsingContext &global();
+
+    std::shared_ptr<const SymbolTable> snapshot() const;
+
+    void register_constant(const std::string &name, const double value);
+    void register_unary(const std::string &name, std::function<double (double)> f);
+    void register_binary(const std::string &name, std::function<double (double, double)> f, unsigned order);
+
+    /*
+     * Applies several registrations at once, publishing a single snapshot.
+     * If the function throws, nothing is published.
+     */
+    void update(const std::function<void(SymbolTable &)> &f);
+private:
+    friend class ParsingTable;
+
+    /*
+     * The current table from this thread's cache, valid until the thread
+     * takes another snapshot.
+     */
+    const SymbolTable &current() const;
+    const std::shared_ptr<const SymbolTable> &cached() const;
+
+    std::shared_ptr<const SymbolTable> table_;
+    // Changes with every published table, no two tables share a stamp
+    std::atomic<uint64_t> stamp_;
+    // Serializes writers, readers take it when the stamp has changed
+    mutable std::mutex mutex_;
 };
 
 }   // namespace infix_parsing
@@ -4,21 +4,24 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 
-#include "list.hh"
+#include "small-vector.hh"
 
 #include "calculation-tree.hh"
+#include "instrumentation.hh"
+#include "numbers.hh"
 #include "parsing-exceptions.hh"
 #include "parsing-table.hh"
+#include "scanner.hh"
 
 namespace infix_parsing {
 
-using table = ParsingTable;
-
-using data_structs::List;
+using data_structs::SmallVector;
 
 using calculation::Operand;
 using calculation::Constant;
+using calculation::Variable;
 using calculation::Expression;
 
 using calculation::Operator;
@@ -32,85 +35,122 @@ double adapter_ctg(double arg)
 
 void init_table()
 {
-    table::register_constant("pi", 3.141592653589793);
-    table::register_constant("e",  2.718281828459045);
+    init_table(ParsingContext::global());
+}
+
+void init_table(ParsingContext &context)
+{
+    context.update([](SymbolTable &table) {
+        table.register_constant("pi", 3.141592653589793);
+        table.register_constant("e",  2.718281828459045);
 
-    table::register_unary("-", std::negate<double>());
-    table::register_unary("abs", (double (*)(double))std::abs);
-    table::register_unary("sin", (double (*)(double))std::sin);
-    table::register_unary("cos", (double (*)(double))std::cos);
-    table::register_unary("tg", (double (*)(double))std::tan);
-    table::register_unary("ctg", adapter_ctg);
-    table::register_unary("ln", (double (*)(double))std::log);
-    table::register_unary("log", (double (*)(double))std::log10);
-    table::register_unary("sqrt", (double (*)(double))std::sqrt);
+        table.register_unary("-", std::negate<double>());
+        table.register_unary("abs", (double (*)(double))std::abs);
+        table.register_unary("sin", (double (*)(double))std::sin);
+        table.register_unary("cos", (double (*)(double))std::cos);
+        table.register_unary("tg", (double (*)(double))std::tan);
+        table.register_unary("ctg", adapter_ctg);
+        table.register_unary("ln", (double (*)(double))std::log);
+        table.register_unary("log", (double (*)(double))std::log10);
+        table.register_unary("sqrt", (double (*)(double))std::sqrt);
 
-    table::register_binary("^", (double (*)(double, double))std::pow, 0);
-    table::register_binary("*", std::multiplies<double>(), 1);
-    table::register_binary("/", std::divides<double>(), 1);
-    table::register_binary("+", std::plus<double>(), 2);
-    table::register_binary("-", std::minus<double>(), 2);
+        table.register_binary("^", (double (*)(double, double))std::pow, 0);
+        table.register_binary("*", std::multiplies<double>(), 1);
+        table.register_binary("/", std::divides<double>(), 1);
+        table.register_binary("+", std::plus<double>(), 2);
+        table.register_binary("-", std::minus<double>(), 2);
+    });
 }
 
 
 size_t skip_spaces(const std::string &string, size_t start)
 {
-    const size_t len = string.size();
-    size_t pos = start;
-    while (pos < len && std::isspace(string[pos]))
-        ++pos;
-    return pos;
+    if (start >= string.size())
+        return start;
+    const char *begin = string.data();
+    return Scanner::skip_spaces(begin + start, begin + string.size()) - begin;
 }
 
 std::shared_ptr<Constant> parse_value(const std::string &string, size_t &start)
 {
+    INSTRUMENT_PHASE(lex);
+    INSTRUMENT_COUNT(tokens, 1);
+    INSTRUMENT_COUNT(nodes, 1);
     size_t processed = 0;
     double val;
     try {
-        std::string buffer(string, start, string.size() - start);
-        val = std::stod(buffer, &processed);
+        processed = calculation::Numbers::parse(string.data() + start, string.data() + string.size(), val);
     } catch (std::out_of_range &) {
         throw TooBigNumber(start);
     }
-    std::shared_ptr<Constant> res = std::make_shared<Constant>(
-        val,
-        std::string(string, start, processed)
-    );
+    std::shared_ptr<Constant> res = std::make_shared<Constant>(val);
     start += processed;
     return res;
 }
 
-std::shared_ptr<Constant> parse_constant(const std::string &string, size_t &start)
+std::shared_ptr<Constant> parse_constant(const std::string &string, size_t &start, const SymbolTable &table)
 {
+    INSTRUMENT_PHASE(lookup);
     const size_t len = string.length();
     size_t pos = start;
     std::string copy;
     copy += string[pos];
-    while (!table::is_constant(copy)) {
+    while (!table.is_constant(copy)) {
+        INSTRUMENT_COUNT(lookups, 1);
         if (++pos == len)
             throw UnexpectedEndOfExpression(pos);
         copy += string[pos];
     }
+    // The name found is looked up once more by the getter
+    INSTRUMENT_COUNT(lookups, 2);
+    INSTRUMENT_COUNT(tokens, 1);
+    INSTRUMENT_COUNT(nodes, 1);
     start = pos + 1;
-    return table::get_constant(copy);
+    return table.get_constant(copy);
 }
 
-std::shared_ptr<UnaryOperator> parse_unary(const std::string &string, size_t &start)
+std::shared_ptr<UnaryOperator> parse_unary(const std::string &string, size_t &start, const SymbolTable &table)
 {
+    INSTRUMENT_PHASE(lookup);
     const size_t len = string.length();
     size_t pos = start;
     std::string copy;
     copy += string[pos];
-    while (!table::is_unary_operator(copy)) {
+    while (!table.is_unary_operator(copy)) {
+        INSTRUMENT_COUNT(lookups, 1);
         if (++pos == len)
             throw UnexpectedEndOfExpression(pos);
         copy += string[pos];
     }
+    INSTRUMENT_COUNT(lookups, 2);
+    INSTRUMENT_COUNT(tokens, 1);
+    INSTRUMENT_COUNT(nodes, 1);
     start = pos + 1;
-    return table::get_unary_operator(copy);
+    return table.get_unary_operator(copy);
 }
 
-std::shared_ptr<Operand> parse_operand(const std::string &string, size_t &start)
+/*
+ * Returns the variable which name starts at the position, or nullptr
+ * leaving the position untouched if there's none.
+ */
+std::shared_ptr<Variable> parse_variable(const std::string &string, size_t &start, const Scope &scope)
+{
+    INSTRUMENT_PHASE(lex);
+    const char *begin = string.data();
+    const size_t pos = Scanner::skip_identifier(begin + start, begin + string.size()) - begin;
+    if (pos == start)
+        return nullptr;
+    Scope::const_iterator it = scope.find(std::string(string, start, pos - start));
+    if (it == scope.end())
+        return nullptr;
+    INSTRUMENT_COUNT(tokens, 1);
+    start = pos;
+    return it->second;
+}
+
+std::shared_ptr<Operand> parse_expression(const std::string &string, size_t start, const SymbolTable &table, const Scope *scope);
+
+std::shared_ptr<Operand> parse_operand(const std::string &string, size_t &start, const SymbolTable &table, const Scope *scope)
 {
     const size_t len = string.length();
     if (start >= len)
@@ -133,26 +173,29 @@ std::shared_ptr<Operand> parse_operand(const std::string &string, size_t &start)
             throw UnexpectedEndOfExpression(pos);
         std::string inner(string, backup_pos + 1, pos - backup_pos - 2);
         try {
-            res = parse_expression(inner);
+            res = parse_expression(inner, 0, table, scope);
         } catch (ParserError &e) {
             // Restoring absolute position in the string and re-throwing
             e.position += backup_pos + 1;
             throw e;
         }
-    } else if (table::is_starting_digit(string[pos])) {
+    } else if (ParsingTable::is_starting_digit(string[pos])) {
         res = parse_value(string, pos);
+    } else if (scope && (res = parse_variable(string, pos, *scope))) {
+        // Variables shadow table entries with the same prefix
     } else {
         try {
-            std::shared_ptr<UnaryOperator> tmp = parse_unary(string, pos);
-            tmp->set_operand(parse_operand(string, pos));
+            std::shared_ptr<UnaryOperator> tmp = parse_unary(string, pos, table);
+            tmp->set_operand(parse_operand(string, pos, table, scope));
 
+            INSTRUMENT_COUNT(nodes, 1);
             std::shared_ptr<Expression> exp(new Expression);
             exp->set_root(tmp);
             res = exp;
         } catch (const ParserError&) {
             pos = backup_pos;
             try {
-                res = parse_constant(string, pos);
+                res = parse_constant(string, pos, table);
             } catch (const UnexpectedEndOfExpression&) {
                 throw OperandExpectationUnsatisfied(backup_pos);
             }
@@ -163,7 +206,7 @@ std::shared_ptr<Operand> parse_operand(const std::string &string, size_t &start)
 }
 
 
-std::shared_ptr<BinaryOperator> parse_operator(const std::string &string, size_t &start)
+std::shared_ptr<BinaryOperator> parse_operator(const std::string &string, size_t &start, const SymbolTable &table)
 {
     const size_t len = string.length();
     if (start >= len)
@@ -172,46 +215,70 @@ std::shared_ptr<BinaryOperator> parse_operator(const std::string &string, size_t
     if (pos == len)
         throw BinaryExpectationUnsatisfied(start);
 
+    INSTRUMENT_PHASE(lookup);
     std::string copy;
     copy += string[pos];
-    while (!table::is_binary_operator(copy)) {
+    while (!table.is_binary_operator(copy)) {
+        INSTRUMENT_COUNT(lookups, 1);
         if (++pos == len)
             throw UnexpectedEndOfExpression(pos);
         copy += string[pos];
     }
+    INSTRUMENT_COUNT(lookups, 2);
+    INSTRUMENT_COUNT(tokens, 1);
+    INSTRUMENT_COUNT(nodes, 1);
     start = pos + 1;
-    return table::get_binary_operator(copy);
+    return table.get_binary_operator(copy);
 }
 
-std::shared_ptr<Operand> create_tree_from_parser_lists(List<std::shared_ptr<Operand>> operands, List<std::shared_ptr<BinaryOperator>> operators)
+/*
+ * There's one operator less than operands. Both are split around the
+ * operator that goes to the root, the halves stay where they are.
+ */
+std::shared_ptr<Operand> create_tree_from_parser_lists(const std::shared_ptr<Operand> *operands, const std::shared_ptr<BinaryOperator> *operators, size_t count)
 {
-    if (operands.size() == 1)
-        return *operands.begin();
+    if (count == 1)
+        return operands[0];
+    INSTRUMENT_COUNT(nodes, 1);
     std::shared_ptr<Expression> res = std::make_shared<Expression>();
-    List<std::shared_ptr<Operand>>::Iterator operand = operands.begin();
-    List<std::shared_ptr<Operand>>::Iterator left_operand = operand++;
-    List<std::shared_ptr<BinaryOperator>>::Iterator op_it = operators.begin();
-    List<std::shared_ptr<BinaryOperator>>::Iterator hang_point = op_it++;
-    while (op_it != operators.end()) {
-        if ((*hang_point)->order() <= (*op_it)->order()) {
-            hang_point = op_it;
-            left_operand = operand;
-        }
-        ++op_it;
-        ++operand;
+    size_t hang_point = 0;
+    for (size_t i = 1; i < count - 1; ++i) {
+        if (operators[hang_point]->order() <= operators[i]->order())
+            hang_point = i;
     }
-    res->set_root(*hang_point);
-    (*hang_point)->set_left(create_tree_from_parser_lists(
-        {operands.begin(), ++left_operand},
-        {operators.begin(), hang_point}));
-    (*hang_point)->set_right(create_tree_from_parser_lists(
-        {left_operand, operands.end()},
-        {++hang_point, operators.end()}));
+    const std::shared_ptr<BinaryOperator> &root = operators[hang_point];
+    res->set_root(root);
+    root->set_left(create_tree_from_parser_lists(operands, operators, hang_point + 1));
+    root->set_right(create_tree_from_parser_lists(
+        operands + hang_point + 1,
+        operators + hang_point + 1,
+        count - hang_point - 1));
     return res;
 }
 
 std::shared_ptr<Operand> parse_expression(const std::string &string, size_t start)
 {
+    return parse_expression(string, start, *ParsingContext::global().snapshot(), nullptr);
+}
+
+std::shared_ptr<Operand> parse_expression(const std::string &string, const Scope &scope, size_t start)
+{
+    return parse_expression(string, start, *ParsingContext::global().snapshot(), &scope);
+}
+
+std::shared_ptr<Operand> parse_expression(const std::string &string, const SymbolTable &table, size_t start)
+{
+    return parse_expression(string, start, table, nullptr);
+}
+
+std::shared_ptr<Operand> parse_expression(const std::string &string, const SymbolTable &table, const Scope &scope, size_t start)
+{
+    return parse_expression(string, start, table, &scope);
+}
+
+std::shared_ptr<Operand> parse_expression(const std::string &string, size_t start, const SymbolTable &table, const Scope *scope)
+{
+    INSTRUMENT_PHASE(parse);
     const size_t len = string.length();
     if (len == 0)
         return std::shared_ptr<Operand>(new Constant(0));
@@ -223,26 +290,28 @@ std::shared_ptr<Operand> parse_expression(const std::string &string, size_t star
     size_t pos = start;
     std::shared_ptr<Operand> tmpoperand;
     std::shared_ptr<BinaryOperator> tmpoperator;
-    List<std::shared_ptr<BinaryOperator>> operators;
-    List<std::shared_ptr<Operand>> operands;
+    SmallVector<std::shared_ptr<BinaryOperator>, 16> operators;
+    SmallVector<std::shared_ptr<Operand>, 16> operands;
     do {
         pos = skip_spaces(string, pos);
-        tmpoperand = parse_operand(string, pos);
-        operands.push_back(tmpoperand);
+        tmpoperand = parse_operand(string, pos, table, scope);
+        operands.push_back(std::move(tmpoperand));
         pos = skip_spaces(string, pos);
         if (pos < len) {
-            tmpoperator = parse_operator(string, pos);
-            operators.push_back(tmpoperator);
+            tmpoperator = parse_operator(string, pos, table);
+            operators.push_back(std::move(tmpoperator));
         } else {
             break;
         }
     } while (true);
 
     std::shared_ptr<Operand> res;
-    if (operands.size() == 1)
-        res = *operands.begin();
-    else
-        res = create_tree_from_parser_lists(operands, operators);
+    if (operands.size() == 1) {
+        res = operands[0];
+    } else {
+        INSTRUMENT_PHASE(build);
+        res = create_tree_from_parser_lists(operands.data(), operators.data(), operands.size());
+    }
     return res;
 }
 
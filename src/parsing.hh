@@ -2,13 +2,21 @@
 #ifndef PARSING_HH
 #define PARSING_HH
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 
 #include "calculation-tree.hh"
+#include "parsing-table.hh"
 
 namespace infix_parsing {
 
+/*
+ * Registers the default constants and operators. Calling it again does
+ * no harm, entries with the same names are replaced.
+ */
 void init_table();
+void init_table(ParsingContext &context);
 
 
 /*
@@ -17,6 +25,25 @@ void init_table();
  */
 std::shared_ptr<calculation::Operand> parse_expression(const std::string &string, size_t start = 0);
 
+
+/*
+ * Variables the parser recognises besides the parsing table entries.
+ */
+using Scope = std::unordered_map<std::string, std::shared_ptr<calculation::Variable>>;
+
+/*
+ * Same as above, but names found in the scope are parsed as references to
+ * its variables.
+ */
+std::shared_ptr<calculation::Operand> parse_expression(const std::string &string, const Scope &scope, size_t start = 0);
+
+/*
+ * Same as above, but the names are taken from the given symbol table
+ * instead of the global one, usually a snapshot of a ParsingContext.
+ */
+std::shared_ptr<calculation::Operand> parse_expression(const std::string &string, const SymbolTable &table, size_t start = 0);
+std::shared_ptr<calculation::Operand> parse_expression(const std::string &string, const SymbolTable &table, const Scope &scope, size_t start = 0);
+
 }   // namespace infix_parsing
 
 #endif  // PARSING_HH
@@ -0,0 +1,84 @@
+#pragma once
+#ifndef POSTFIX_MACHINE_HH
+#define POSTFIX_MACHINE_HH
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace calculation {
+
+/*
+ * Stack machine that evaluates calculation trees flattened into postfix
+ * order. Formats that store trees so describe their nodes through a
+ * program class with
+ *
+ *     Step step(size_t i) const                     kind of the i-th node
+ *     double value(size_t i) const                  value a push node pushes
+ *     double apply(size_t i, double x) const        unary node's function
+ *     double apply(size_t i, double x, double y) const
+ *
+ * Stacks up to local_stack_size values deep live in the caller's frame,
+ * deeper ones are allocated for the call.
+ */
+class PostfixMachine {
+public:
+    enum Step {
+        push = 0,
+        unary = 1,
+        binary = 2,
+    };
+
+    static const size_t local_stack_size = 64;
+
+    PostfixMachine() = delete;
+    PostfixMachine(const PostfixMachine &) = delete;
+    PostfixMachine(PostfixMachine &&) = delete;
+
+    /*
+     * Runs the nodes from 0 to length - 1, max_stack is the deepest the
+     * stack gets. The program is trusted to be balanced, but an empty
+     * one has no value and is rejected.
+     */
+    template <typename Program>
+    static double run(const Program &program, size_t length, size_t max_stack);
+private:
+    ~PostfixMachine() = default;
+};
+
+
+template <typename Program>
+double PostfixMachine::run(const Program &program, size_t length, size_t max_stack)
+{
+    if (length == 0)
+        throw std::invalid_argument("Program is empty.");
+
+    double local[local_stack_size];
+    std::vector<double> heap;
+    double *stack = local;
+    if (max_stack > local_stack_size) {
+        heap.resize(max_stack);
+        stack = heap.data();
+    }
+
+    size_t top = 0;
+    for (size_t i = 0; i < length; ++i) {
+        switch (program.step(i)) {
+        case push:
+            stack[top++] = program.value(i);
+            break;
+        case unary:
+            stack[top - 1] = program.apply(i, stack[top - 1]);
+            break;
+        case binary:
+            --top;
+            stack[top - 1] = program.apply(i, stack[top - 1], stack[top]);
+            break;
+        }
+    }
+    return stack[top - 1];
+}
+
+}   // namespace calculation
+
+#endif  // POSTFIX_MACHINE_HH
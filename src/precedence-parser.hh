@@ -0,0 +1,222 @@
+#pragma once
+#ifndef PRECEDENCE_PARSER_HH
+#define PRECEDENCE_PARSER_HH
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "parsing-exceptions.hh"
+#include "parsing-table.hh"
+#include "scanner.hh"
+
+namespace infix_parsing {
+
+/*
+ * Operator waiting on the stack of a PrecedenceParser for its operands.
+ */
+struct PendingOperator {
+    enum Kind : uint8_t {
+        unary,
+        binary,
+        parenthesis,
+    };
+
+    Kind kind;
+    const calculation::UnaryOperator::Descriptor *unary_op;
+    const calculation::BinaryOperator::Descriptor *binary_op;
+};
+
+
+/*
+ * Operator precedence parser for the readers that don't build a
+ * calculation tree. It reads an expression the same way
+ * parse_expression() does and hands it to the sink in postfix order.
+ *
+ * The source gives the text:
+ *
+ *     bool at_end()               whether the input is over
+ *     void skip_spaces()
+ *     char peek()                 the next character, if there is one
+ *     void advance(size_t n)
+ *     size_t position()           of the next character, for errors
+ *     const char *lookahead(size_t &n)
+ *                                 the next n characters, n is cut to what
+ *                                 the input has left
+ *     double number()             reads the number at the position
+ *     const calculation::Variable *match_variable()
+ *                                 reads a variable or returns null
+ *
+ * The sink takes operands and operators once all of their operands are
+ * there:
+ *
+ *     void push_value(double value)
+ *     void push_variable(const calculation::Variable *variable)
+ *     void apply(const calculation::UnaryOperator::Descriptor *op)
+ *     void apply(const calculation::BinaryOperator::Descriptor *op)
+ *
+ * The operator stack and the buffer names are matched in belong to the
+ * caller, so they are reused between expressions. Errors are thrown as
+ * the parser's exceptions.
+ */
+template<typename Source, typename Sink>
+class PrecedenceParser {
+public:
+    PrecedenceParser(const SymbolTable &table, Source &source, Sink &sink,
+                     std::vector<PendingOperator> &pending, std::string &name)
+        : table_(table), source_(source), sink_(sink), pending_(pending), name_(name)
+    {}
+    PrecedenceParser(const PrecedenceParser &) = delete;
+
+    /*
+     * Reads the whole input, returns false if it's empty.
+     */
+    bool run();
+private:
+    /*
+     * Looks for the shortest name of the kind at the position and leaves
+     * it in the name buffer.
+     */
+    bool match(bool (SymbolTable::*is)(const std::string &) const);
+
+    void apply_unary();
+    /*
+     * Applies the pending binary operators that bind at least as tight
+     * as the order.
+     */
+    void reduce(unsigned order);
+
+    const SymbolTable &table_;
+    Source &source_;
+    Sink &sink_;
+    std::vector<PendingOperator> &pending_;
+    std::string &name_;
+};
+
+
+template<typename Source, typename Sink>
+bool PrecedenceParser<Source, Sink>::run()
+{
+    pending_.clear();
+    // The same as an empty string
+    if (source_.at_end())
+        return false;
+
+    bool operand = true;
+    for (;;) {
+        source_.skip_spaces();
+        const bool more = !source_.at_end();
+        if (operand) {
+            if (!more)
+                throw OperandExpectationUnsatisfied(source_.position());
+            const char c = source_.peek();
+            if (c == '(') {
+                source_.advance(1);
+                // Empty parentheses are a zero for the parser
+                if (!source_.at_end() && source_.peek() == ')') {
+                    source_.advance(1);
+                    sink_.push_value(0);
+                    apply_unary();
+                    operand = false;
+                } else {
+                    pending_.push_back({PendingOperator::parenthesis, nullptr, nullptr});
+                }
+                continue;
+            }
+            if (Scanner::is_digit(c)) {
+                sink_.push_value(source_.number());
+                apply_unary();
+                operand = false;
+                continue;
+            }
+            // Variables shadow table entries with the same prefix
+            const calculation::Variable *variable = source_.match_variable();
+            if (variable) {
+                sink_.push_variable(variable);
+                apply_unary();
+                operand = false;
+                continue;
+            }
+            if (match(&SymbolTable::is_unary_operator)) {
+                pending_.push_back({PendingOperator::unary, table_.get_unary_descriptor(name_).get(), nullptr});
+                continue;
+            }
+            if (match(&SymbolTable::is_constant)) {
+                sink_.push_value(table_.get_constant_value(name_));
+                apply_unary();
+                operand = false;
+                continue;
+            }
+            throw OperandExpectationUnsatisfied(source_.position());
+        }
+
+        if (!more)
+            break;
+        if (source_.peek() == ')') {
+            reduce(UINT_MAX);
+            if (pending_.empty())
+                throw SyntaxError("Unmatched closing parenthesis.", source_.position());
+            pending_.pop_back();
+            source_.advance(1);
+            apply_unary();
+            continue;
+        }
+        if (!match(&SymbolTable::is_binary_operator))
+            throw BinaryExpectationUnsatisfied(source_.position());
+        const calculation::BinaryOperator::Descriptor *op = table_.get_binary_descriptor(name_).get();
+        reduce(op->order);
+        pending_.push_back({PendingOperator::binary, nullptr, op});
+        operand = true;
+    }
+
+    reduce(UINT_MAX);
+    if (!pending_.empty())
+        throw UnexpectedEndOfExpression(source_.position());
+    return true;
+}
+
+
+template<typename Source, typename Sink>
+bool PrecedenceParser<Source, Sink>::match(bool (SymbolTable::*is)(const std::string &) const)
+{
+    size_t available = table_.longest_name();
+    const char *text = source_.lookahead(available);
+    for (size_t n = 1; n <= available; ++n) {
+        // Names never contain spaces
+        if (!Scanner::is_graph(text[n - 1]))
+            return false;
+        name_.assign(text, n);
+        if ((table_.*is)(name_)) {
+            source_.advance(n);
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename Source, typename Sink>
+void PrecedenceParser<Source, Sink>::apply_unary()
+{
+    while (!pending_.empty() && pending_.back().kind == PendingOperator::unary) {
+        sink_.apply(pending_.back().unary_op);
+        pending_.pop_back();
+    }
+}
+
+template<typename Source, typename Sink>
+void PrecedenceParser<Source, Sink>::reduce(unsigned order)
+{
+    while (!pending_.empty() && pending_.back().kind == PendingOperator::binary
+           && pending_.back().binary_op->order <= order) {
+        const calculation::BinaryOperator::Descriptor *op = pending_.back().binary_op;
+        pending_.pop_back();
+        sink_.apply(op);
+    }
+}
+
+}   // namespace infix_parsing
+
+#endif  // PRECEDENCE_PARSER_HH
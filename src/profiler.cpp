@@ -0,0 +1,217 @@
+#include "profiler.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "calculation-tree.hh"
+#include "symbols.hh"
+
+namespace calculation {
+
+const size_t Profiler::max_label;
+const size_t Profiler::none;
+
+
+Profiler::Profiler(const Operand &tree, unsigned period)
+    : tree_(tree), period_(period), runs_(0), samples_(0)
+{
+    if (period == 0)
+        throw std::invalid_argument("Sampling period cannot be zero.");
+    add_operand(tree, none, 0);
+
+    // The cheapest of a few back to back readings is what timing an
+    // operand adds to its operator
+    overhead_ = UINT64_MAX;
+    for (int i = 0; i < 64; ++i) {
+        const uint64_t begin = ticks();
+        overhead_ = std::min(overhead_, ticks() - begin);
+    }
+}
+
+size_t Profiler::add_operand(const Operand &operand, size_t parent, size_t depth)
+{
+    if (const Expression *expression = dynamic_cast<const Expression *>(&operand)) {
+        const std::shared_ptr<Operator> root = expression->get_root();
+        if (!root)
+            throw std::logic_error("Profiling empty expression.");
+        return add_operator(*root, parent, depth);
+    }
+    Frame frame = {Frame::leaf, &operand, nullptr, nullptr, parent, depth, {none, none}, std::string(), 0};
+    frames_.push_back(frame);
+    return frames_.size() - 1;
+}
+
+size_t Profiler::add_operator(const Operator &op, size_t parent, size_t depth)
+{
+    Frame frame = {Frame::leaf, nullptr, nullptr, nullptr, parent, depth, {none, none}, op.str(), 0};
+    // Semicolons separate frames in the collapsed format
+    std::replace(frame.label.begin(), frame.label.end(), ';', ':');
+    if (frame.label.size() > max_label) {
+        frame.label.resize(max_label - 3);
+        frame.label += "...";
+    }
+
+    const size_t i = frames_.size();
+    if (const UnaryOperator *unary = dynamic_cast<const UnaryOperator *>(&op)) {
+        if (!unary->get_operand())
+            throw std::logic_error("Profiling operator with no operand.");
+        frame.kind = Frame::unary;
+        frame.unary_op = unary;
+        frames_.push_back(frame);
+        // Adding the operands moves the frames, the index is taken after
+        const size_t operand = add_operand(*unary->get_operand(), i, depth + 1);
+        frames_[i].children[0] = operand;
+    } else if (const BinaryOperator *binary = dynamic_cast<const BinaryOperator *>(&op)) {
+        if (!binary->get_left() || !binary->get_right())
+            throw std::logic_error("Profiling operator with no operands.");
+        frame.kind = Frame::binary;
+        frame.binary_op = binary;
+        frames_.push_back(frame);
+        const size_t left = add_operand(*binary->get_left(), i, depth + 1);
+        frames_[i].children[0] = left;
+        const size_t right = add_operand(*binary->get_right(), i, depth + 1);
+        frames_[i].children[1] = right;
+    } else {
+        throw std::logic_error("Profiling unknown operator.");
+    }
+    return i;
+}
+
+
+uint64_t Profiler::ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+double Profiler::evaluate()
+{
+    if (runs_++ % period_ != 0)
+        return tree_.evaluate();
+    ++samples_;
+    return run(0);
+}
+
+double Profiler::run(size_t i)
+{
+    Frame &frame = frames_[i];
+    if (frame.kind == Frame::leaf)
+        return frame.operand->evaluate();
+    const uint64_t begin = ticks();
+    double res;
+    if (frame.kind == Frame::unary) {
+        res = frame.unary_op->apply(run(frame.children[0]));
+    } else {
+        const double left = run(frame.children[0]);
+        res = frame.binary_op->apply(left, run(frame.children[1]));
+    }
+    frame.ticks += ticks() - begin;
+    return res;
+}
+
+
+uint64_t Profiler::scale(uint64_t ticks) const
+{
+    if (samples_ == 0)
+        return 0;
+    return uint64_t(double(ticks) * runs_ / samples_);
+}
+
+uint64_t Profiler::self_ticks(const Frame &frame) const
+{
+    uint64_t operands = 0;
+    for (size_t child : frame.children) {
+        if (child != none && frames_[child].kind != Frame::leaf)
+            operands += frames_[child].ticks + overhead_ * samples_;
+    }
+    // Operand intervals lie inside the operator's, only the overhead
+    // estimate may take more than there is
+    return frame.ticks > operands ? frame.ticks - operands : 0;
+}
+
+
+std::vector<Profiler::Symbol> Profiler::symbols() const
+{
+    std::map<Symbols::Id, Symbol> by_name;
+    for (const Frame &frame : frames_) {
+        if (frame.kind == Frame::leaf)
+            continue;
+        const Symbols::Id name = frame.kind == Frame::unary ? frame.unary_op->name() : frame.binary_op->name();
+        Symbol &symbol = by_name.insert({name, {name, 0, 0}}).first->second;
+        symbol.calls += runs_;
+        symbol.ticks += self_ticks(frame);
+    }
+    std::vector<Symbol> res;
+    for (auto &entry : by_name) {
+        entry.second.ticks = scale(entry.second.ticks);
+        res.push_back(entry.second);
+    }
+    std::stable_sort(res.begin(), res.end(), [](const Symbol &a, const Symbol &b) { return a.ticks > b.ticks; });
+    return res;
+}
+
+std::vector<Profiler::Subtree> Profiler::subtrees() const
+{
+    std::vector<Subtree> res;
+    for (const Frame &frame : frames_) {
+        if (frame.kind != Frame::leaf)
+            res.push_back({frame.label, frame.depth, runs_, scale(frame.ticks), scale(self_ticks(frame))});
+    }
+    return res;
+}
+
+
+void Profiler::write_collapsed(std::ostream &out) const
+{
+    std::vector<size_t> stack;
+    for (size_t i = 0; i < frames_.size(); ++i) {
+        const Frame &frame = frames_[i];
+        if (frame.kind == Frame::leaf)
+            continue;
+        const uint64_t self = scale(self_ticks(frame));
+        if (self == 0)
+            continue;
+        stack.clear();
+        for (size_t f = i; f != none; f = frames_[f].parent)
+            stack.push_back(f);
+        for (size_t k = stack.size(); k-- > 0;)
+            out << frames_[stack[k]].label << (k ? ";" : " ");
+        out << self << '\n';
+    }
+}
+
+void Profiler::write_report(std::ostream &out) const
+{
+    const std::vector<Symbol> all = symbols();
+    uint64_t total = 0;
+    for (const Symbol &s : all)
+        total += s.ticks;
+
+    out << "runs " << runs_ << ", timed " << samples_ << '\n';
+    out << std::left << std::setw(12) << "symbol" << std::right
+        << std::setw(14) << "calls" << std::setw(16) << "ticks" << std::setw(8) << "share" << '\n';
+    for (const Symbol &s : all) {
+        const unsigned permille = total ? unsigned(s.ticks * 1000.0 / total + 0.5) : 0;
+        out << std::left << std::setw(12) << Symbols::name(s.name) << std::right
+            << std::setw(14) << s.calls << std::setw(16) << s.ticks
+            << std::setw(6) << permille / 10 << '.' << permille % 10 << "%\n";
+    }
+}
+
+}   // namespace calculation
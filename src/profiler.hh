@@ -0,0 +1,131 @@
+#pragma once
+#ifndef PROFILER_HH
+#define PROFILER_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "symbols.hh"
+
+namespace calculation {
+
+/*
+ * Profiler evaluates a calculation tree over and over and attributes the
+ * time to its operators. Every operator node is a frame, named after
+ * the str() of its subtree; constants and variables are counted in the
+ * frame of their operator.
+ *
+ * Timestamps cost more than most operators, so only every period-th
+ * evaluation is timed, node by node, with the time stamp counter where
+ * there is one. The others run through the tree's own evaluate(). Times
+ * are reported in ticks of that counter, scaled up to all evaluations,
+ * less the cost of timing the operands.
+ *
+ * The tree is walked once on construction, it has to outlive the
+ * profiler and keep its shape.
+ */
+class Profiler {
+public:
+    /*
+     * Longest frame name, longer subtrees are cut with "...".
+     */
+    static const size_t max_label = 64;
+
+    /*
+     * Time spent in operators of one symbol.
+     */
+    struct Symbol {
+        Symbols::Id name;
+        uint64_t calls;
+        uint64_t ticks;
+    };
+
+    /*
+     * Time spent in one operator node, with and without its operands.
+     */
+    struct Subtree {
+        std::string label;
+        size_t depth;
+        uint64_t calls;
+        uint64_t ticks;
+        uint64_t self_ticks;
+    };
+
+    explicit Profiler(const Operand &tree, unsigned period = 16);
+    Profiler(const Profiler &) = delete;
+
+    double evaluate();
+
+    uint64_t runs() const { return runs_; }
+    uint64_t samples() const { return samples_; }
+
+    /*
+     * Symbols by the time spent in them, most expensive first.
+     */
+    std::vector<Symbol> symbols() const;
+    /*
+     * Operator nodes of the tree in prefix order.
+     */
+    std::vector<Subtree> subtrees() const;
+
+    /*
+     * Writes a line per frame with the frames above it, separated by
+     * semicolons, and its own ticks: the collapsed stacks that
+     * flamegraph.pl and speedscope read.
+     */
+    void write_collapsed(std::ostream &out) const;
+    /*
+     * Writes a table of symbols.
+     */
+    void write_report(std::ostream &out) const;
+
+    /*
+     * The clock, in ticks of the time stamp counter or in nanoseconds.
+     */
+    static uint64_t ticks();
+private:
+    struct Frame {
+        enum Kind {
+            leaf,
+            unary,
+            binary,
+        };
+
+        Kind kind;
+        const Operand *operand;
+        const UnaryOperator *unary_op;
+        const BinaryOperator *binary_op;
+        size_t parent;
+        size_t depth;
+        size_t children[2];
+        std::string label;
+        // Sum over the timed evaluations, with the operands
+        uint64_t ticks;
+    };
+
+    static const size_t none = size_t(-1);
+
+    size_t add_operand(const Operand &operand, size_t parent, size_t depth);
+    size_t add_operator(const Operator &op, size_t parent, size_t depth);
+
+    double run(size_t frame);
+
+    uint64_t scale(uint64_t ticks) const;
+    uint64_t self_ticks(const Frame &frame) const;
+
+    const Operand &tree_;
+    const unsigned period_;
+    // Ticks that reading the clock takes
+    uint64_t overhead_;
+    std::vector<Frame> frames_;
+    uint64_t runs_;
+    uint64_t samples_;
+};
+
+}   // namespace calculation
+
+#endif  // PROFILER_HH
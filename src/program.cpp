@@ -0,0 +1,235 @@
+#include "program.hh"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "parsing-exceptions.hh"
+#include "parsing-table.hh"
+#include "scanner.hh"
+
+namespace infix_parsing {
+
+using calculation::Operand;
+using calculation::Variable;
+using calculation::Expression;
+
+using calculation::Operator;
+using calculation::UnaryOperator;
+using calculation::BinaryOperator;
+
+namespace {
+
+bool is_statement_end(char c)
+{
+    return c == ';' || c == '\n';
+}
+
+bool is_variable_name(const std::string &name)
+{
+    if (!ParsingTable::is_valid_name(name))
+        return false;
+    for (auto c : name) {
+        if (!Scanner::is_identifier(c))
+            return false;
+    }
+    return true;
+}
+
+bool is_table_name(const std::string &name, const SymbolTable &table)
+{
+    return table.is_constant(name)
+        || table.is_unary_operator(name)
+        || table.is_binary_operator(name);
+}
+
+
+void collect_variables(const std::shared_ptr<Operand> &operand, std::vector<const Variable *> &found);
+
+void collect_variables(const std::shared_ptr<Operator> &op, std::vector<const Variable *> &found)
+{
+    std::shared_ptr<UnaryOperator> unary = std::dynamic_pointer_cast<UnaryOperator>(op);
+    if (unary) {
+        collect_variables(unary->get_operand(), found);
+        return;
+    }
+    std::shared_ptr<BinaryOperator> binary = std::dynamic_pointer_cast<BinaryOperator>(op);
+    if (binary) {
+        collect_variables(binary->get_left(), found);
+        collect_variables(binary->get_right(), found);
+    }
+}
+
+void collect_variables(const std::shared_ptr<Operand> &operand, std::vector<const Variable *> &found)
+{
+    const Variable *var = dynamic_cast<const Variable *>(operand.get());
+    if (var) {
+        found.push_back(var);
+        return;
+    }
+    std::shared_ptr<Expression> exp = std::dynamic_pointer_cast<Expression>(operand);
+    if (exp && exp->get_root())
+        collect_variables(exp->get_root(), found);
+}
+
+}   // namespace
+
+
+void Program::evaluate()
+{
+    for (auto i : schedule_) {
+        Statement &st = statements_[i];
+        st.variable->set_value(st.expression->evaluate());
+    }
+}
+
+void Program::evaluate(concurrency::ThreadPool &pool)
+{
+    const size_t n = statements_.size();
+    std::unique_ptr<std::atomic<size_t>[]> pending(new std::atomic<size_t>[n]);
+    for (size_t i = 0; i < n; ++i)
+        pending[i].store(statements_[i].dependencies.size());
+
+    /*
+     * A statement is submitted by the one which finished its last
+     * dependency, so its operands are always ready when it runs.
+     */
+    std::function<void(size_t)> run = [&](size_t i) {
+        Statement &st = statements_[i];
+        st.variable->set_value(st.expression->evaluate());
+        for (auto d : st.dependents) {
+            if (pending[d].fetch_sub(1) == 1)
+                pool.submit([&run, d] { run(d); });
+        }
+    };
+    for (size_t i = 0; i < n; ++i) {
+        if (statements_[i].dependencies.empty())
+            pool.submit([&run, i] { run(i); });
+    }
+    pool.wait();
+}
+
+
+double Program::value(const std::string &name) const
+{
+    Scope::const_iterator it = scope_.find(name);
+    if (it == scope_.end())
+        throw ParsingTable::NameSearchError(name);
+    return it->second->evaluate();
+}
+
+
+std::shared_ptr<Program> parse_program(const std::string &string, const ParsingContext &context)
+{
+    const size_t len = string.length();
+    std::shared_ptr<const SymbolTable> table = context.snapshot();
+    std::shared_ptr<Program> res(new Program);
+    std::vector<Program::Statement> &statements = res->statements_;
+    // Positions of the assignment signs
+    std::vector<size_t> assignments;
+
+    size_t begin = 0;
+    while (begin < len) {
+        size_t end = begin;
+        while (end < len && !is_statement_end(string[end]))
+            ++end;
+        size_t pos = begin;
+        while (pos < end && Scanner::is_space(string[pos]))
+            ++pos;
+        if (pos == end) {
+            begin = end + 1;
+            continue;
+        }
+
+        size_t eq = string.find('=', pos);
+        if (eq >= end)
+            throw AssignmentExpectationUnsatisfied(pos);
+        size_t name_end = eq;
+        while (name_end > pos && Scanner::is_space(string[name_end - 1]))
+            --name_end;
+        std::string name(string, pos, name_end - pos);
+        if (!is_variable_name(name))
+            throw SyntaxError("Invalid variable name.", pos);
+        if (is_table_name(name, *table) || res->scope_.count(name))
+            throw NameRedefinition(pos);
+
+        Program::Statement st;
+        st.name = name;
+        st.variable = std::make_shared<Variable>(name);
+        st.position = pos;
+        res->scope_.emplace(name, st.variable);
+        statements.push_back(st);
+        assignments.push_back(eq);
+        begin = end + 1;
+    }
+
+    std::unordered_map<const Variable *, size_t> index;
+    for (size_t i = 0; i < statements.size(); ++i)
+        index.emplace(statements[i].variable.get(), i);
+
+    for (size_t i = 0; i < statements.size(); ++i) {
+        Program::Statement &st = statements[i];
+        const size_t from = assignments[i] + 1;
+        size_t to = from;
+        while (to < len && !is_statement_end(string[to]))
+            ++to;
+        std::string text(string, from, to - from);
+        size_t first = 0;
+        while (first < text.length() && Scanner::is_space(text[first]))
+            ++first;
+        if (first == text.length())
+            throw OperandExpectationUnsatisfied(from + first);
+        try {
+            st.expression = parse_expression(text, *table, res->scope_);
+        } catch (ParserError &e) {
+            // Restoring absolute position in the program and re-throwing
+            e.position += from;
+            throw;
+        }
+
+        std::vector<const Variable *> found;
+        collect_variables(st.expression, found);
+        for (auto var : found) {
+            size_t dep = index.at(var);
+            bool known = false;
+            for (auto d : st.dependencies)
+                known = known || d == dep;
+            if (!known) {
+                st.dependencies.push_back(dep);
+                statements[dep].dependents.push_back(i);
+            }
+        }
+    }
+
+    // Kahn's algorithm, statements left unscheduled are on a cycle
+    std::vector<size_t> pending(statements.size());
+    std::queue<size_t> ready;
+    for (size_t i = 0; i < statements.size(); ++i) {
+        pending[i] = statements[i].dependencies.size();
+        if (pending[i] == 0)
+            ready.push(i);
+    }
+    while (!ready.empty()) {
+        size_t i = ready.front();
+        ready.pop();
+        res->schedule_.push_back(i);
+        for (auto d : statements[i].dependents) {
+            if (--pending[d] == 0)
+                ready.push(d);
+        }
+    }
+    if (res->schedule_.size() != statements.size()) {
+        for (size_t i = 0; i < statements.size(); ++i) {
+            if (pending[i] != 0)
+                throw CyclicDependency(statements[i].position);
+        }
+    }
+    return res;
+}
+
+}   // namespace infix_parsing
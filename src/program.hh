@@ -0,0 +1,84 @@
+#pragma once
+#ifndef PROGRAM_HH
+#define PROGRAM_HH
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "parsing.hh"
+#include "parsing-table.hh"
+#include "thread-pool.hh"
+
+namespace infix_parsing {
+
+/*
+ * Program is a sequence of named assignments separated by semicolons or
+ * line breaks:
+ *
+ *     a = 2; b = a * 2; c = sin(a) + b
+ *
+ * A statement may refer to any other statement of the program, no matter
+ * where it's defined, as long as there are no cycles. Statements are
+ * evaluated in a topological order, so each one is calculated once.
+ */
+class Program {
+public:
+    struct Statement;
+
+    Program(const Program &) = delete;
+    Program(Program &&) = default;
+
+    size_t size() const { return statements_.size(); }
+    const Statement &at(size_t i) const { return statements_.at(i); }
+
+    /*
+     * Indices of statements in the order they can be evaluated.
+     */
+    const std::vector<size_t> &schedule() const { return schedule_; }
+
+    /*
+     * Evaluates statements one by one following the schedule.
+     */
+    void evaluate();
+    /*
+     * Evaluates independent statements concurrently on the pool.
+     */
+    void evaluate(concurrency::ThreadPool &pool);
+
+    double value(const std::string &name) const;
+
+    friend std::shared_ptr<Program> parse_program(const std::string &string, const ParsingContext &context);
+private:
+    Program() = default;
+
+    std::vector<Statement> statements_;
+    std::vector<size_t> schedule_;
+    Scope scope_;
+};
+
+
+struct Program::Statement {
+    std::string name;
+    std::shared_ptr<calculation::Variable> variable;
+    std::shared_ptr<calculation::Operand> expression;
+    // Position of the statement name in the program text
+    size_t position;
+
+    std::vector<size_t> dependencies;
+    std::vector<size_t> dependents;
+};
+
+
+/*
+ * Parses the program and builds the dependency graph between statements.
+ * All statements are parsed against the same snapshot of the context.
+ * ParserError positions are absolute in the program text.
+ */
+std::shared_ptr<Program> parse_program(const std::string &string, const ParsingContext &context = ParsingContext::global());
+
+}   // namespace infix_parsing
+
+#endif  // PROGRAM_HH
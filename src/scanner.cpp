@@ -0,0 +1,152 @@
+#include "scanner.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace infix_parsing {
+
+namespace {
+
+const uint8_t S = Scanner::space;
+const uint8_t D = Scanner::digit | Scanner::graph;
+const uint8_t P = Scanner::point | Scanner::graph;
+const uint8_t L = Scanner::letter | Scanner::graph;
+const uint8_t G = Scanner::graph;
+
+#if defined(__SSE2__)
+
+const size_t block = 16;
+
+/*
+ * Bytes of v in the unsigned range [low, high].
+ */
+inline __m128i in_range(__m128i v, char low, char high)
+{
+    const __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8(low));
+    const __m128i limit = _mm_set1_epi8(char(high - low));
+    return _mm_cmpeq_epi8(_mm_min_epu8(shifted, limit), shifted);
+}
+
+inline __m128i spaces(__m128i v)
+{
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), in_range(v, '\t', '\r'));
+}
+
+inline __m128i numbers(__m128i v)
+{
+    return _mm_or_si128(in_range(v, '0', '9'), _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+}
+
+inline __m128i identifiers(__m128i v)
+{
+    // Setting bit 5 maps upper case letters onto lower case ones
+    const __m128i letters = in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+    const __m128i rest = _mm_or_si128(in_range(v, '0', '9'), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    return _mm_or_si128(letters, rest);
+}
+
+/*
+ * Skips whole blocks of the class, stops at the block with the first byte
+ * out of it or where less than a block is left.
+ */
+template <__m128i (*Match)(__m128i)>
+inline const char *skip_blocks(const char *begin, const char *end)
+{
+    while (size_t(end - begin) >= block) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        const unsigned mask = unsigned(_mm_movemask_epi8(Match(v))) ^ 0xffff;
+        if (mask)
+            return begin + __builtin_ctz(mask);
+        begin += block;
+    }
+    return begin;
+}
+
+#endif
+
+}   // namespace
+
+
+const uint8_t Scanner::classes_[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, S, S, S, S, S, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    S, G, G, G, G, G, G, G, G, G, G, G, G, G, P|G, G,
+    D|G, D|G, D|G, D|G, D|G, D|G, D|G, D|G, D|G, D|G, G, G, G, G, G, G,
+    G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G,
+    L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, G, G, G, G, L|G,
+    G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G,
+    L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, L|G, G, G, G, G, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+
+const char *Scanner::skip_scalar(const char *begin, const char *end, uint8_t classes)
+{
+    while (begin != end && is(*begin, classes))
+        ++begin;
+    return begin;
+}
+
+const char *Scanner::skip_spaces_scalar(const char *begin, const char *end)
+{
+    return skip_scalar(begin, end, space);
+}
+
+const char *Scanner::skip_number_scalar(const char *begin, const char *end)
+{
+    return skip_scalar(begin, end, digit | point);
+}
+
+const char *Scanner::skip_identifier_scalar(const char *begin, const char *end)
+{
+    return skip_scalar(begin, end, letter | digit);
+}
+
+
+/*
+ * Runs in expressions are mostly a byte or two long, so the first byte is
+ * checked before going wide.
+ */
+
+const char *Scanner::skip_spaces(const char *begin, const char *end)
+{
+    if (begin == end || !is_space(*begin))
+        return begin;
+#if defined(__SSE2__)
+    begin = skip_blocks<spaces>(begin, end);
+#endif
+    return skip_scalar(begin, end, space);
+}
+
+const char *Scanner::skip_number(const char *begin, const char *end)
+{
+    if (begin == end || !is_number(*begin))
+        return begin;
+#if defined(__SSE2__)
+    begin = skip_blocks<numbers>(begin, end);
+#endif
+    return skip_scalar(begin, end, digit | point);
+}
+
+const char *Scanner::skip_identifier(const char *begin, const char *end)
+{
+    if (begin == end || !is_identifier(*begin))
+        return begin;
+#if defined(__SSE2__)
+    begin = skip_blocks<identifiers>(begin, end);
+#endif
+    return skip_scalar(begin, end, letter | digit);
+}
+
+}   // namespace infix_parsing
@@ -0,0 +1,64 @@
+#pragma once
+#ifndef SCANNER_HH
+#define SCANNER_HH
+
+#include <cstddef>
+#include <cstdint>
+
+namespace infix_parsing {
+
+/*
+ * Character classes of the parser and scanners that skip runs of them.
+ * Classes are fixed ASCII sets, the same as the "C" locale's, and don't
+ * depend on the current locale.
+ *
+ * Where SSE2 is available runs are skipped 16 bytes at a time, the rest
+ * of the input and other targets go through a lookup table.
+ */
+class Scanner {
+public:
+    enum Class : uint8_t {
+        space = 1,      // ' ', '\t', '\n', '\v', '\f', '\r'
+        digit = 2,      // '0' to '9'
+        point = 4,      // '.'
+        letter = 8,     // 'a' to 'z', 'A' to 'Z', '_'
+        graph = 16,     // printable and not a space
+    };
+
+    Scanner() = delete;
+    Scanner(const Scanner &) = delete;
+    Scanner(Scanner &&) = delete;
+
+    static bool is(char c, uint8_t classes) { return classes_[uint8_t(c)] & classes; }
+
+    static bool is_space(char c) { return is(c, space); }
+    static bool is_digit(char c) { return is(c, digit); }
+    static bool is_number(char c) { return is(c, digit | point); }
+    static bool is_identifier(char c) { return is(c, letter | digit); }
+    static bool is_graph(char c) { return is(c, graph); }
+
+    /*
+     * Return the end of the run starting at begin, end if the run takes
+     * the whole range.
+     */
+    static const char *skip_spaces(const char *begin, const char *end);
+    static const char *skip_number(const char *begin, const char *end);
+    static const char *skip_identifier(const char *begin, const char *end);
+
+    /*
+     * Table only versions of the above, for the targets without SIMD.
+     */
+    static const char *skip_spaces_scalar(const char *begin, const char *end);
+    static const char *skip_number_scalar(const char *begin, const char *end);
+    static const char *skip_identifier_scalar(const char *begin, const char *end);
+private:
+    ~Scanner() = default;
+
+    static const char *skip_scalar(const char *begin, const char *end, uint8_t classes);
+
+    static const uint8_t classes_[256];
+};
+
+}   // namespace infix_parsing
+
+#endif  // SCANNER_HH
@@ -0,0 +1,200 @@
+#include "serializer.hh"
+
+#include <cstddef>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "numbers.hh"
+#include "symbols.hh"
+
+namespace calculation {
+
+namespace {
+
+/*
+ * Output is handed to streams in blocks of about this size.
+ */
+const size_t block_size = 64 * 1024;
+
+/*
+ * Returns the binary operator at the top of the operand, looking through
+ * expressions, or nullptr if the operand is not an operation on two
+ * operands.
+ */
+const BinaryOperator *binary_root(const Operand *operand)
+{
+    const Expression *exp = dynamic_cast<const Expression *>(operand);
+    if (!exp)
+        return nullptr;
+    // Unary operators bind tighter than any binary one
+    return dynamic_cast<const BinaryOperator *>(exp->get_root().get());
+}
+
+}   // namespace
+
+
+void Serializer::write(const Operand &operand, std::string &out)
+{
+    stack_.clear();
+    push(&operand);
+    run(out, nullptr);
+}
+
+void Serializer::write(const Operator &op, std::string &out)
+{
+    stack_.clear();
+    push(&op);
+    run(out, nullptr);
+}
+
+void Serializer::write(const Operand &operand, std::ostream &out)
+{
+    stack_.clear();
+    block_.clear();
+    push(&operand);
+    run(block_, &out);
+    out.write(block_.data(), block_.size());
+}
+
+std::string Serializer::str(const Operand &operand)
+{
+    std::string res;
+    write(operand, res);
+    return res;
+}
+
+std::string Serializer::str(const Operator &op)
+{
+    std::string res;
+    write(op, res);
+    return res;
+}
+
+
+void Serializer::push_text(const char *text)
+{
+    Item item;
+    item.kind = Item::text;
+    item.value.text = text;
+    stack_.push_back(item);
+}
+
+void Serializer::push_name(Symbols::Id name)
+{
+    Item item;
+    item.kind = Item::name;
+    item.value.name = name;
+    stack_.push_back(item);
+}
+
+void Serializer::push(const Operand *operand)
+{
+    if (!operand)
+        throw std::logic_error("Serializing operator with a missing operand.");
+    Item item;
+    item.kind = Item::operand;
+    item.value.operand = operand;
+    stack_.push_back(item);
+}
+
+void Serializer::push(const Operator *op)
+{
+    if (!op)
+        throw std::logic_error("Serializing empty expression.");
+    Item item;
+    item.kind = Item::op;
+    item.value.op = op;
+    stack_.push_back(item);
+}
+
+void Serializer::push_child(const Operand *operand, bool parenthesise)
+{
+    if (parenthesise)
+        push_text(")");
+    push(operand);
+    if (parenthesise)
+        push_text("(");
+}
+
+
+void Serializer::expand(const Operator *op)
+{
+    // Items are pushed in reverse, the last one is printed first
+    const UnaryOperator *unary = dynamic_cast<const UnaryOperator *>(op);
+    if (unary) {
+        const Operand *operand = unary->get_operand().get();
+        if (notation_ == infix)
+            push_child(operand, binary_root(operand));
+        else
+            push(operand);
+        push_text(" ");
+        push_name(unary->name());
+        return;
+    }
+    const BinaryOperator *binary = dynamic_cast<const BinaryOperator *>(op);
+    if (!binary)
+        throw std::invalid_argument("Unknown operator cannot be serialized.");
+    const Operand *left = binary->get_left().get();
+    const Operand *right = binary->get_right().get();
+    if (notation_ == infix) {
+        /*
+         * All the operators are left associative, so an operand of the
+         * same order needs parentheses on the right side only.
+         */
+        const BinaryOperator *l = binary_root(left);
+        const BinaryOperator *r = binary_root(right);
+        push_child(right, r && r->order() >= binary->order());
+        push_text(" ");
+        push_name(binary->name());
+        push_text(" ");
+        push_child(left, l && l->order() > binary->order());
+    } else {
+        push(right);
+        push_text(" ");
+        push(left);
+        push_text(" ");
+        push_name(binary->name());
+    }
+}
+
+
+void Serializer::run(std::string &out, std::ostream *stream)
+{
+    while (!stack_.empty()) {
+        Item item = stack_.back();
+        stack_.pop_back();
+        switch (item.kind) {
+        case Item::text:
+            out += item.value.text;
+            break;
+        case Item::name:
+            out += Symbols::name(item.value.name);
+            break;
+        case Item::operand: {
+            const Expression *exp = dynamic_cast<const Expression *>(item.value.operand);
+            const Constant *constant = dynamic_cast<const Constant *>(item.value.operand);
+            if (exp) {
+                push(exp->get_root().get());
+            } else if (constant && constant->name() == Symbols::none) {
+                char buffer[Numbers::max_length];
+                out.append(buffer, Numbers::format(constant->evaluate(), buffer));
+            } else {
+                out += item.value.operand->str();
+            }
+            break;
+        }
+        case Item::op:
+            expand(item.value.op);
+            break;
+        }
+        if (stream && out.size() >= block_size) {
+            stream->write(out.data(), out.size());
+            out.clear();
+        }
+    }
+}
+
+}   // namespace calculation
@@ -0,0 +1,94 @@
+#pragma once
+#ifndef SERIALIZER_HH
+#define SERIALIZER_HH
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "symbols.hh"
+
+namespace calculation {
+
+/*
+ * Serializer prints calculation trees into a single output buffer. Trees
+ * are walked with an explicit stack, so printing takes time linear in the
+ * size of the output and doesn't depend on the depth of the tree.
+ *
+ * Two notations are supported:
+ *
+ *     prefix  the one used by str(), "+ 1 * 2 3"
+ *     infix   readable by the parser, "1 + 2 * 3", with parentheses only
+ *             where they are needed to keep the tree's shape
+ *
+ * A serializer keeps its stack between calls, so reusing one object and
+ * one output string doesn't allocate in the steady state.
+ */
+class Serializer {
+public:
+    enum Notation {
+        prefix,
+        infix,
+    };
+
+    explicit Serializer(Notation notation = prefix) : notation_(notation) {}
+
+    Notation notation() const { return notation_; }
+
+    /*
+     * Appends the tree to the string.
+     */
+    void write(const Operand &operand, std::string &out);
+    void write(const Operator &op, std::string &out);
+    /*
+     * Writes the tree to the stream in large blocks.
+     */
+    void write(const Operand &operand, std::ostream &out);
+
+    std::string str(const Operand &operand);
+    std::string str(const Operator &op);
+private:
+    struct Item {
+        enum Kind {
+            text,
+            name,
+            operand,
+            op,
+        };
+
+        Kind kind;
+        union {
+            const char *text;
+            Symbols::Id name;
+            const Operand *operand;
+            const Operator *op;
+        } value;
+    };
+
+    void push_text(const char *text);
+    void push_name(Symbols::Id name);
+    void push(const Operand *operand);
+    void push(const Operator *op);
+    /*
+     * Pushes a child of an operator, in parentheses if it binds weaker
+     * than the operator allows.
+     */
+    void push_child(const Operand *operand, bool parenthesise);
+
+    void expand(const Operator *op);
+    /*
+     * Runs the stack until it is empty, flushing the output into the
+     * stream whenever it grows past the block size.
+     */
+    void run(std::string &out, std::ostream *stream);
+
+    Notation notation_;
+    std::vector<Item> stack_;
+    std::string block_;
+};
+
+}   // namespace calculation
+
+#endif  // SERIALIZER_HH
@@ -0,0 +1,616 @@
+#include "server.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "parsing.hh"
+#include "parsing-exceptions.hh"
+
+namespace server {
+
+using calculation::Operand;
+using calculation::Variable;
+using protocol::Header;
+
+
+struct Server::Formula {
+    std::shared_ptr<Operand> tree;
+    std::vector<std::shared_ptr<Variable>> inputs;
+};
+
+struct Server::Connection {
+    Connection(int fd, std::atomic<size_t> &formula_count)
+        : fd(fd), written(0), busy(false), hung_up(false), writing(false), formula_count(formula_count)
+    {}
+    // Workers may hold a closed connection, its formulas go with the last
+    ~Connection() { formula_count -= formulas.size(); }
+
+    int fd;
+    // Received, not handled yet
+    std::string in;
+    // Requests being handled by a worker and their responses
+    std::string batch;
+    std::string results;
+    // Responses waiting to be sent
+    std::string out;
+    size_t written;
+
+    bool busy;
+    bool hung_up;
+    bool writing;
+
+    // Used by the worker handling the connection's batch only
+    std::vector<Formula> formulas;
+    std::atomic<size_t> &formula_count;
+};
+
+
+namespace {
+
+// A connection stops getting batches while this much is left unsent
+const size_t max_unsent = 4 << 20;
+
+[[noreturn]] void throw_errno(const char *what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+sockaddr_un socket_address(const std::string &path)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("Socket path \"" + path + "\" is too long.");
+    std::memcpy(address.sun_path, path.data(), path.size());
+    return address;
+}
+
+template<typename T>
+void append(std::string &out, const T &value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+/*
+ * Reads a payload field by field, running out of it is a bad request.
+ */
+class Reader {
+public:
+    Reader(const char *data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+    template<typename T>
+    T get()
+    {
+        T res;
+        std::memcpy(&res, take(sizeof(T)), sizeof(T));
+        return res;
+    }
+    const char *take(size_t n)
+    {
+        if (size_ - pos_ < n)
+            throw std::invalid_argument("Request is truncated.");
+        const char *res = data_ + pos_;
+        pos_ += n;
+        return res;
+    }
+    size_t left() const { return size_ - pos_; }
+private:
+    const char *data_;
+    size_t size_;
+    size_t pos_;
+};
+
+}   // namespace
+
+
+Server::Server(const std::string &path, size_t threads, const infix_parsing::ParsingContext &context)
+    : path_(path), context_(context), listener_(-1), epoll_(-1), wakeup_(-1), stopping_(false),
+      formula_count_(0), cache_(64 << 20, 16, context), pool_(threads)
+{
+    const sockaddr_un address = socket_address(path);
+    try {
+        listener_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listener_ < 0)
+            throw_errno("Cannot create the socket");
+        if (::bind(listener_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+            throw_errno(("Cannot bind \"" + path + "\"").c_str());
+        if (::listen(listener_, SOMAXCONN) != 0)
+            throw_errno("Cannot listen");
+
+        epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+        wakeup_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_ < 0 || wakeup_ < 0)
+            throw_errno("Cannot create the event loop");
+        for (int fd : {listener_, wakeup_}) {
+            epoll_event event;
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            if (::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) != 0)
+                throw_errno("Cannot create the event loop");
+        }
+    } catch (...) {
+        for (int fd : {listener_, epoll_, wakeup_}) {
+            if (fd >= 0)
+                ::close(fd);
+        }
+        if (listener_ >= 0)
+            ::unlink(path.c_str());
+        throw;
+    }
+}
+
+Server::~Server()
+{
+    // Workers refer to the connections and the wakeup descriptor
+    pool_.wait();
+    for (auto &connection : connections_)
+        ::close(connection.first);
+    ::close(wakeup_);
+    ::close(epoll_);
+    ::close(listener_);
+    ::unlink(path_.c_str());
+}
+
+
+void Server::run()
+{
+    epoll_event events[64];
+    while (!stopping_) {
+        const int count = ::epoll_wait(epoll_, events, 64, -1);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("Waiting for events failed");
+        }
+        for (int i = 0; i < count; ++i) {
+            const int fd = events[i].data.fd;
+            if (fd == listener_) {
+                accept_all();
+            } else if (fd == wakeup_) {
+                uint64_t value;
+                while (::read(wakeup_, &value, sizeof(value)) > 0) {}
+                collect();
+            } else {
+                auto found = connections_.find(fd);
+                if (found == connections_.end())
+                    continue;
+                std::shared_ptr<Connection> connection = found->second;
+                // The peer is gone both ways, nobody reads the responses
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    close(connection);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT)
+                    write_ready(connection);
+                if (connection->fd >= 0 && events[i].events & (EPOLLIN | EPOLLRDHUP))
+                    read_ready(connection);
+            }
+        }
+    }
+    pool_.wait();
+}
+
+void Server::stop()
+{
+    stopping_ = true;
+    const uint64_t one = 1;
+    const ssize_t done = ::write(wakeup_, &one, sizeof(one));
+    (void)done;
+}
+
+void Server::accept_all()
+{
+    for (;;) {
+        const int fd = ::accept4(listener_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            // EAGAIN when there's nobody left, or out of descriptors
+            return;
+        }
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        connections_.emplace(fd, std::make_shared<Connection>(fd, formula_count_));
+    }
+}
+
+void Server::read_ready(const std::shared_ptr<Connection> &connection)
+{
+    char buffer[64 * 1024];
+    for (;;) {
+        const ssize_t got = ::read(connection->fd, buffer, sizeof(buffer));
+        if (got > 0) {
+            connection->in.append(buffer, got);
+            continue;
+        }
+        if (got == 0) {
+            // The peer won't send more but may still be reading
+            connection->hung_up = true;
+            epoll_event event;
+            event.events = connection->writing ? uint32_t(EPOLLOUT) : 0;
+            event.data.fd = connection->fd;
+            ::epoll_ctl(epoll_, EPOLL_CTL_MOD, connection->fd, &event);
+            break;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        close(connection);
+        return;
+    }
+    dispatch(connection);
+    if (connection->fd >= 0 && connection->hung_up && !connection->busy && connection->out.empty())
+        close(connection);
+}
+
+void Server::write_ready(const std::shared_ptr<Connection> &connection)
+{
+    std::string &out = connection->out;
+    while (connection->written < out.size()) {
+        const ssize_t done = ::send(connection->fd, out.data() + connection->written,
+                                    out.size() - connection->written, MSG_NOSIGNAL);
+        if (done >= 0) {
+            connection->written += done;
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        close(connection);
+        return;
+    }
+    if (connection->written == out.size()) {
+        out.clear();
+        connection->written = 0;
+    }
+
+    const bool writing = !out.empty();
+    if (writing != connection->writing) {
+        connection->writing = writing;
+        epoll_event event;
+        event.events = (connection->hung_up ? 0 : uint32_t(EPOLLIN | EPOLLRDHUP)) | (writing ? uint32_t(EPOLLOUT) : 0);
+        event.data.fd = connection->fd;
+        ::epoll_ctl(epoll_, EPOLL_CTL_MOD, connection->fd, &event);
+    }
+    if (!writing) {
+        dispatch(connection);
+        if (connection->fd >= 0 && connection->hung_up && !connection->busy)
+            close(connection);
+    }
+}
+
+void Server::dispatch(const std::shared_ptr<Connection> &connection)
+{
+    if (connection->busy || connection->fd < 0 || connection->out.size() - connection->written > max_unsent)
+        return;
+
+    std::string &in = connection->in;
+    size_t whole = 0;
+    while (in.size() - whole >= sizeof(Header)) {
+        Header header;
+        std::memcpy(&header, in.data() + whole, sizeof(header));
+        if (header.length > protocol::max_length) {
+            close(connection);
+            return;
+        }
+        if (in.size() - whole - sizeof(header) < header.length)
+            break;
+        whole += sizeof(header) + header.length;
+    }
+    if (whole == 0)
+        return;
+
+    if (whole == in.size()) {
+        connection->batch.swap(in);
+        in.clear();
+    } else {
+        connection->batch.assign(in, 0, whole);
+        in.erase(0, whole);
+    }
+    connection->busy = true;
+    std::shared_ptr<Connection> keep = connection;
+    pool_.submit([this, keep] {
+        handle_batch(*keep);
+        {
+            std::lock_guard<std::mutex> lock(completed_mutex_);
+            completed_.push_back(keep);
+        }
+        const uint64_t one = 1;
+        const ssize_t done = ::write(wakeup_, &one, sizeof(one));
+        (void)done;
+    });
+}
+
+void Server::collect()
+{
+    std::vector<std::shared_ptr<Connection>> done;
+    {
+        std::lock_guard<std::mutex> lock(completed_mutex_);
+        done.swap(completed_);
+    }
+    for (auto &connection : done) {
+        connection->busy = false;
+        if (connection->fd < 0)
+            continue;
+        if (connection->out.empty())
+            connection->out.swap(connection->results);
+        else
+            connection->out += connection->results;
+        connection->results.clear();
+        write_ready(connection);
+    }
+}
+
+void Server::close(const std::shared_ptr<Connection> &connection)
+{
+    ::epoll_ctl(epoll_, EPOLL_CTL_DEL, connection->fd, nullptr);
+    ::close(connection->fd);
+    connections_.erase(connection->fd);
+    connection->fd = -1;
+}
+
+
+void Server::handle_batch(Connection &connection)
+{
+    const std::string &batch = connection.batch;
+    size_t pos = 0;
+    while (pos < batch.size()) {
+        Header header;
+        std::memcpy(&header, batch.data() + pos, sizeof(header));
+        pos += sizeof(header);
+        handle(connection, header, batch.data() + pos);
+        pos += header.length;
+    }
+}
+
+void Server::handle(Connection &connection, const Header &header, const char *payload)
+{
+    std::string &out = connection.results;
+    const size_t start = out.size();
+    Header response;
+    std::memset(&response, 0, sizeof(response));
+    response.id = header.id;
+    out.append(sizeof(response), '\0');
+    try {
+        switch (header.code) {
+        case protocol::parse:
+            append(out, parse(connection, payload, header.length));
+            break;
+        case protocol::evaluate:
+            append(out, cache_.parse(std::string(payload, header.length))->evaluate());
+            break;
+        case protocol::evaluate_with_inputs:
+            append(out, evaluate(connection, payload, header.length));
+            break;
+        default:
+            throw std::invalid_argument("Unknown request type.");
+        }
+        response.code = protocol::ok;
+    } catch (const infix_parsing::ParserError &e) {
+        out.resize(start + sizeof(response));
+        response.code = protocol::parse_error;
+        append(out, uint32_t(e.position));
+        out += e.what();
+    } catch (const std::exception &e) {
+        out.resize(start + sizeof(response));
+        response.code = protocol::bad_request;
+        out += e.what();
+    }
+    response.length = out.size() - start - sizeof(response);
+    std::memcpy(&out[start], &response, sizeof(response));
+}
+
+uint32_t Server::parse(Connection &connection, const char *payload, size_t length)
+{
+    if (connection.formulas.size() >= protocol::max_formulas)
+        throw std::invalid_argument("Connection has " + std::to_string(protocol::max_formulas) + " formulas already.");
+    Reader reader(payload, length);
+    infix_parsing::Scope scope;
+    std::vector<std::shared_ptr<Variable>> inputs(reader.get<uint16_t>());
+    for (auto &input : inputs) {
+        const uint16_t size = reader.get<uint16_t>();
+        const std::string name(reader.take(size), size);
+        input = std::make_shared<Variable>(name);
+        if (!scope.emplace(name, input).second)
+            throw std::invalid_argument("Input \"" + name + "\" is given twice.");
+    }
+    const size_t left = reader.left();
+    const std::string text(reader.take(left), left);
+    std::shared_ptr<Operand> tree = infix_parsing::parse_expression(text, *context_.snapshot(), scope);
+
+    connection.formulas.push_back({tree, std::move(inputs)});
+    ++formula_count_;
+    return connection.formulas.size() - 1;
+}
+
+double Server::evaluate(Connection &connection, const char *payload, size_t length)
+{
+    Reader reader(payload, length);
+    const uint32_t id = reader.get<uint32_t>();
+    if (id >= connection.formulas.size())
+        throw std::invalid_argument("Unknown formula " + std::to_string(id) + ".");
+    Formula &formula = connection.formulas[id];
+    if (reader.left() != formula.inputs.size() * sizeof(double))
+        throw std::invalid_argument("Formula takes " + std::to_string(formula.inputs.size()) + " inputs.");
+
+    for (auto &input : formula.inputs)
+        input->set_value(reader.get<double>());
+    return formula.tree->evaluate();
+}
+
+
+Client::Client(const std::string &path) : in_pos_(0), next_id_(0)
+{
+    const sockaddr_un address = socket_address(path);
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+        throw_errno("Cannot create the socket");
+    if (::connect(fd_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        const int err = errno;
+        ::close(fd_);
+        throw std::system_error(err, std::generic_category(), "Cannot connect to \"" + path + "\"");
+    }
+}
+
+Client::~Client()
+{
+    ::close(fd_);
+}
+
+
+void Client::start(uint32_t id, protocol::Type type, size_t length)
+{
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.length = length;
+    header.id = id;
+    header.code = type;
+    append(out_, header);
+    pending_.push_back(type);
+}
+
+void Client::send_parse(uint32_t id, const std::string &expression, const std::vector<std::string> &inputs)
+{
+    size_t length = sizeof(uint16_t) + expression.size();
+    for (auto &name : inputs)
+        length += sizeof(uint16_t) + name.size();
+    start(id, protocol::parse, length);
+    append(out_, uint16_t(inputs.size()));
+    for (auto &name : inputs) {
+        append(out_, uint16_t(name.size()));
+        out_ += name;
+    }
+    out_ += expression;
+}
+
+void Client::send_evaluate(uint32_t id, const std::string &expression)
+{
+    start(id, protocol::evaluate, expression.size());
+    out_ += expression;
+}
+
+void Client::send_evaluate(uint32_t id, uint32_t formula, const std::vector<double> &inputs)
+{
+    start(id, protocol::evaluate_with_inputs, sizeof(formula) + inputs.size() * sizeof(double));
+    append(out_, formula);
+    for (double value : inputs)
+        append(out_, value);
+}
+
+
+void Client::flush()
+{
+    size_t written = 0;
+    while (written < out_.size()) {
+        const ssize_t done = ::send(fd_, out_.data() + written, out_.size() - written, MSG_NOSIGNAL);
+        if (done < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("Sending requests failed");
+        }
+        written += done;
+    }
+    out_.clear();
+}
+
+Client::Response Client::receive()
+{
+    flush();
+    Header header;
+    for (;;) {
+        const size_t left = in_.size() - in_pos_;
+        if (left >= sizeof(header)) {
+            std::memcpy(&header, in_.data() + in_pos_, sizeof(header));
+            if (left - sizeof(header) >= header.length)
+                break;
+        }
+        // Responses are taken from the front, the rest moves only now
+        in_.erase(0, in_pos_);
+        in_pos_ = 0;
+        char buffer[64 * 1024];
+        const ssize_t got = ::read(fd_, buffer, sizeof(buffer));
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            throw_errno("Receiving responses failed");
+        }
+        if (got == 0)
+            throw std::runtime_error("Connection closed by the server.");
+        in_.append(buffer, got);
+    }
+
+    if (pending_.empty())
+        throw std::runtime_error("Response to no request.");
+    const protocol::Type type = pending_.front();
+    pending_.pop_front();
+
+    Response res;
+    res.id = header.id;
+    res.status = protocol::Status(header.code);
+    res.formula = 0;
+    res.value = 0;
+    res.position = 0;
+    Reader reader(in_.data() + in_pos_ + sizeof(header), header.length);
+    if (res.status == protocol::ok) {
+        if (type == protocol::parse)
+            res.formula = reader.get<uint32_t>();
+        else
+            res.value = reader.get<double>();
+    } else {
+        if (res.status == protocol::parse_error)
+            res.position = reader.get<uint32_t>();
+        const size_t left = reader.left();
+        res.message.assign(reader.take(left), left);
+    }
+    in_pos_ += sizeof(header) + header.length;
+    return res;
+}
+
+
+Client::Response Client::call()
+{
+    Response res = receive();
+    if (res.status != protocol::ok)
+        throw RequestError(res);
+    return res;
+}
+
+uint32_t Client::parse(const std::string &expression, const std::vector<std::string> &inputs)
+{
+    send_parse(next_id_++, expression, inputs);
+    return call().formula;
+}
+
+double Client::evaluate(const std::string &expression)
+{
+    send_evaluate(next_id_++, expression);
+    return call().value;
+}
+
+double Client::evaluate(uint32_t formula, const std::vector<double> &inputs)
+{
+    send_evaluate(next_id_++, formula, inputs);
+    return call().value;
+}
+
+}   // namespace server
@@ -0,0 +1,218 @@
+#pragma once
+#ifndef SERVER_HH
+#define SERVER_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "parse-cache.hh"
+#include "parsing-table.hh"
+#include "thread-pool.hh"
+
+namespace server {
+
+/*
+ * Wire format of the evaluation server. Every message is a header
+ * followed by `length` bytes of payload, integers and doubles are in the
+ * native byte order since both ends live on the same machine.
+ *
+ * Requests:
+ *
+ *     parse                 u16 input count, that many of (u16 length,
+ *                           name), the expression text in the rest
+ *                           -> u32 formula
+ *     evaluate              the expression text -> f64 value
+ *     evaluate_with_inputs  u32 formula, f64 value of every input in
+ *                           the order of the parse request -> f64 value
+ *
+ * Formulas belong to the connection that parsed them. Their numbers
+ * count from zero on every connection, other connections can't use them,
+ * and they are freed when the connection closes. A connection parses at
+ * most max_formulas of them.
+ *
+ * A response carries the id of its request. Responses of a connection
+ * come in the order of its requests. Failures are
+ *
+ *     parse_error           u32 position, the message in the rest
+ *     bad_request           the message
+ */
+namespace protocol {
+
+enum Type : uint8_t {
+    parse = 0,
+    evaluate = 1,
+    evaluate_with_inputs = 2,
+};
+
+enum Status : uint8_t {
+    ok = 0,
+    parse_error = 1,
+    bad_request = 2,
+};
+
+struct Header {
+    uint32_t length;
+    uint32_t id;
+    // Type of a request, Status of a response
+    uint8_t code;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(Header) == 12, "Header layout must be fixed.");
+
+// Connections sending anything longer are dropped
+const uint32_t max_length = 16 << 20;
+// Parse requests over this many are bad requests
+const uint32_t max_formulas = 1 << 16;
+
+}   // namespace protocol
+
+
+/*
+ * Evaluation server on a Unix domain socket. A single thread runs an
+ * epoll loop that accepts connections and reads and writes them without
+ * blocking. Whatever whole requests a connection has sent by the time
+ * it's read make a batch, which is handled by one task on the worker
+ * pool; the next batch of the connection waits until the responses to
+ * the previous one are queued, so responses keep the request order.
+ *
+ * Expressions of evaluate requests go through a ParseCache shared by all
+ * connections. Parsed formulas are kept with their connection; since its
+ * batches take turns, they are used without locking.
+ */
+class Server {
+public:
+    explicit Server(const std::string &path,
+                    size_t threads = concurrency::ThreadPool::default_size(),
+                    const infix_parsing::ParsingContext &context = infix_parsing::ParsingContext::global());
+    Server(const Server &) = delete;
+    Server(Server &&) = delete;
+
+    /*
+     * Closes the connections and removes the socket file.
+     */
+    ~Server();
+
+    /*
+     * Serves until stop() is called. Errors of the listening socket and
+     * of epoll are thrown as std::system_error.
+     */
+    void run();
+    /*
+     * Makes run() return. Safe to call from other threads and from
+     * signal handlers.
+     */
+    void stop();
+
+    /*
+     * Formulas held by all the connections.
+     */
+    size_t formula_count() const { return formula_count_; }
+private:
+    struct Connection;
+    struct Formula;
+
+    void accept_all();
+    void read_ready(const std::shared_ptr<Connection> &connection);
+    void write_ready(const std::shared_ptr<Connection> &connection);
+    void dispatch(const std::shared_ptr<Connection> &connection);
+    void collect();
+    void close(const std::shared_ptr<Connection> &connection);
+
+    void handle_batch(Connection &connection);
+    void handle(Connection &connection, const protocol::Header &header, const char *payload);
+    uint32_t parse(Connection &connection, const char *payload, size_t length);
+    double evaluate(Connection &connection, const char *payload, size_t length);
+
+    std::string path_;
+    const infix_parsing::ParsingContext &context_;
+    int listener_;
+    int epoll_;
+    int wakeup_;
+    std::atomic<bool> stopping_;
+
+    std::unordered_map<int, std::shared_ptr<Connection>> connections_;
+    std::mutex completed_mutex_;
+    std::vector<std::shared_ptr<Connection>> completed_;
+
+    std::atomic<size_t> formula_count_;
+    infix_parsing::ParseCache cache_;
+
+    concurrency::ThreadPool pool_;
+};
+
+
+/*
+ * Blocking client of the server. Requests are buffered until flush() or
+ * receive(), so any number of them can be pipelined. The client keeps
+ * the types of the requests it's waiting for, responses are decoded by
+ * the type of their request.
+ */
+class Client {
+public:
+    class RequestError;
+
+    struct Response {
+        uint32_t id;
+        protocol::Status status;
+        uint32_t formula;
+        double value;
+        uint32_t position;
+        std::string message;
+    };
+
+    explicit Client(const std::string &path);
+    Client(const Client &) = delete;
+    Client(Client &&) = delete;
+
+    ~Client();
+
+    void send_parse(uint32_t id, const std::string &expression, const std::vector<std::string> &inputs = {});
+    void send_evaluate(uint32_t id, const std::string &expression);
+    void send_evaluate(uint32_t id, uint32_t formula, const std::vector<double> &inputs);
+
+    void flush();
+    Response receive();
+
+    /*
+     * One request at a time, failures are thrown as RequestError.
+     */
+    uint32_t parse(const std::string &expression, const std::vector<std::string> &inputs = {});
+    double evaluate(const std::string &expression);
+    double evaluate(uint32_t formula, const std::vector<double> &inputs);
+private:
+    void start(uint32_t id, protocol::Type type, size_t length);
+    Response call();
+
+    int fd_;
+    std::string out_;
+    std::string in_;
+    size_t in_pos_;
+    uint32_t next_id_;
+    // Types of the requests not answered yet, oldest first
+    std::deque<protocol::Type> pending_;
+};
+
+
+class Client::RequestError : public std::runtime_error {
+public:
+    RequestError(const Response &response)
+        : runtime_error(response.message), status(response.status), position(response.position)
+    {}
+
+    protocol::Status status;
+    uint32_t position;
+};
+
+}   // namespace server
+
+#endif  // SERVER_HH
@@ -0,0 +1,355 @@
+#include "shared-rings.hh"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "parsing.hh"
+
+namespace server {
+
+using namespace shared;
+
+
+namespace {
+
+size_t align(size_t size)
+{
+    return (size + 63) / 64 * 64;
+}
+
+[[noreturn]] void throw_errno(const std::string &what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+/*
+ * Busy waiting that gives the core away once it goes on for long.
+ */
+void relax(unsigned &spins)
+{
+    if (++spins < 256) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+}   // namespace
+
+
+SharedRegion::SharedRegion(int fd, bool owned)
+    : fd_(fd), owned_(owned), size_(0), geometry_(), header_(nullptr), submissions_(nullptr),
+      completions_(nullptr), inputs_(nullptr), outputs_(nullptr)
+{
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+        throw_errno("Cannot map the rings");
+    size_ = st.st_size;
+    if (size_ < sizeof(Header))
+        throw std::runtime_error("Region is too small for the rings.");
+    void *p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        throw_errno("Cannot map the rings");
+    header_ = static_cast<Header *>(p);
+}
+
+SharedRegion::SharedRegion(SharedRegion &&other)
+    : fd_(other.fd_), owned_(other.owned_), size_(other.size_), geometry_(other.geometry_), header_(other.header_),
+      submissions_(other.submissions_), completions_(other.completions_),
+      inputs_(other.inputs_), outputs_(other.outputs_)
+{
+    other.fd_ = -1;
+    other.header_ = nullptr;
+}
+
+SharedRegion::~SharedRegion()
+{
+    if (header_)
+        ::munmap(header_, size_);
+    if (owned_ && fd_ >= 0)
+        ::close(fd_);
+}
+
+
+size_t SharedRegion::layout_size(const Geometry &geometry)
+{
+    const size_t slots = geometry.slots;
+    return align(sizeof(Header))
+        + align(slots * sizeof(Submission))
+        + align(slots * sizeof(Completion))
+        + align(slots * geometry.max_inputs * geometry.max_rows * sizeof(double))
+        + align(slots * geometry.max_rows * sizeof(double));
+}
+
+SharedRegion SharedRegion::create(const Geometry &geometry, const std::string &name)
+{
+    if (geometry.slots == 0 || (geometry.slots & (geometry.slots - 1)) != 0)
+        throw std::invalid_argument("Number of slots must be a power of two.");
+
+    const int fd = name.empty()
+        ? ::memfd_create("calculator-rings", MFD_CLOEXEC)
+        : ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0)
+        throw_errno("Cannot create the rings");
+    if (::ftruncate(fd, layout_size(geometry)) != 0) {
+        const int err = errno;
+        ::close(fd);
+        if (!name.empty())
+            ::shm_unlink(name.c_str());
+        throw std::system_error(err, std::generic_category(), "Cannot create the rings");
+    }
+
+    // Owns the descriptor only once it's complete, until then it's closed
+    // here whether or not the constructor got to run
+    try {
+        SharedRegion res(fd, false);
+        Header *header = new (res.header_) Header;
+        header->magic = magic;
+        header->version = version;
+        header->geometry = geometry;
+        header->submission_head.store(0);
+        header->submission_tail.store(0);
+        header->completion_head.store(0);
+        header->completion_tail.store(0);
+        res.geometry_ = geometry;
+        res.attach_sections();
+        res.owned_ = true;
+        return res;
+    } catch (...) {
+        ::close(fd);
+        if (!name.empty())
+            ::shm_unlink(name.c_str());
+        throw;
+    }
+}
+
+SharedRegion SharedRegion::open(const std::string &name)
+{
+    const int fd = ::shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0)
+        throw_errno("Cannot open the rings \"" + name + "\"");
+    try {
+        SharedRegion res(fd, false);
+        res.check();
+        res.owned_ = true;
+        return res;
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+SharedRegion SharedRegion::attach(int fd)
+{
+    SharedRegion res(fd, false);
+    res.check();
+    return res;
+}
+
+void SharedRegion::unlink(const std::string &name)
+{
+    ::shm_unlink(name.c_str());
+}
+
+
+void SharedRegion::check()
+{
+    if (header_->magic != magic || header_->version != version)
+        throw std::runtime_error("Region doesn't hold the rings.");
+    // Read once, the other process may change the header at any time
+    Geometry geometry;
+    std::memcpy(&geometry, &header_->geometry, sizeof(geometry));
+    if (geometry.slots == 0 || (geometry.slots & (geometry.slots - 1)) != 0)
+        throw std::runtime_error("Region doesn't hold the rings.");
+    // Columns alone can't be larger than the mapping, which keeps the
+    // layout size from overflowing
+    const size_t cells = size_t(geometry.slots) * geometry.max_rows;
+    if (cells > size_ / sizeof(double)
+        || (geometry.max_inputs != 0 && cells > size_ / sizeof(double) / geometry.max_inputs))
+        throw std::runtime_error("Region doesn't hold the rings.");
+    if (size_ < layout_size(geometry))
+        throw std::runtime_error("Region doesn't hold the rings.");
+    geometry_ = geometry;
+    attach_sections();
+}
+
+void SharedRegion::attach_sections()
+{
+    const Geometry &geometry = geometry_;
+    char *base = reinterpret_cast<char *>(header_);
+    size_t offset = align(sizeof(Header));
+    submissions_ = reinterpret_cast<Submission *>(base + offset);
+    offset += align(geometry.slots * sizeof(Submission));
+    completions_ = reinterpret_cast<Completion *>(base + offset);
+    offset += align(geometry.slots * sizeof(Completion));
+    inputs_ = reinterpret_cast<double *>(base + offset);
+    offset += align(size_t(geometry.slots) * geometry.max_inputs * geometry.max_rows * sizeof(double));
+    outputs_ = reinterpret_cast<double *>(base + offset);
+}
+
+double *SharedRegion::inputs(uint32_t slot, uint32_t column) const
+{
+    return inputs_ + (size_t(slot) * geometry_.max_inputs + column) * geometry_.max_rows;
+}
+
+double *SharedRegion::outputs(uint32_t slot) const
+{
+    return outputs_ + size_t(slot) * geometry_.max_rows;
+}
+
+
+RingClient::RingClient(SharedRegion &region)
+    : region_(region),
+      submitted_(region.header().submission_head.load(std::memory_order_relaxed)),
+      completed_(region.header().completion_tail.load(std::memory_order_relaxed))
+{
+    for (uint32_t slot = region.geometry().slots; slot-- > 0; )
+        free_.push_back(slot);
+}
+
+int64_t RingClient::acquire()
+{
+    if (free_.empty())
+        return -1;
+    const uint32_t slot = free_.back();
+    free_.pop_back();
+    return slot;
+}
+
+void RingClient::release(uint32_t slot)
+{
+    free_.push_back(slot);
+}
+
+void RingClient::submit(uint32_t slot, uint32_t formula, uint32_t rows, uint32_t tag)
+{
+    Header &header = region_.header();
+    const uint32_t mask = region_.geometry().slots - 1;
+    Submission &entry = region_.submissions()[submitted_ & mask];
+    entry.formula = formula;
+    entry.slot = slot;
+    entry.rows = rows;
+    entry.tag = tag;
+    // Publishes the entry and the input columns written before it
+    header.submission_head.store(++submitted_, std::memory_order_release);
+}
+
+bool RingClient::poll(Completion &completion)
+{
+    Header &header = region_.header();
+    if (header.completion_head.load(std::memory_order_acquire) == completed_)
+        return false;
+    completion = region_.completions()[completed_ & (region_.geometry().slots - 1)];
+    header.completion_tail.store(++completed_, std::memory_order_release);
+    return true;
+}
+
+Completion RingClient::wait()
+{
+    Completion res;
+    unsigned spins = 0;
+    while (!poll(res))
+        relax(spins);
+    return res;
+}
+
+
+RingEvaluator::RingEvaluator(SharedRegion &region, const infix_parsing::ParsingContext &context)
+    : region_(region), context_(context)
+{}
+
+uint32_t RingEvaluator::add(const std::string &expression, const std::vector<std::string> &inputs)
+{
+    if (inputs.size() > region_.geometry().max_inputs)
+        throw std::invalid_argument("Formula has more inputs than the region has columns.");
+    Formula formula;
+    infix_parsing::Scope scope;
+    for (auto &name : inputs) {
+        formula.inputs.push_back(std::make_shared<calculation::Variable>(name));
+        if (!scope.emplace(name, formula.inputs.back()).second)
+            throw std::invalid_argument("Input \"" + name + "\" is given twice.");
+    }
+    formula.tree = infix_parsing::parse_expression(expression, *context_.snapshot(), scope);
+    formulas_.push_back(formula);
+    return formulas_.size() - 1;
+}
+
+size_t RingEvaluator::poll()
+{
+    Header &header = region_.header();
+    const uint32_t slots = region_.geometry().slots;
+    uint32_t tail = header.submission_tail.load(std::memory_order_relaxed);
+    const uint32_t head = header.submission_head.load(std::memory_order_acquire);
+    uint32_t completed = header.completion_head.load(std::memory_order_relaxed);
+    size_t count = 0;
+    while (tail != head) {
+        // Only a client that submits a slot twice can fill the completions
+        if (completed - header.completion_tail.load(std::memory_order_acquire) == slots)
+            break;
+        const Submission submission = region_.submissions()[tail & (slots - 1)];
+        Completion &completion = region_.completions()[completed & (slots - 1)];
+        completion.slot = submission.slot;
+        completion.status = evaluate(submission);
+        completion.rows = submission.rows;
+        completion.tag = submission.tag;
+        header.submission_tail.store(++tail, std::memory_order_release);
+        // Publishes the completion and the output column
+        header.completion_head.store(++completed, std::memory_order_release);
+        ++count;
+    }
+    return count;
+}
+
+void RingEvaluator::run(const std::atomic<bool> &stop)
+{
+    unsigned spins = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (poll() > 0) {
+            spins = 0;
+        } else if (spins < 4096) {
+            relax(spins);
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+}
+
+Status RingEvaluator::evaluate(const Submission &submission)
+{
+    const Geometry &geometry = region_.geometry();
+    if (submission.slot >= geometry.slots)
+        return bad_slot;
+    if (submission.formula >= formulas_.size())
+        return unknown_formula;
+    if (submission.rows > geometry.max_rows)
+        return too_many_rows;
+
+    const Formula &formula = formulas_[submission.formula];
+    columns_.clear();
+    for (uint32_t i = 0; i < formula.inputs.size(); ++i)
+        columns_.push_back(region_.inputs(submission.slot, i));
+    double *out = region_.outputs(submission.slot);
+    for (uint32_t row = 0; row < submission.rows; ++row) {
+        for (size_t i = 0; i < columns_.size(); ++i)
+            formula.inputs[i]->set_value(columns_[i][row]);
+        out[row] = formula.tree->evaluate();
+    }
+    return ok;
+}
+
+}   // namespace server
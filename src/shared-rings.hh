@@ -0,0 +1,223 @@
+#pragma once
+#ifndef SHARED_RINGS_HH
+#define SHARED_RINGS_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "parsing-table.hh"
+
+namespace server {
+
+/*
+ * Shared memory channel between a client process and an evaluator
+ * process. The region holds two single-producer single-consumer rings
+ * and a fixed number of slots of column buffers:
+ *
+ *     Header
+ *     Submission  submissions[slots]
+ *     Completion  completions[slots]
+ *     double      inputs[slots][max_inputs][max_rows]
+ *     double      outputs[slots][max_rows]
+ *
+ * The client fills the input columns of a free slot and submits it with
+ * a formula id and a row count. The evaluator computes the formula for
+ * every row straight into the slot's output column and completes it.
+ * Nothing is copied and, while both sides keep polling, no system call
+ * is made. A slot belongs to the client until it's submitted and again
+ * after it's completed, so neither ring can overflow.
+ */
+namespace shared {
+
+const uint32_t magic = 0x52534441;     // "ADSR" in little endian
+const uint32_t version = 1;
+
+enum Status : uint32_t {
+    ok = 0,
+    unknown_formula = 1,
+    too_many_rows = 2,
+    bad_slot = 3,
+};
+
+struct Submission {
+    uint32_t formula;
+    uint32_t slot;
+    uint32_t rows;
+    uint32_t tag;
+};
+
+struct Completion {
+    uint32_t slot;
+    uint32_t status;
+    uint32_t rows;
+    uint32_t tag;
+};
+
+struct Geometry {
+    // A power of two
+    uint32_t slots;
+    uint32_t max_rows;
+    uint32_t max_inputs;
+};
+
+/*
+ * Counters run freely and wrap around, an entry's index is the counter
+ * modulo the number of slots. Each counter has a cache line of its own.
+ */
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    Geometry geometry;
+
+    alignas(64) std::atomic<uint32_t> submission_head;
+    alignas(64) std::atomic<uint32_t> submission_tail;
+    alignas(64) std::atomic<uint32_t> completion_head;
+    alignas(64) std::atomic<uint32_t> completion_tail;
+};
+
+static_assert(sizeof(Submission) == 16, "Submission layout must be fixed.");
+static_assert(sizeof(Completion) == 16, "Completion layout must be fixed.");
+static_assert(sizeof(Header) == 320, "Header layout must be fixed.");
+
+}   // namespace shared
+
+
+/*
+ * Mapping of a channel region. A region is created either anonymous with
+ * memfd_create(), to be passed to the other process as a descriptor, or
+ * with shm_open() under a name the other process opens.
+ */
+class SharedRegion {
+public:
+    SharedRegion() = delete;
+    SharedRegion(const SharedRegion &) = delete;
+    SharedRegion(SharedRegion &&other);
+
+    ~SharedRegion();
+
+    /*
+     * Names start with a slash, an empty name makes an anonymous region.
+     * A named region stays in /dev/shm until unlink().
+     */
+    static SharedRegion create(const shared::Geometry &geometry, const std::string &name = "");
+    static SharedRegion open(const std::string &name);
+    /*
+     * Maps the region behind the descriptor, which stays open.
+     */
+    static SharedRegion attach(int fd);
+    static void unlink(const std::string &name);
+
+    int fd() const { return fd_; }
+    size_t size() const { return size_; }
+    /*
+     * The geometry the region was created or checked with. The header's
+     * copy is writable by the other process and is not read again.
+     */
+    const shared::Geometry &geometry() const { return geometry_; }
+
+    shared::Header &header() const { return *header_; }
+    shared::Submission *submissions() const { return submissions_; }
+    shared::Completion *completions() const { return completions_; }
+    double *inputs(uint32_t slot, uint32_t column) const;
+    double *outputs(uint32_t slot) const;
+private:
+    SharedRegion(int fd, bool owned);
+
+    static size_t layout_size(const shared::Geometry &geometry);
+    void check();
+    void attach_sections();
+
+    int fd_;
+    bool owned_;
+    size_t size_;
+    shared::Geometry geometry_;
+    shared::Header *header_;
+    shared::Submission *submissions_;
+    shared::Completion *completions_;
+    double *inputs_;
+    double *outputs_;
+};
+
+
+/*
+ * Client end of a region: takes the free slots, produces submissions
+ * and consumes completions.
+ */
+class RingClient {
+public:
+    explicit RingClient(SharedRegion &region);
+    RingClient(const RingClient &) = delete;
+
+    /*
+     * Returns a free slot or -1 if all of them are submitted.
+     */
+    int64_t acquire();
+    void release(uint32_t slot);
+
+    double *inputs(uint32_t slot, uint32_t column) { return region_.inputs(slot, column); }
+    const double *outputs(uint32_t slot) const { return region_.outputs(slot); }
+
+    void submit(uint32_t slot, uint32_t formula, uint32_t rows, uint32_t tag = 0);
+    /*
+     * Takes the next completion if there is one.
+     */
+    bool poll(shared::Completion &completion);
+    /*
+     * Spins until the next completion comes.
+     */
+    shared::Completion wait();
+private:
+    SharedRegion &region_;
+    std::vector<uint32_t> free_;
+    uint32_t submitted_;
+    uint32_t completed_;
+};
+
+
+/*
+ * Evaluator end of a region: consumes submissions and produces
+ * completions. Formulas are registered up front and are referred to by
+ * the order of registration.
+ */
+class RingEvaluator {
+public:
+    RingEvaluator(SharedRegion &region, const infix_parsing::ParsingContext &context = infix_parsing::ParsingContext::global());
+    RingEvaluator(const RingEvaluator &) = delete;
+
+    /*
+     * Parses the formula with the named inputs, which are taken from the
+     * input columns in the same order.
+     */
+    uint32_t add(const std::string &expression, const std::vector<std::string> &inputs = {});
+
+    /*
+     * Handles every submission that is there, returns how many.
+     */
+    size_t poll();
+    /*
+     * Polls until the flag is set. Spins while there's work and backs
+     * off to sleeping when there's none for a while.
+     */
+    void run(const std::atomic<bool> &stop);
+private:
+    struct Formula {
+        std::shared_ptr<calculation::Operand> tree;
+        std::vector<std::shared_ptr<calculation::Variable>> inputs;
+    };
+
+    shared::Status evaluate(const shared::Submission &submission);
+
+    SharedRegion &region_;
+    const infix_parsing::ParsingContext &context_;
+    std::vector<Formula> formulas_;
+    std::vector<const double *> columns_;
+};
+
+}   // namespace server
+
+#endif  // SHARED_RINGS_HH
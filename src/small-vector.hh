@@ -0,0 +1,225 @@
+#pragma once
+#ifndef SMALL_VECTOR_HH
+#define SMALL_VECTOR_HH
+
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace data_structs {
+
+/*
+ * Vector that keeps its first N elements inside itself and moves all of
+ * them to the heap only when there are more. As a local variable it
+ * makes a stack that needs no allocation while it stays short.
+ *
+ * Elements are contiguous and iterators are plain pointers, they're
+ * invalidated by anything that grows the vector past its capacity.
+ */
+template<class T, size_t N>
+class SmallVector {
+public:
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    SmallVector() : data_(inline_data()), size_(0), capacity_(N) {}
+    SmallVector(const SmallVector &src);
+    SmallVector(SmallVector &&src) noexcept(std::is_nothrow_move_constructible<T>::value);
+
+    ~SmallVector();
+
+    SmallVector &operator=(const SmallVector &src);
+    SmallVector &operator=(SmallVector &&src) noexcept(std::is_nothrow_move_constructible<T>::value);
+
+    iterator begin() { return data_; }
+    iterator end() { return data_ + size_; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+
+    T *data() { return data_; }
+    const T *data() const { return data_; }
+
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+    template<class... Args>
+    T &emplace_back(Args &&...args);
+    void pop_back();
+
+    T &operator[](size_t i) { return data_[i]; }
+    const T &operator[](size_t i) const { return data_[i]; }
+    T &at(size_t i);
+    T &front() { return data_[0]; }
+    T &back() { return data_[size_ - 1]; }
+
+    void reserve(size_t capacity);
+    void clear();
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return capacity_; }
+    /*
+     * Whether the elements are still inside the vector.
+     */
+    bool is_inline() const { return data_ == inline_data(); }
+private:
+    static_assert(N > 0, "Small vectors hold at least one element inline.");
+
+    T *inline_data() { return reinterpret_cast<T *>(&storage_); }
+    const T *inline_data() const { return reinterpret_cast<const T *>(&storage_); }
+
+    /*
+     * Moves the elements to a heap buffer of the given capacity.
+     */
+    void grow(size_t capacity);
+    /*
+     * Takes the elements of src, leaving it empty.
+     */
+    void take(SmallVector &src);
+
+    T *data_;
+    size_t size_;
+    size_t capacity_;
+    typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type storage_;
+};
+
+
+template<class T, size_t N>
+SmallVector<T, N>::SmallVector(const SmallVector &src) : SmallVector()
+{
+    reserve(src.size_);
+    for (const T &x : src)
+        emplace_back(x);
+}
+
+template<class T, size_t N>
+SmallVector<T, N>::SmallVector(SmallVector &&src) noexcept(std::is_nothrow_move_constructible<T>::value)
+    : SmallVector()
+{
+    take(src);
+}
+
+template<class T, size_t N>
+SmallVector<T, N>::~SmallVector()
+{
+    clear();
+    if (!is_inline())
+        ::operator delete(data_);
+}
+
+template<class T, size_t N>
+SmallVector<T, N> &SmallVector<T, N>::operator=(const SmallVector &src)
+{
+    if (this != &src) {
+        clear();
+        reserve(src.size_);
+        for (const T &x : src)
+            emplace_back(x);
+    }
+    return *this;
+}
+
+template<class T, size_t N>
+SmallVector<T, N> &SmallVector<T, N>::operator=(SmallVector &&src) noexcept(std::is_nothrow_move_constructible<T>::value)
+{
+    if (this != &src) {
+        clear();
+        take(src);
+    }
+    return *this;
+}
+
+template<class T, size_t N>
+void SmallVector<T, N>::take(SmallVector &src)
+{
+    if (!src.is_inline()) {
+        if (!is_inline())
+            ::operator delete(data_);
+        data_ = src.data_;
+        capacity_ = src.capacity_;
+        size_ = src.size_;
+        src.data_ = src.inline_data();
+        src.capacity_ = N;
+        src.size_ = 0;
+        return;
+    }
+    // Inline elements can't be stolen, they're moved one by one
+    reserve(src.size_);
+    for (T &x : src)
+        new (data_ + size_++) T(std::move(x));
+    src.clear();
+}
+
+
+template<class T, size_t N>
+void SmallVector<T, N>::grow(size_t capacity)
+{
+    T *data = static_cast<T *>(::operator new(capacity * sizeof(T)));
+    size_t moved = 0;
+    try {
+        for (; moved < size_; ++moved)
+            new (data + moved) T(std::move_if_noexcept(data_[moved]));
+    } catch (...) {
+        while (moved > 0)
+            data[--moved].~T();
+        ::operator delete(data);
+        throw;
+    }
+    for (size_t i = 0; i < size_; ++i)
+        data_[i].~T();
+    if (!is_inline())
+        ::operator delete(data_);
+    data_ = data;
+    capacity_ = capacity;
+}
+
+template<class T, size_t N>
+void SmallVector<T, N>::reserve(size_t capacity)
+{
+    if (capacity > capacity_)
+        grow(capacity);
+}
+
+
+template<class T, size_t N>
+template<class... Args>
+T &SmallVector<T, N>::emplace_back(Args &&...args)
+{
+    if (size_ == capacity_) {
+        // The arguments may refer to an element, so the new one is built
+        // before the old ones move
+        T value(std::forward<Args>(args)...);
+        grow(2 * capacity_);
+        new (data_ + size_) T(std::move(value));
+    } else {
+        new (data_ + size_) T(std::forward<Args>(args)...);
+    }
+    return data_[size_++];
+}
+
+template<class T, size_t N>
+void SmallVector<T, N>::pop_back()
+{
+    if (size_ > 0)
+        data_[--size_].~T();
+}
+
+template<class T, size_t N>
+T &SmallVector<T, N>::at(size_t i)
+{
+    if (i >= size_)
+        throw std::out_of_range("Index out of range.");
+    return data_[i];
+}
+
+template<class T, size_t N>
+void SmallVector<T, N>::clear()
+{
+    while (size_ > 0)
+        data_[--size_].~T();
+}
+
+}   // namespace data_structs
+
+#endif  // SMALL_VECTOR_HH
@@ -0,0 +1,178 @@
+#include "stream-evaluator.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ios>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "calculation-tree.hh"
+#include "numbers.hh"
+#include "parsing-exceptions.hh"
+#include "parsing-table.hh"
+#include "precedence-parser.hh"
+#include "scanner.hh"
+
+namespace infix_parsing {
+
+using calculation::UnaryOperator;
+using calculation::BinaryOperator;
+
+const size_t StreamEvaluator::default_chunk_size;
+
+
+StreamEvaluator::StreamEvaluator(const ParsingContext &context, size_t chunk_size)
+    : context_(context), stream_(nullptr), fd_(-1), pos_(0), end_(0),
+      offset_(0), eof_(false), max_depth_(0)
+{
+    if (chunk_size == 0)
+        throw std::invalid_argument("Chunk size cannot be zero.");
+    buffer_.resize(chunk_size);
+}
+
+
+double StreamEvaluator::evaluate(std::istream &in)
+{
+    stream_ = &in;
+    fd_ = -1;
+    return run();
+}
+
+double StreamEvaluator::evaluate(int fd)
+{
+    stream_ = nullptr;
+    fd_ = fd;
+    return run();
+}
+
+
+double StreamEvaluator::run()
+{
+    table_ = context_.snapshot();
+    pos_ = end_ = 0;
+    offset_ = 0;
+    eof_ = false;
+    values_.clear();
+    max_depth_ = 0;
+
+    PrecedenceParser<StreamEvaluator, StreamEvaluator> parser(*table_, *this, *this, pending_, name_);
+    if (!parser.run())
+        return 0;
+    return values_.back();
+}
+
+
+size_t StreamEvaluator::read(char *buffer, size_t size)
+{
+    if (stream_) {
+        stream_->read(buffer, size);
+        if (stream_->bad())
+            throw std::ios_base::failure("Reading expression failed.");
+        return stream_->gcount();
+    }
+    for (;;) {
+        const ssize_t got = ::read(fd_, buffer, size);
+        if (got >= 0)
+            return got;
+        if (errno != EINTR)
+            throw std::system_error(errno, std::generic_category(), "Reading expression failed");
+    }
+}
+
+bool StreamEvaluator::fill(size_t need)
+{
+    while (end_ - pos_ < need && !eof_) {
+        if (pos_ > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + pos_, end_ - pos_);
+            offset_ += pos_;
+            end_ -= pos_;
+            pos_ = 0;
+        }
+        // Only a token longer than the buffer gets here
+        if (end_ == buffer_.size())
+            buffer_.resize(buffer_.size() * 2);
+        const size_t got = read(buffer_.data() + end_, buffer_.size() - end_);
+        if (got == 0)
+            eof_ = true;
+        end_ += got;
+    }
+    return end_ - pos_ >= need;
+}
+
+size_t StreamEvaluator::run_length(size_t at, const char *(*skip)(const char *, const char *))
+{
+    for (;;) {
+        const char *data = buffer_.data();
+        const size_t stop = skip(data + pos_ + at, data + end_) - (data + pos_);
+        if (pos_ + stop < end_ || !fill(stop + 1))
+            return stop;
+        at = stop;
+    }
+}
+
+void StreamEvaluator::skip_spaces()
+{
+    for (;;) {
+        const char *data = buffer_.data();
+        pos_ = Scanner::skip_spaces(data + pos_, data + end_) - data;
+        if (pos_ < end_ || !fill(1))
+            return;
+    }
+}
+
+
+const char *StreamEvaluator::lookahead(size_t &n)
+{
+    fill(n);
+    n = std::min(n, end_ - pos_);
+    return buffer_.data() + pos_;
+}
+
+double StreamEvaluator::number()
+{
+    size_t length = run_length(0, Scanner::skip_number);
+    if (fill(length + 1) && (buffer_[pos_ + length] == 'e' || buffer_[pos_ + length] == 'E')) {
+        size_t exponent = length + 1;
+        if (fill(exponent + 1) && (buffer_[pos_ + exponent] == '+' || buffer_[pos_ + exponent] == '-'))
+            ++exponent;
+        length = run_length(exponent, Scanner::skip_number);
+    }
+    double value;
+    size_t used;
+    try {
+        used = calculation::Numbers::parse(buffer_.data() + pos_, buffer_.data() + pos_ + length, value);
+    } catch (const std::out_of_range &) {
+        throw TooBigNumber(position());
+    }
+    pos_ += used;
+    return value;
+}
+
+
+void StreamEvaluator::push_value(double value)
+{
+    values_.push_back(value);
+    // Operators are pushed before their operands, the stacks are the
+    // deepest right after a value
+    max_depth_ = std::max(max_depth_, values_.size() + pending_.size());
+}
+
+void StreamEvaluator::apply(const UnaryOperator::Descriptor *op)
+{
+    values_.back() = op->function(values_.back());
+}
+
+void StreamEvaluator::apply(const BinaryOperator::Descriptor *op)
+{
+    const double right = values_.back();
+    values_.pop_back();
+    values_.back() = op->function(values_.back(), right);
+}
+
+}   // namespace infix_parsing
@@ -0,0 +1,106 @@
+#pragma once
+#ifndef STREAM_EVALUATOR_HH
+#define STREAM_EVALUATOR_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "parsing-table.hh"
+#include "precedence-parser.hh"
+
+namespace infix_parsing {
+
+/*
+ * Stream evaluator computes an expression while reading it, without
+ * building a calculation tree. Input is read in chunks and evaluated by
+ * a PrecedenceParser as it goes, so memory depends on how deep the
+ * expression is nested and not on how long it is. Only a single number
+ * longer than a chunk makes the buffer grow.
+ *
+ * The expression is read the same way parse_expression() reads it. Errors
+ * are thrown as the parser's exceptions, with positions counted in bytes
+ * from the beginning of the input. Variables are not supported.
+ */
+class StreamEvaluator {
+public:
+    static const size_t default_chunk_size = 64 * 1024;
+
+    explicit StreamEvaluator(const ParsingContext &context = ParsingContext::global(),
+                             size_t chunk_size = default_chunk_size);
+    StreamEvaluator(const StreamEvaluator &) = delete;
+
+    /*
+     * Reads the stream up to its end and returns the value.
+     */
+    double evaluate(std::istream &in);
+    /*
+     * Same as above, reading the file descriptor with read(2). Errors of
+     * reading are thrown as std::system_error.
+     */
+    double evaluate(int fd);
+
+    /*
+     * The most entries the stacks held during the last evaluation.
+     */
+    size_t max_depth() const { return max_depth_; }
+private:
+    template<typename Source, typename Sink>
+    friend class PrecedenceParser;
+
+    double run();
+
+    size_t read(char *buffer, size_t size);
+    /*
+     * Makes sure at least `need` unread bytes are buffered, unless the
+     * input ends sooner. Returns whether they are.
+     */
+    bool fill(size_t need);
+    /*
+     * Length of the run of the class starting `at` bytes after the read
+     * position, reading on until the run ends.
+     */
+    size_t run_length(size_t at, const char *(*skip)(const char *, const char *));
+
+    // Source of the parser
+    bool at_end() { return !fill(1); }
+    void skip_spaces();
+    char peek() const { return buffer_[pos_]; }
+    void advance(size_t n) { pos_ += n; }
+    size_t position() const { return offset_ + pos_; }
+    const char *lookahead(size_t &n);
+    double number();
+    const calculation::Variable *match_variable() { return nullptr; }
+
+    // Sink of the parser
+    void push_value(double value);
+    // Streams have no variables, the parser never gets one
+    void push_variable(const calculation::Variable *) {}
+    void apply(const calculation::UnaryOperator::Descriptor *op);
+    void apply(const calculation::BinaryOperator::Descriptor *op);
+
+    const ParsingContext &context_;
+    std::shared_ptr<const SymbolTable> table_;
+
+    std::istream *stream_;
+    int fd_;
+
+    std::vector<char> buffer_;
+    size_t pos_;
+    size_t end_;
+    uint64_t offset_;
+    bool eof_;
+
+    std::string name_;
+    std::vector<double> values_;
+    std::vector<PendingOperator> pending_;
+    size_t max_depth_;
+};
+
+}   // namespace infix_parsing
+
+#endif  // STREAM_EVALUATOR_HH
@@ -0,0 +1,84 @@
+#include "symbols.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace calculation {
+
+namespace {
+
+/*
+ * Names are kept in fixed size chunks, which are allocated on demand and
+ * never freed or moved. Readers only follow published chunk pointers.
+ */
+const size_t chunk_size = 1024;
+const size_t max_chunks = 4096;
+
+struct Storage {
+    Storage() : count(0)
+    {
+        for (auto &c : chunks)
+            c.store(nullptr);
+        intern("");
+    }
+
+    Symbols::Id intern(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(name);
+        if (it != index.end())
+            return it->second;
+        const size_t id = count.load();
+        if (id == chunk_size * max_chunks)
+            throw std::length_error("Too many symbols.");
+        std::string *chunk = chunks[id / chunk_size].load();
+        if (!chunk) {
+            chunk = new std::string[chunk_size];
+            chunks[id / chunk_size].store(chunk);
+        }
+        chunk[id % chunk_size] = name;
+        index.emplace(name, id);
+        count.store(id + 1);
+        return id;
+    }
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Symbols::Id> index;
+    std::atomic<std::string *> chunks[max_chunks];
+    std::atomic<size_t> count;
+};
+
+Storage &storage()
+{
+    static Storage s;
+    return s;
+}
+
+}   // namespace
+
+
+const Symbols::Id Symbols::none;
+
+Symbols::Id Symbols::intern(const std::string &name)
+{
+    return storage().intern(name);
+}
+
+const std::string &Symbols::name(Id id)
+{
+    Storage &s = storage();
+    if (id >= s.count.load())
+        throw std::out_of_range("Unknown symbol.");
+    return s.chunks[id / chunk_size].load()[id % chunk_size];
+}
+
+size_t Symbols::size()
+{
+    return storage().count.load();
+}
+
+}   // namespace calculation
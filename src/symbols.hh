@@ -0,0 +1,40 @@
+#pragma once
+#ifndef SYMBOLS_HH
+#define SYMBOLS_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace calculation {
+
+/*
+ * A static table of interned names. Every distinct name is stored once
+ * and is referred to by a small id, so tree nodes don't have to carry
+ * their own strings. Ids are never reused and names never move, so
+ * name() is safe to call without locking.
+ */
+class Symbols {
+public:
+    using Id = uint32_t;
+
+    /*
+     * Id of the empty name, used by nodes that have no name.
+     */
+    static const Id none = 0;
+
+    Symbols() = delete;
+    Symbols(const Symbols &) = delete;
+    Symbols(Symbols &&) = delete;
+
+    static Id intern(const std::string &name);
+    static const std::string &name(Id id);
+
+    static size_t size();
+private:
+    ~Symbols() = default;
+};
+
+}   // namespace calculation
+
+#endif  // SYMBOLS_HH
@@ -0,0 +1,82 @@
+#include "thread-pool.hh"
+
+#include <stdexcept>
+#include <utility>
+
+namespace concurrency {
+
+ThreadPool::ThreadPool(size_t threads) : unfinished_(0), stopping_(false)
+{
+    if (threads == 0)
+        throw std::invalid_argument("Thread pool cannot be empty.");
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        workers_.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    task_ready_.notify_all();
+    for (auto &worker : workers_)
+        worker.join();
+}
+
+
+size_t ThreadPool::default_size()
+{
+    size_t n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push(std::move(task));
+        ++unfinished_;
+    }
+    task_ready_.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    all_done_.wait(lock, [this] { return unfinished_ == 0; });
+    if (error_) {
+        std::exception_ptr e = error_;
+        error_ = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+
+void ThreadPool::work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        task_ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty())
+            return;
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop();
+        lock.unlock();
+        try {
+            task();
+        } catch (...) {
+            lock.lock();
+            if (!error_)
+                error_ = std::current_exception();
+            lock.unlock();
+        }
+        lock.lock();
+        if (--unfinished_ == 0)
+            all_done_.notify_all();
+    }
+}
+
+}   // namespace concurrency
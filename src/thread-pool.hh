@@ -0,0 +1,57 @@
+#pragma once
+#ifndef THREAD_POOL_HH
+#define THREAD_POOL_HH
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace concurrency {
+
+/*
+ * A fixed set of worker threads that run submitted tasks in FIFO order.
+ * Tasks may submit more tasks. The first exception thrown by a task is
+ * kept and re-thrown by wait().
+ */
+class ThreadPool {
+public:
+    ThreadPool() : ThreadPool(default_size()) {}
+    explicit ThreadPool(size_t threads);
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+
+    ~ThreadPool();
+
+    static size_t default_size();
+
+    void submit(std::function<void()> task);
+    /*
+     * Blocks until every submitted task (including the ones submitted by
+     * other tasks) is finished.
+     */
+    void wait();
+
+    size_t size() const { return workers_.size(); }
+private:
+    void work();
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+
+    std::mutex mutex_;
+    std::condition_variable task_ready_;
+    std::condition_variable all_done_;
+
+    size_t unfinished_;
+    bool stopping_;
+    std::exception_ptr error_;
+};
+
+}   // namespace concurrency
+
+#endif  // THREAD_POOL_HH
@@ -0,0 +1,537 @@
+#pragma once
+#ifndef UNROLLED_LIST_HH
+#define UNROLLED_LIST_HH
+
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "node-pool.hh"
+
+namespace data_structs {
+
+/*
+ * Default number of elements in a chunk: a few cache lines of them.
+ */
+template<class T>
+constexpr size_t default_chunk_capacity()
+{
+    return 256 / sizeof(T) > 8 ? 256 / sizeof(T) : 8;
+}
+
+
+/*
+ * Doubly linked list of chunks, each holding up to Capacity elements side
+ * by side. Walking it touches a new cache line only every few elements,
+ * while insertion and erasure still move at most one chunk's worth of
+ * them. Pushing at either end fills the free slots of the first or the
+ * last chunk and takes a new chunk from a NodePool when there are none.
+ *
+ * Iterators work like those of List. Inserting or erasing moves elements
+ * within one chunk, so it invalidates iterators into that chunk only,
+ * the returned iterator is the one to go on with.
+ */
+template<class T, size_t Capacity = default_chunk_capacity<T>()>
+class UnrolledList {
+public:
+    class Iterator;
+
+    Iterator begin();
+    Iterator end();
+
+    UnrolledList() : head_(nullptr), tail_(nullptr), size_(0) {}
+    UnrolledList(const UnrolledList &src);
+    UnrolledList(UnrolledList &&src) noexcept;
+
+    ~UnrolledList() { clear(); }
+
+    UnrolledList &operator=(const UnrolledList &src);
+    UnrolledList &operator=(UnrolledList &&src) noexcept;
+
+    void swap(UnrolledList &other) noexcept;
+
+    void push_back(const T &value) { emplace_back(value); }
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+    void push_front(const T &value) { emplace_front(value); }
+    void push_front(T &&value) { emplace_front(std::move(value)); }
+    template<class... Args>
+    T &emplace_back(Args &&...args);
+    template<class... Args>
+    T &emplace_front(Args &&...args);
+    void pop_back();
+    void pop_front();
+
+    /*
+     * Skips whole chunks, so it takes time proportional to the number of
+     * chunks before the element.
+     */
+    T &at(size_t i);
+
+    /*
+     * Inserts before the position, which may be past the end. Returns
+     * the inserted element.
+     */
+    Iterator insert(const Iterator &pos, const T &value) { return emplace(pos, value); }
+    Iterator insert(const Iterator &pos, T &&value) { return emplace(pos, std::move(value)); }
+    template<class... Args>
+    Iterator emplace(const Iterator &pos, Args &&...args);
+    /*
+     * Returns the element after the erased one.
+     */
+    Iterator erase(const Iterator &pos);
+
+    void clear();
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+private:
+    static_assert(Capacity >= 2, "Chunks must hold at least two elements.");
+
+    /*
+     * Elements live in slots [first, last) of a chunk, which is never
+     * empty while it's in the list.
+     */
+    struct Chunk {
+        Chunk *next;
+        Chunk *prev;
+        size_t first;
+        size_t last;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[Capacity];
+
+        T *slot(size_t i) { return reinterpret_cast<T *>(&slots[i]); }
+        size_t count() const { return last - first; }
+    };
+
+    static Chunk *create_chunk(size_t first);
+    static void destroy_chunk(Chunk *chunk);
+    /*
+     * Moves the element of one slot to another, empty one.
+     */
+    static void relocate(Chunk *from, size_t i, Chunk *to, size_t j);
+
+    void link_after(Chunk *chunk, Chunk *prev);
+    void unlink(Chunk *chunk);
+    /*
+     * Moves the upper half of a full chunk to a new one after it.
+     */
+    Chunk *split(Chunk *chunk);
+
+    Chunk *head_;
+    Chunk *tail_;
+    size_t size_;
+};
+
+
+template<class T, size_t Capacity>
+class UnrolledList<T, Capacity>::Iterator {
+public:
+    Iterator() : chunk_(nullptr), slot_(0), past_the_end_(false) {}
+    Iterator(Chunk *chunk, size_t slot)
+        : chunk_(chunk), slot_(slot), past_the_end_(false)
+    {}
+
+    Iterator &operator++();
+    Iterator operator++(int);
+
+    Iterator &operator--();
+    Iterator operator--(int);
+
+    bool operator==(const Iterator &other) const;
+    bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+    T &operator*() const;
+    T *operator->() const { return &**this; }
+
+    operator bool() const { return past_the_end_ || !chunk_; }
+
+    friend class UnrolledList;
+private:
+    Chunk *chunk_;
+    size_t slot_;
+    bool past_the_end_;
+};
+
+
+template<class T, size_t Capacity>
+typename UnrolledList<T, Capacity>::Chunk *UnrolledList<T, Capacity>::create_chunk(size_t first)
+{
+    Chunk *chunk = static_cast<Chunk *>(NodePool<sizeof(Chunk)>::allocate());
+    chunk->next = chunk->prev = nullptr;
+    chunk->first = chunk->last = first;
+    return chunk;
+}
+
+template<class T, size_t Capacity>
+void UnrolledList<T, Capacity>::destroy_chunk(Chunk *chunk)
+{
+    for (size_t i = chunk->first; i != chunk->last; ++i)
+        chunk->slot(i)->~T();
+    NodePool<sizeof(Chunk)>::deallocate(chunk);
+}
+
+template<class T, size_t Capacity>
+void UnrolledList<T, Capacity>::relocate(Chunk *from, size_t i, Chunk *to, size_t j)
+{
+    new (to->slot(j)) T(std::move(*from->slot(i)));
+    from->slot(i)->~T();
+}
+
+
+template<class T, size_t Capacity>
+void UnrolledList<T, Capacity>::link_after(Chunk *chunk, Chunk *prev)
+{
+    Chunk *next = prev ? prev->next : head_;
+    chunk->prev = prev;
+    chunk->next = next;
+    if (prev)
+        prev->next = chunk;
+    else
+        head_ = chunk;
+    if (next)
+        next->prev = chunk;
+    else
+        tail_ = chunk;
+}
+
+template<class T, size_t Capacity>
+void UnrolledList<T, Capacity>::unlink(Chunk *chunk)
+{
+    if (chunk->prev)
+        chunk->prev->next = chunk->next;
+    else
+        head_ = chunk->next;
+    if (chunk->next)
+        chunk->next->prev = chunk->prev;
+    else
+        tail_ = chunk->prev;
+}
+
+template<class T, size_t Capacity>
+typename UnrolledList<T, Capacity>::Chunk *UnrolledList<T, Capacity>::split(Chunk *chunk)
+{
+    Chunk *upper = create_chunk(0);
+    const size_t middle = chunk->first + chunk->count() / 2;
+    for (size_t i = middle; i != chunk->last; ++i)
+        relocate(chunk, i, upper, upper->last++);
+    chunk->last = middle;
+    link_after(upper, chunk);
+    return upper;
+}
+
+
+template<class T, size_t Capacity>
+typename UnrolledList<T, Capacity>::Iterator UnrolledList<T, Capacity>::begin()
+{
+    if (!head_)
+        return end();
+    return Iterator(head_, head_->first);
+}
+
+template<class T, size_t Capacity>
+typename UnrolledList<T, Capacity>::Iterator UnrolledList<T, Capacity>::end()
+{
+    Iterator it;
+    it.past_the_end_ = true;
+    return it;
+}
+
+
+template<class T, size_t Capacity>
+UnrolledList<T, Capacity>::UnrolledList(const UnrolledList &src) : UnrolledList()
+{
+    for (Chunk *chunk = src.head_; chunk; chunk = chunk->next) {
+        for (size_t i = chunk->first; i != chunk->last; ++i)
+            emplace_back(*chunk->slot(i));
+    }
+}
+
+template<class T, size_t Capacity>
+UnrolledList<T, Capacity>::UnrolledList(UnrolledList &&src) noexcept
+    : head_(src.head_), tail_(src.tail_), size_(src.size_)
+{
+    src.head_ = src.tail_ = nullptr;
+    src.size_ = 0;
+}
+
+template<class T, size_t Capacity>
+UnrolledList<T, Capacity> &UnrolledList<T, Capacity>::operator=(const UnrolledList &src)
+{
+    if (this != &src) {
+        UnrolledList copy(src);
+        swap(copy);
+    }
+    return *this;
+}
+
+template<class T, size_t Capacity>
+UnrolledList<T, Capacity> &UnrolledList<T, Capacity>::operator=(UnrolledList &&src) noexcept
+{
+    if (this != &src) {
+        clear();
+        swap(src);
+    }
+    return *this;
+}
+
+template<class T, size_t Capacity>
+void UnrolledList<T, Capacity>::swap(UnrolledList &other) noexcept
+{
+    std::swap(head_, other.head_);
+    std::swap(tail_, other.tail_);
+    std::swap(size_, other.size_);
+}
+
+
+template<class T, size_t Capacity>
+template<class... Args>
+T &UnrolledList<T, Capacity>::emplace_back(Args &&...args)
+{
+    if (!tail_ || tail_->last == Capacity) {
+        // A new chunk is kept only once its element is constructed
+        Chunk *chunk = create_chunk(0);
+        try {
+            new (chunk->slot(0)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            NodePool<sizeof(Chunk)>::deallocate(chunk);
+            throw;
+        }
+        chunk->last = 1;
+        link_after(chunk, tail_);
+    } else {
+        new (tail_->slot(tail_->last)) T(std::forward<Args>(args)...);
+        ++tail_->last;
+    }
+    ++size_;
+    return *tail_->slot(tail_->last - 1);
+}
+
+template<class T, size_t Capacity>
+template<class... Args>
+T &UnrolledList<T, Capacity>::emplace_front(Args &&...args)
+{
+    if (!head_ || head_->first == 0) {
+        // Filled from the top, so the next pushes in front find room
+        Chunk *chunk = create_chunk(Capacity);
+        try {
+            new (chunk->slot(Capacity - 1)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            NodePool<sizeof(Chunk)>::deallocate(chunk);
+            throw;
+        }
+        chunk->first = Capacity - 1;
+        link_after(chunk, nullptr);
+    } else {
+        new (head_->slot(head_->first - 1)) T(std::forward<Args>(args)...);
+        --head_->first;
+    }
+    ++size_;
+    return *head_->slot(head_->first);
+}
+
+template<class T, size_t Capacity>
+void UnrolledList<T, Capacity>::pop_back()
+{
+    if (empty())
+        return;
+    Chunk *chunk = tail_;
+    chunk->slot(--chunk->last)->~T();
+    if (chunk->count() == 0) {
+        unlink(chunk);
+        destroy_chunk(chunk);
+    }
+    --size_;
+}
+
+template<class T, size_t Capacity>
+void UnrolledList<T, Capacity>::pop_front()
+{
+    if (empty())
+        return;
+    Chunk *chunk = head_;
+    chunk->slot(chunk->first++)->~T();
+    if (chunk->count() == 0) {
+        unlink(chunk);
+        destroy_chunk(chunk);
+    }
+    --size_;
+}
+
+
+template<class T, size_t Capacity>
+T &UnrolledList<T, Capacity>::at(size_t i)
+{
+    if (i >= size_)
+        throw std::out_of_range("Index out of range.");
+    if (i >= size_ / 2) {
+        size_t from_end = size_ - i;
+        Chunk *chunk = tail_;
+        while (from_end > chunk->count()) {
+            from_end -= chunk->count();
+            chunk = chunk->prev;
+        }
+        return *chunk->slot(chunk->last - from_end);
+    }
+    Chunk *chunk = head_;
+    while (i >= chunk->count()) {
+        i -= chunk->count();
+        chunk = chunk->next;
+    }
+    return *chunk->slot(chunk->first + i);
+}
+
+
+template<class T, size_t Capacity>
+template<class... Args>
+typename UnrolledList<T, Capacity>::Iterator UnrolledList<T, Capacity>::emplace(const Iterator &pos, Args &&...args)
+{
+    if (pos.past_the_end_) {
+        emplace_back(std::forward<Args>(args)...);
+        return Iterator(tail_, tail_->last - 1);
+    }
+    if (!pos.chunk_)
+        throw std::logic_error("Position given by unbound iterator.");
+    if (pos.chunk_ == head_ && pos.slot_ == head_->first) {
+        emplace_front(std::forward<Args>(args)...);
+        return begin();
+    }
+
+    Chunk *chunk = pos.chunk_;
+    size_t slot = pos.slot_;
+    if (chunk->count() == Capacity) {
+        Chunk *upper = split(chunk);
+        if (slot >= chunk->last) {
+            slot -= chunk->last;
+            chunk = upper;
+        }
+    }
+    // The element is built aside, the chunk is shifted only once it's there
+    T value(std::forward<Args>(args)...);
+    if (chunk->last < Capacity) {
+        for (size_t i = chunk->last; i != slot; --i)
+            relocate(chunk, i - 1, chunk, i);
+        ++chunk->last;
+    } else {
+        --slot;
+        for (size_t i = chunk->first; i != slot + 1; ++i)
+            relocate(chunk, i, chunk, i - 1);
+        --chunk->first;
+    }
+    new (chunk->slot(slot)) T(std::move(value));
+    ++size_;
+    return Iterator(chunk, slot);
+}
+
+template<class T, size_t Capacity>
+typename UnrolledList<T, Capacity>::Iterator UnrolledList<T, Capacity>::erase(const Iterator &pos)
+{
+    if (pos.past_the_end_)
+        throw std::out_of_range("Erasing past-the-end iterator.");
+    if (!pos.chunk_)
+        throw std::out_of_range("Erasing unbound iterator.");
+    Chunk *chunk = pos.chunk_;
+    const size_t slot = pos.slot_;
+    chunk->slot(slot)->~T();
+    for (size_t i = slot + 1; i != chunk->last; ++i)
+        relocate(chunk, i, chunk, i - 1);
+    --chunk->last;
+    --size_;
+    if (slot != chunk->last)
+        return Iterator(chunk, slot);
+    Chunk *next = chunk->next;
+    if (chunk->count() == 0) {
+        unlink(chunk);
+        destroy_chunk(chunk);
+    }
+    return next ? Iterator(next, next->first) : end();
+}
+
+
+template<class T, size_t Capacity>
+void UnrolledList<T, Capacity>::clear()
+{
+    while (head_) {
+        Chunk *next = head_->next;
+        destroy_chunk(head_);
+        head_ = next;
+    }
+    tail_ = nullptr;
+    size_ = 0;
+}
+
+
+template<class T, size_t Capacity>
+typename UnrolledList<T, Capacity>::Iterator &UnrolledList<T, Capacity>::Iterator::operator++()
+{
+    if (past_the_end_)
+        throw std::out_of_range("Traversing with past-the-end iterator.");
+    if (!chunk_)
+        throw std::logic_error("Traversing with unbound iterator.");
+    if (++slot_ == chunk_->last) {
+        chunk_ = chunk_->next;
+        if (chunk_)
+            slot_ = chunk_->first;
+        else
+            past_the_end_ = true;
+    }
+    return *this;
+}
+
+template<class T, size_t Capacity>
+typename UnrolledList<T, Capacity>::Iterator UnrolledList<T, Capacity>::Iterator::operator++(int)
+{
+    Iterator tmp = *this;
+    operator++();
+    return tmp;
+}
+
+
+template<class T, size_t Capacity>
+typename UnrolledList<T, Capacity>::Iterator &UnrolledList<T, Capacity>::Iterator::operator--()
+{
+    if (past_the_end_)
+        throw std::out_of_range("Traversing with past-the-end iterator.");
+    if (!chunk_)
+        throw std::out_of_range("Traversing with unbound iterator.");
+    if (slot_ == chunk_->first) {
+        chunk_ = chunk_->prev;
+        if (chunk_)
+            slot_ = chunk_->last;
+    }
+    --slot_;
+    return *this;
+}
+
+template<class T, size_t Capacity>
+typename UnrolledList<T, Capacity>::Iterator UnrolledList<T, Capacity>::Iterator::operator--(int)
+{
+    Iterator tmp = *this;
+    operator--();
+    return tmp;
+}
+
+
+template<class T, size_t Capacity>
+bool UnrolledList<T, Capacity>::Iterator::operator==(const Iterator &other) const
+{
+    if (past_the_end_ && other.past_the_end_)
+        return true;
+    if (!chunk_ || !other.chunk_)
+        return false;
+    return chunk_ == other.chunk_ && slot_ == other.slot_;
+}
+
+template<class T, size_t Capacity>
+T &UnrolledList<T, Capacity>::Iterator::operator*() const
+{
+    if (past_the_end_)
+        throw std::out_of_range("Dereferencing past-the-end iterator.");
+    if (!chunk_)
+        throw std::out_of_range("Dereferencing unbound iterator.");
+    return *chunk_->slot(slot_);
+}
+
+}   // namespace data_structs
+
+#endif  // UNROLLED_LIST_HH
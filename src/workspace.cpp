@@ -0,0 +1,203 @@
+#include "workspace.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "numbers.hh"
+#include "parsing.hh"
+#include "parsing-exceptions.hh"
+#include "parsing-table.hh"
+#include "precedence-parser.hh"
+#include "scanner.hh"
+
+namespace infix_parsing {
+
+using calculation::UnaryOperator;
+using calculation::BinaryOperator;
+using calculation::Variable;
+
+
+namespace {
+
+/*
+ * Expression text of a string from the start position on.
+ */
+class StringSource {
+public:
+    StringSource(const std::string &string, size_t start, const Scope *scope, std::string &name)
+        : string_(string), pos_(start), scope_(scope), name_(name)
+    {}
+
+    bool at_end() const { return pos_ >= string_.size(); }
+    void skip_spaces()
+    {
+        const char *data = string_.data();
+        pos_ = Scanner::skip_spaces(data + pos_, data + string_.size()) - data;
+    }
+    char peek() const { return string_[pos_]; }
+    void advance(size_t n) { pos_ += n; }
+    size_t position() const { return pos_; }
+    const char *lookahead(size_t &n)
+    {
+        n = std::min(n, string_.size() - pos_);
+        return string_.data() + pos_;
+    }
+
+    double number()
+    {
+        double value;
+        try {
+            pos_ += calculation::Numbers::parse(string_.data() + pos_, string_.data() + string_.size(), value);
+        } catch (const std::out_of_range &) {
+            throw TooBigNumber(pos_);
+        }
+        return value;
+    }
+
+    /*
+     * Looks for a whole identifier of the scope at the position.
+     */
+    const Variable *match_variable()
+    {
+        if (!scope_)
+            return nullptr;
+        const char *data = string_.data();
+        const size_t end = Scanner::skip_identifier(data + pos_, data + string_.size()) - data;
+        if (end == pos_)
+            return nullptr;
+        // Identifiers may be longer than any table name, the buffer grows
+        // only for the longest of them
+        name_.assign(string_, pos_, end - pos_);
+        Scope::const_iterator it = scope_->find(name_);
+        if (it == scope_->end())
+            return nullptr;
+        pos_ = end;
+        return it->second.get();
+    }
+private:
+    const std::string &string_;
+    size_t pos_;
+    const Scope *scope_;
+    std::string &name_;
+};
+
+}   // namespace
+
+
+Workspace::Workspace(const ParsingContext &context)
+    : context_(context), depth_(0), max_depth_(0)
+{}
+
+
+void Workspace::parse(const std::string &string, size_t start)
+{
+    compile(string, start, nullptr);
+}
+
+void Workspace::parse(const std::string &string, const Scope &scope, size_t start)
+{
+    compile(string, start, &scope);
+}
+
+double Workspace::evaluate(const std::string &string, size_t start)
+{
+    compile(string, start, nullptr);
+    return evaluate();
+}
+
+double Workspace::evaluate(const std::string &string, const Scope &scope, size_t start)
+{
+    compile(string, start, &scope);
+    return evaluate();
+}
+
+
+double Workspace::evaluate()
+{
+    // The same as an empty string
+    if (program_.empty())
+        return 0;
+
+    if (values_.size() < max_depth_)
+        values_.resize(max_depth_);
+    double *top = values_.data() - 1;
+    for (const Instruction &i : program_) {
+        switch (i.kind) {
+        case Instruction::value:
+            *++top = i.number;
+            break;
+        case Instruction::variable:
+            *++top = i.var->evaluate();
+            break;
+        case Instruction::unary:
+            *top = i.unary_op->function(*top);
+            break;
+        case Instruction::binary:
+            --top;
+            *top = i.binary_op->function(top[0], top[1]);
+            break;
+        }
+    }
+    return *top;
+}
+
+
+void Workspace::compile(const std::string &string, size_t start, const Scope *scope)
+{
+    table_ = context_.snapshot();
+    program_.clear();
+    depth_ = max_depth_ = 0;
+    // Names are never longer, matching them only reuses the buffer
+    name_.reserve(table_->longest_name());
+
+    StringSource source(string, start, scope, name_);
+    PrecedenceParser<StringSource, Workspace> parser(*table_, source, *this, pending_, name_);
+    try {
+        parser.run();
+    } catch (...) {
+        // A half compiled program must not be evaluated
+        program_.clear();
+        throw;
+    }
+}
+
+
+void Workspace::push_value(double value)
+{
+    emit({Instruction::value, {value}});
+}
+
+void Workspace::push_variable(const Variable *variable)
+{
+    Instruction load = {Instruction::variable, {0}};
+    load.var = variable;
+    emit(load);
+}
+
+void Workspace::apply(const UnaryOperator::Descriptor *op)
+{
+    Instruction call = {Instruction::unary, {0}};
+    call.unary_op = op;
+    emit(call);
+}
+
+void Workspace::apply(const BinaryOperator::Descriptor *op)
+{
+    Instruction call = {Instruction::binary, {0}};
+    call.binary_op = op;
+    emit(call);
+}
+
+void Workspace::emit(const Instruction &instruction)
+{
+    program_.push_back(instruction);
+    if (instruction.kind == Instruction::value || instruction.kind == Instruction::variable)
+        max_depth_ = std::max(max_depth_, ++depth_);
+    else if (instruction.kind == Instruction::binary)
+        --depth_;
+}
+
+}   // namespace infix_parsing
@@ -0,0 +1,105 @@
+#pragma once
+#ifndef WORKSPACE_HH
+#define WORKSPACE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "calculation-tree.hh"
+#include "parsing.hh"
+#include "parsing-table.hh"
+#include "precedence-parser.hh"
+
+namespace infix_parsing {
+
+/*
+ * Workspace parses an expression into a flat postfix program and
+ * evaluates it, keeping every buffer it needs between calls: the
+ * program, the operator stack of the parser, the value stack and the
+ * buffer names are matched in. Buffers only grow, so once a workspace
+ * has seen an expression of some size, parsing and evaluating any other
+ * one up to that size allocates nothing.
+ *
+ * Expressions are read the same way parse_expression() reads them and
+ * errors are thrown as the parser's exceptions. Variables are read from
+ * the scope when the program is evaluated, not when it's parsed, so a
+ * program may be evaluated again after they change. The scope has to
+ * outlive the program.
+ *
+ * A workspace is meant to be owned by one caller, it isn't thread safe.
+ */
+class Workspace {
+public:
+    explicit Workspace(const ParsingContext &context = ParsingContext::global());
+    Workspace(const Workspace &) = delete;
+
+    /*
+     * Replaces the program with the expression in the string.
+     */
+    void parse(const std::string &string, size_t start = 0);
+    void parse(const std::string &string, const Scope &scope, size_t start = 0);
+
+    /*
+     * Evaluates the last parsed program.
+     */
+    double evaluate();
+    /*
+     * Parses the expression and evaluates it.
+     */
+    double evaluate(const std::string &string, size_t start = 0);
+    double evaluate(const std::string &string, const Scope &scope, size_t start = 0);
+
+    /*
+     * Number of instructions of the program.
+     */
+    size_t size() const { return program_.size(); }
+private:
+    struct Instruction {
+        enum Kind : uint8_t {
+            value,
+            variable,
+            unary,
+            binary,
+        };
+
+        Kind kind;
+        union {
+            double number;
+            const calculation::Variable *var;
+            const calculation::UnaryOperator::Descriptor *unary_op;
+            const calculation::BinaryOperator::Descriptor *binary_op;
+        };
+    };
+
+    template<typename Source, typename Sink>
+    friend class PrecedenceParser;
+
+    void compile(const std::string &string, size_t start, const Scope *scope);
+
+    // Sink of the parser
+    void push_value(double value);
+    void push_variable(const calculation::Variable *variable);
+    void apply(const calculation::UnaryOperator::Descriptor *op);
+    void apply(const calculation::BinaryOperator::Descriptor *op);
+
+    void emit(const Instruction &instruction);
+
+    const ParsingContext &context_;
+    std::shared_ptr<const SymbolTable> table_;
+
+    std::string name_;
+    std::vector<Instruction> program_;
+    std::vector<PendingOperator> pending_;
+    std::vector<double> values_;
+    // Values the program keeps on the stack at once, counted while it's
+    // emitted
+    size_t depth_;
+    size_t max_depth_;
+};
+
+}   // namespace infix_parsing
+
+#endif  // WORKSPACE_HH
@@ -0,0 +1,165 @@
+#include "../src/batch.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "../src/parsing.hh"
+
+using namespace std;
+using io::BatchProcessor;
+using infix_parsing::init_table;
+
+
+/*
+ * Parsing module heavily depends on the ParsingTable module init, so
+ * this test always has to be run.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+
+static string process(const string &input, BatchProcessor::Output output)
+{
+    BatchProcessor processor(output);
+    string out;
+    processor.process(input.data(), input.data() + input.size(), out);
+    return out;
+}
+
+TEST(Process, Values)
+{
+    ASSERT_EQ(process("1 + 2\n2 * 3\n", BatchProcessor::value), "3\n6\n");
+    ASSERT_EQ(process("1 + 2\r\n\n0.5", BatchProcessor::value), "3\n\n0.5\n");
+}
+
+TEST(Process, Trees)
+{
+    ASSERT_EQ(process("(1+2)*3\n-2^2\n", BatchProcessor::tree), "(1 + 2) * 3\t9\n- 2 ^ 2\t4\n");
+}
+
+TEST(Process, ErrorsDontStop)
+{
+    ASSERT_EQ(process("1 +\n2\n3 $ 4\n", BatchProcessor::value),
+              "error\t1\t3\tUnexpected end of string expression.\n"
+              "2\n"
+              "error\t3\t5\tUnexpected end of string expression.\n");
+    ASSERT_EQ(process("1 +\n2\n\n(3\n", BatchProcessor::errors),
+              "error\t1\t3\tUnexpected end of string expression.\n"
+              "error\t4\t2\tUnexpected end of string expression.\n");
+
+    BatchProcessor processor;
+    string out;
+    const string input = "1\n+\n2\n";
+    ASSERT_EQ(processor.process(input.data(), input.data() + input.size(), out, 10), 3u);
+    ASSERT_EQ(out.substr(0, 11), "1\nerror\t11\t");
+    ASSERT_EQ(processor.lines(), 3u);
+    ASSERT_EQ(processor.failures(), 1u);
+}
+
+
+class TemporaryFile {
+public:
+    TemporaryFile()
+    {
+        char path[] = "/tmp/batch-test-XXXXXX";
+        fd = mkstemp(path);
+        unlink(path);
+    }
+    ~TemporaryFile() { close(fd); }
+
+    void write_all(const string &data)
+    {
+        ASSERT_EQ(write(fd, data.data(), data.size()), ssize_t(data.size()));
+        lseek(fd, 0, SEEK_SET);
+    }
+    string read_all()
+    {
+        lseek(fd, 0, SEEK_SET);
+        string res;
+        char buffer[4096];
+        ssize_t got;
+        while ((got = read(fd, buffer, sizeof(buffer))) > 0)
+            res.append(buffer, got);
+        return res;
+    }
+
+    int fd;
+};
+
+/*
+ * The input takes several blocks and has lines cut between reads.
+ */
+TEST(Run, ManyBlocks)
+{
+    string input, expected;
+    for (int i = 0; i < 300000; ++i) {
+        input += to_string(i) + " * 2\n";
+        expected += to_string(i * 2) + "\n";
+    }
+    input += "1 +";
+    expected += "error\t300001\t3\tUnexpected end of string expression.\n";
+
+    TemporaryFile in, out;
+    in.write_all(input);
+    BatchProcessor processor;
+    processor.run(in.fd, out.fd);
+    ASSERT_EQ(processor.lines(), 300001u);
+    ASSERT_EQ(processor.failures(), 1u);
+    ASSERT_EQ(out.read_all(), expected);
+}
+
+TEST(Run, LineLongerThanBlock)
+{
+    const string input = string(BatchProcessor::block_size * 2, ' ') + "1 + 1\n2\n";
+
+    TemporaryFile in, out;
+    in.write_all(input);
+    BatchProcessor processor;
+    processor.run(in.fd, out.fd);
+    ASSERT_EQ(out.read_all(), "2\n2\n");
+}
+
+/*
+ * Chunks are tiny, so threads finish them out of order.
+ */
+TEST(Parallel, SameAsSingleThread)
+{
+    string input;
+    for (int i = 0; i < 20000; ++i)
+        input += i % 97 == 0 ? "1 +\n" : i % 89 == 0 ? "\n" : to_string(i) + " / 3\n";
+    input += "7";
+
+    for (auto output : {BatchProcessor::value, BatchProcessor::tree, BatchProcessor::errors}) {
+        string expected;
+        BatchProcessor single(output);
+        single.process(input.data(), input.data() + input.size(), expected);
+
+        TemporaryFile out;
+        io::ParallelBatch parallel(output, 4, 64);
+        parallel.run(input.data(), input.data() + input.size(), out.fd);
+        ASSERT_EQ(out.read_all(), expected);
+        ASSERT_EQ(parallel.lines(), single.lines());
+        ASSERT_EQ(parallel.failures(), single.failures());
+    }
+}
+
+TEST(Parallel, WriteError)
+{
+    const string input = "1\n2\n";
+    io::ParallelBatch parallel(BatchProcessor::value, 2, 1);
+    ASSERT_THROW(parallel.run(input.data(), input.data() + input.size(), -1), std::system_error);
+}
+
+TEST(Run, ReadError)
+{
+    BatchProcessor processor;
+    ASSERT_THROW(processor.run(-1, STDOUT_FILENO), std::system_error);
+}
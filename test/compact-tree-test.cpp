@@ -0,0 +1,120 @@
+#include "../src/compact-tree.hh"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/calculation-tree.hh"
+#include "../src/parsing.hh"
+#include "../src/symbols.hh"
+
+using namespace std;
+using namespace calculation;
+using infix_parsing::init_table;
+using infix_parsing::parse_expression;
+
+
+TEST(Symbols, Interning)
+{
+    ASSERT_EQ(Symbols::intern(""), Symbols::none);
+    Symbols::Id a = Symbols::intern("interned-a");
+    Symbols::Id b = Symbols::intern("interned-b");
+    ASSERT_NE(a, b);
+    ASSERT_EQ(Symbols::intern("interned-a"), a);
+    ASSERT_EQ(Symbols::name(a), "interned-a");
+    ASSERT_EQ(Symbols::name(b), "interned-b");
+    ASSERT_THROW(Symbols::name(Symbols::size()), out_of_range);
+}
+
+TEST(Symbols, Nodes)
+{
+    Constant pi(3.14, "pi");
+    ASSERT_EQ(pi.str(), "pi");
+    ASSERT_EQ(pi.name(), Symbols::intern("pi"));
+    ASSERT_EQ(Constant(2).str(), "2");
+    ASSERT_EQ(Constant(2.3).str(), "2.3");
+    ASSERT_EQ(Constant(0.1 + 0.2).str(), "0.30000000000000004");
+    UnaryOperator neg("-", negate<double>());
+    ASSERT_EQ(neg.repr(), "-");
+}
+
+
+/*
+ * Parsing module heavily depends on the ParsingTable module init, so
+ * this test always has to be run.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+static const vector<string> sources = {
+    "2",
+    "pi",
+    "-2 + 3 * 4",
+    "(3-2)*3",
+    "3^(2*3)",
+    "log (10 * 10)",
+    "sin (pi/6) + cos pi - abs(-3) / sqrt 4",
+};
+
+TEST(Compact, SameAsTree)
+{
+    for (auto &s : sources) {
+        shared_ptr<Operand> tree = parse_expression(s);
+        CompactTree compact(tree);
+        ASSERT_EQ(compact.evaluate(), tree->evaluate()) << s;
+        ASSERT_EQ(compact.str(), tree->str()) << s;
+    }
+}
+
+TEST(Compact, Layout)
+{
+    CompactTree compact(parse_expression("2 + 1"));
+    ASSERT_EQ(compact.size(), 3);
+    ASSERT_EQ(compact.opcode(0), CompactTree::constant);
+    ASSERT_EQ(compact.payload(0).value, 2);
+    ASSERT_EQ(compact.symbol(0), Symbols::none);
+    ASSERT_EQ(compact.opcode(2), CompactTree::binary);
+    ASSERT_EQ(compact.symbol(2), Symbols::intern("+"));
+}
+
+TEST(Compact, Memory)
+{
+    string text = "1";
+    for (int i = 0; i < 1000; ++i)
+        text += " + " + to_string(i) + " * pi";
+    CompactTree compact(parse_expression(text));
+    ASSERT_EQ(compact.size(), 4001);
+    // Three columns and a couple of function slots
+    ASSERT_LT(compact.memory(), compact.size() * 14);
+}
+
+TEST(Compact, DeepExpression)
+{
+    string text = "1";
+    for (int i = 0; i < 200; ++i)
+        text = "1 - (" + text + ")";
+    shared_ptr<Operand> tree = parse_expression(text);
+    ASSERT_EQ(CompactTree(tree).evaluate(), tree->evaluate());
+    ASSERT_EQ(CompactTree(tree).str(), tree->str());
+
+    // Left leaning and right leaning chains with unary operators
+    string left = "1", right = "1";
+    for (int i = 0; i < 200; ++i) {
+        left = "sqrt (" + left + ") * 2";
+        right = "2 ^ -(" + right + ")";
+    }
+    for (auto &s : {left, right}) {
+        tree = parse_expression(s);
+        ASSERT_EQ(CompactTree(tree).str(), tree->str());
+    }
+}
+
+TEST(Compact, Variables)
+{
+    ASSERT_THROW(CompactTree(make_shared<Variable>("x")), invalid_argument);
+}
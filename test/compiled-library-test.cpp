@@ -0,0 +1,127 @@
+#include "../src/compiled-library.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/calculation-tree.hh"
+#include "../src/parsing.hh"
+#include "../src/parsing-table.hh"
+
+using namespace std;
+using namespace infix_parsing;
+using namespace calculation;
+
+
+/*
+ * Symbols are bound to the default parsing table on load, so it has to
+ * be initialized first.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+
+static const vector<string> sources = {
+    "2",
+    "pi",
+    "-2 + 3 * 4",
+    "(3-2)*3",
+    "3^(2*3)",
+    "log (10 * 10)",
+    "sin (pi/6) + cos pi - abs(-3) / sqrt 4",
+};
+
+static string compile(const vector<string> &exprs)
+{
+    CompiledLibraryWriter writer;
+    for (size_t i = 0; i < exprs.size(); ++i)
+        writer.add("f" + to_string(i), parse_expression(exprs[i]));
+    ostringstream out;
+    writer.write(out);
+    return out.str();
+}
+
+TEST(Compiled, InMemory)
+{
+    string image = compile(sources);
+    // std::string buffers are not guaranteed to be aligned for doubles
+    vector<double> aligned(image.size() / sizeof(double) + 1);
+    memcpy(aligned.data(), image.data(), image.size());
+
+    CompiledLibrary lib(aligned.data(), image.size());
+    ASSERT_EQ(lib.size(), sources.size());
+    for (size_t i = 0; i < sources.size(); ++i) {
+        ASSERT_EQ(lib.name(i), "f" + to_string(i));
+        ASSERT_EQ(lib.find("f" + to_string(i)), i);
+        ASSERT_EQ(lib.evaluate(i), parse_expression(sources[i])->evaluate());
+    }
+    ASSERT_THROW(lib.find("g"), ParsingTable::NameSearchError);
+    ASSERT_THROW(lib.evaluate(sources.size()), out_of_range);
+}
+
+TEST(Compiled, Mapped)
+{
+    CompiledLibraryWriter writer;
+    for (size_t i = 0; i < sources.size(); ++i)
+        writer.add("f" + to_string(i), parse_expression(sources[i]));
+    string path = testing::TempDir() + "compiled-library-test.bin";
+    writer.save(path);
+
+    CompiledLibrary lib(path);
+    ASSERT_EQ(lib.size(), sources.size());
+    for (size_t i = 0; i < sources.size(); ++i)
+        ASSERT_EQ(lib.evaluate(i), parse_expression(sources[i])->evaluate());
+    remove(path.c_str());
+}
+
+TEST(Compiled, DeepExpression)
+{
+    // Right-leaning chain needs a stack deeper than the local one
+    string text = "1";
+    for (int i = 0; i < 200; ++i)
+        text = "1 - (" + text + ")";
+    string image = compile({text});
+    vector<double> aligned(image.size() / sizeof(double) + 1);
+    memcpy(aligned.data(), image.data(), image.size());
+    CompiledLibrary lib(aligned.data(), image.size());
+    ASSERT_EQ(lib.evaluate(0), parse_expression(text)->evaluate());
+}
+
+TEST(Compiled, Variables)
+{
+    CompiledLibraryWriter writer;
+    ASSERT_THROW(writer.add("v", make_shared<Variable>("x")), invalid_argument);
+}
+
+TEST(Compiled, Malformed)
+{
+    string image = compile(sources);
+    vector<double> aligned(image.size() / sizeof(double) + 1);
+    memcpy(aligned.data(), image.data(), image.size());
+
+    ASSERT_THROW(CompiledLibrary(aligned.data(), 4), compiled::FormatError);
+    ASSERT_THROW(CompiledLibrary(aligned.data(), image.size() - 1), compiled::FormatError);
+
+    compiled::Header *header = reinterpret_cast<compiled::Header *>(aligned.data());
+    header->version = compiled::version + 1;
+    ASSERT_THROW(CompiledLibrary(aligned.data(), image.size()), compiled::FormatError);
+    header->version = compiled::version;
+    header->magic = 0;
+    ASSERT_THROW(CompiledLibrary(aligned.data(), image.size()), compiled::FormatError);
+    header->magic = compiled::magic;
+
+    compiled::Node *nodes = reinterpret_cast<compiled::Node *>(
+        reinterpret_cast<char *>(aligned.data()) + sizeof(compiled::Header)
+        + header->expression_count * sizeof(compiled::Entry));
+    nodes[0].opcode = compiled::apply_binary;
+    ASSERT_THROW(CompiledLibrary(aligned.data(), image.size()), compiled::FormatError);
+}
@@ -0,0 +1,162 @@
+#include "../src/concurrent-queue.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using data_structs::BoundedQueue;
+using data_structs::ConcurrentQueue;
+using data_structs::HazardPointers;
+
+
+TEST(Queue, Order)
+{
+    ConcurrentQueue<int> queue;
+    int value = -1;
+    ASSERT_TRUE(queue.empty());
+    ASSERT_FALSE(queue.pop_front(value));
+    for (int i = 0; i < 100; ++i)
+        queue.push_back(i);
+    ASSERT_FALSE(queue.empty());
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(queue.pop_front(value));
+        ASSERT_EQ(value, i);
+    }
+    ASSERT_FALSE(queue.pop_front(value));
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(Queue, Elements)
+{
+    auto shared = std::make_shared<int>(7);
+    {
+        ConcurrentQueue<std::shared_ptr<int>> queue;
+        for (int i = 0; i < 10; ++i)
+            queue.push_back(shared);
+        std::shared_ptr<int> out;
+        queue.pop_front(out);
+        queue.pop_front(out);
+        out.reset();
+        // Popped elements go as soon as their nodes are reclaimed
+        HazardPointers::scan();
+        ASSERT_EQ(shared.use_count(), 9);
+    }
+    ASSERT_EQ(shared.use_count(), 1);
+
+    ConcurrentQueue<std::unique_ptr<int>> queue;
+    queue.emplace_back(new int(1));
+    queue.push_back(std::unique_ptr<int>(new int(2)));
+    std::unique_ptr<int> out;
+    ASSERT_TRUE(queue.pop_front(out));
+    ASSERT_EQ(*out, 1);
+}
+
+/*
+ * Producers push increasing numbers tagged with their index, consumers
+ * check that every producer's numbers come out in order and that none
+ * is lost or seen twice.
+ */
+template<class Queue, class Push>
+static void stress(Queue &queue, Push push, size_t producers, size_t consumers, uint32_t count)
+{
+    std::atomic<uint64_t> popped(0);
+    std::atomic<uint64_t> sum(0);
+    std::atomic<int> out_of_order(0);
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (uint32_t i = 0; i < count; ++i)
+                push(queue, (uint64_t(p) << 32) | i);
+        });
+    }
+    const uint64_t total = uint64_t(producers) * count;
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            std::vector<int64_t> last(producers, -1);
+            uint64_t value;
+            while (popped.load() < total) {
+                if (!queue.pop_front(value)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                popped.fetch_add(1);
+                const size_t p = value >> 32;
+                const int64_t i = value & 0xffffffff;
+                if (i <= last[p])
+                    out_of_order.fetch_add(1);
+                last[p] = i;
+                sum.fetch_add(i);
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    ASSERT_EQ(popped.load(), total);
+    ASSERT_EQ(out_of_order.load(), 0);
+    ASSERT_EQ(sum.load(), uint64_t(producers) * count * (count - 1) / 2);
+}
+
+TEST(Queue, Threads)
+{
+    ConcurrentQueue<uint64_t> queue;
+    stress(queue, [](ConcurrentQueue<uint64_t> &q, uint64_t v) { q.push_back(v); }, 4, 4, 50000);
+    uint64_t value;
+    ASSERT_FALSE(queue.pop_front(value));
+}
+
+TEST(Queue, ThreadsComeAndGo)
+{
+    ConcurrentQueue<uint64_t> queue;
+    for (int round = 0; round < 20; ++round)
+        stress(queue, [](ConcurrentQueue<uint64_t> &q, uint64_t v) { q.push_back(v); }, 2, 2, 2000);
+}
+
+
+TEST(Bounded, Capacity)
+{
+    ASSERT_THROW(BoundedQueue<int>(6), std::invalid_argument);
+    BoundedQueue<int> queue(4);
+    ASSERT_EQ(queue.capacity(), 4u);
+    int value;
+    ASSERT_FALSE(queue.pop_front(value));
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i)
+            ASSERT_TRUE(queue.push_back(i));
+        ASSERT_FALSE(queue.push_back(4));
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_TRUE(queue.pop_front(value));
+            ASSERT_EQ(value, i);
+        }
+        ASSERT_FALSE(queue.pop_front(value));
+    }
+}
+
+TEST(Bounded, Elements)
+{
+    auto shared = std::make_shared<int>(7);
+    {
+        BoundedQueue<std::shared_ptr<int>> queue(8);
+        for (int i = 0; i < 5; ++i)
+            queue.push_back(shared);
+        std::shared_ptr<int> out;
+        queue.pop_front(out);
+        out.reset();
+        ASSERT_EQ(shared.use_count(), 5);
+    }
+    ASSERT_EQ(shared.use_count(), 1);
+}
+
+TEST(Bounded, Threads)
+{
+    BoundedQueue<uint64_t> queue(64);
+    auto push = [](BoundedQueue<uint64_t> &q, uint64_t v) {
+        while (!q.push_back(v))
+            std::this_thread::yield();
+    };
+    stress(queue, push, 4, 4, 50000);
+}
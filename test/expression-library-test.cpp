@@ -0,0 +1,116 @@
+#include "../src/expression-library.hh"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/parsing.hh"
+#include "../src/parsing-table.hh"
+#include "../src/thread-pool.hh"
+
+using namespace std;
+using namespace infix_parsing;
+using concurrency::ThreadPool;
+using Error = ExpressionLibrary::EntryError;
+
+
+/*
+ * Entries are parsed with the default parsing table, so it has to be
+ * initialized first.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+TEST(Indexing, Entries)
+{
+    shared_ptr<ExpressionLibrary> lib;
+    ASSERT_NO_THROW(lib = index_library("# header\n\narea: pi * 2 ^ 2\n  half : 1 / 2\r\nlast:3"));
+    ASSERT_EQ(lib->size(), 3);
+    ASSERT_EQ(lib->name(0), "area");
+    ASSERT_EQ(lib->name(1), "half");
+    ASSERT_EQ(lib->find("last"), 2);
+    ASSERT_THROW(lib->find("none"), ParsingTable::NameSearchError);
+}
+
+TEST(Indexing, Errors)
+{
+    ASSERT_THROW(index_library("a: 1\nb 2"), Error);
+    ASSERT_THROW(index_library("a: 1\na: 2"), Error);
+    ASSERT_THROW(index_library(": 2"), Error);
+    try {
+        index_library("a: 1\n\n  b 2");
+        FAIL();
+    } catch (const Error &e) {
+        ASSERT_EQ(e.line, 3);
+        ASSERT_EQ(e.column, 3);
+    }
+}
+
+TEST(Lazy, ParsedOnFirstUse)
+{
+    shared_ptr<ExpressionLibrary> lib = index_library("a: 1 +\nb: 2 * 3\nc: 4");
+    ASSERT_EQ(lib->parsed_count(), 0);
+    ASSERT_EQ(lib->get("b")->evaluate(), 6);
+    ASSERT_TRUE(lib->is_parsed(1));
+    ASSERT_EQ(lib->parsed_count(), 1);
+    ASSERT_EQ(lib->get("b"), lib->get(1));
+    ASSERT_EQ(lib->parsed_count(), 1);
+}
+
+TEST(Lazy, ErrorPosition)
+{
+    shared_ptr<ExpressionLibrary> lib = index_library("a: 1\nbad: 2 + + 3\nempty:  ");
+    try {
+        lib->get("bad");
+        FAIL();
+    } catch (const Error &e) {
+        ASSERT_EQ(e.name, "bad");
+        ASSERT_EQ(e.line, 2);
+        ASSERT_EQ(e.column, 10);
+        ASSERT_EQ(e.position, 14);
+    }
+    ASSERT_THROW(lib->get("empty"), Error);
+    ASSERT_FALSE(lib->is_parsed(1));
+}
+
+TEST(Eager, ParseAll)
+{
+    string text;
+    for (int i = 0; i < 1000; ++i) {
+        text += "f" + to_string(i) + ": " + to_string(i) + " * 2";
+        if (i % 100 == 7)
+            text += " +";
+        text += "\n";
+    }
+    shared_ptr<ExpressionLibrary> lib = index_library(text);
+    ThreadPool pool(4);
+    vector<Error> errors = lib->parse_all(pool);
+    ASSERT_EQ(errors.size(), 10);
+    for (size_t i = 0; i < errors.size(); ++i) {
+        ASSERT_EQ(errors[i].line, i * 100 + 8);
+        ASSERT_EQ(errors[i].name, "f" + to_string(i * 100 + 7));
+    }
+    ASSERT_EQ(lib->parsed_count(), 990);
+    ASSERT_EQ(lib->get("f999")->evaluate(), 1998);
+}
+
+TEST(File, Mapped)
+{
+    string path = testing::TempDir() + "expression-library-test.txt";
+    {
+        ofstream out(path);
+        out << "x: 2 ^ 10\ny: sin 0\n";
+    }
+    shared_ptr<ExpressionLibrary> lib = open_library(path);
+    ASSERT_EQ(lib->size(), 2);
+    ASSERT_EQ(lib->get("x")->evaluate(), 1024);
+    ASSERT_EQ(lib->get("y")->evaluate(), 0);
+    remove(path.c_str());
+}
@@ -0,0 +1,146 @@
+#include "../src/instrumentation.hh"
+
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../src/allocation-counter.hh"
+#include "../src/calculation-tree.hh"
+#include "../src/parsing.hh"
+
+using namespace std;
+using namespace infix_parsing;
+using diagnostics::AllocationCounter;
+using diagnostics::Stats;
+
+
+/*
+ * Parsing module heavily depends on the ParsingTable module init, so
+ * this test always has to be run.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+
+TEST(Stats, OffByDefault)
+{
+    Stats::reset();
+    parse_expression("1 + 2 * 3")->evaluate();
+    for (unsigned p = 0; p < Stats::phase_count; ++p)
+        ASSERT_EQ(Stats::calls(Stats::Phase(p)), 0u);
+    for (unsigned c = 0; c < Stats::counter_count; ++c)
+        ASSERT_EQ(Stats::count(Stats::Counter(c)), 0u);
+}
+
+TEST(Stats, Counters)
+{
+    Stats::reset();
+    Stats::enable();
+    parse_expression("1 + 2 * (3 - 4)")->evaluate();
+    Stats::disable();
+
+    // Four numbers and three operators; parentheses aren't tokens
+    ASSERT_EQ(Stats::count(Stats::tokens), 7u);
+    // Every token a node, and an expression for each operator
+    ASSERT_EQ(Stats::count(Stats::nodes), 10u);
+    ASSERT_EQ(Stats::count(Stats::lookups), 6u);
+    ASSERT_EQ(Stats::count(Stats::exceptions), 0u);
+
+    // Recursive calls are timed from the outermost one
+    ASSERT_EQ(Stats::calls(Stats::parse), 1u);
+    ASSERT_EQ(Stats::calls(Stats::evaluate), 1u);
+    ASSERT_EQ(Stats::calls(Stats::build), 2u);
+    ASSERT_EQ(Stats::calls(Stats::lex), 4u);
+    ASSERT_GT(Stats::time(Stats::parse), 0u);
+    ASSERT_GE(Stats::time(Stats::parse), Stats::time(Stats::build));
+}
+
+/*
+ * A constant is first tried as a unary operator, which fails with an
+ * exception that the parser catches.
+ */
+TEST(Stats, Exceptions)
+{
+    Stats::reset();
+    Stats::enable();
+    parse_expression("pi");
+    Stats::disable();
+    ASSERT_GT(Stats::count(Stats::exceptions), 0u);
+}
+
+TEST(Stats, Allocations)
+{
+    Stats::count_allocations(nullptr);
+    Stats::reset();
+    Stats::enable();
+    parse_expression("1 + 2");
+    Stats::disable();
+    ASSERT_EQ(Stats::count(Stats::allocations), 0u);
+    ostringstream out;
+    Stats::report(out);
+    ASSERT_EQ(out.str().find(Stats::name(Stats::allocations)), string::npos);
+
+    Stats::count_allocations(AllocationCounter::count);
+    Stats::reset();
+    Stats::enable();
+    parse_expression("1 + 2");
+    Stats::disable();
+    ASSERT_GT(Stats::count(Stats::allocations), 0u);
+}
+
+TEST(Stats, Report)
+{
+    Stats::count_allocations(AllocationCounter::count);
+    Stats::reset();
+    Stats::enable();
+    parse_expression("sin pi");
+    Stats::disable();
+    ostringstream out;
+    Stats::report(out);
+    for (unsigned p = 0; p < Stats::phase_count; ++p)
+        ASSERT_NE(out.str().find(Stats::name(Stats::Phase(p))), string::npos);
+    for (unsigned c = 0; c < Stats::counter_count; ++c)
+        ASSERT_NE(out.str().find(Stats::name(Stats::Counter(c))), string::npos);
+}
+
+
+static size_t occurrences(const string &text, const string &what)
+{
+    size_t n = 0;
+    for (size_t pos = text.find(what); pos != string::npos; pos = text.find(what, pos + 1))
+        ++n;
+    return n;
+}
+
+TEST(Trace, Events)
+{
+    Stats::reset();
+    Stats::enable(true);
+    for (int i = 0; i < 3; ++i)
+        parse_expression("(1 + 2) * 3")->evaluate();
+    Stats::disable();
+
+    ostringstream out;
+    Stats::write_trace(out);
+    const string trace = out.str();
+    ASSERT_EQ(trace.compare(0, 16, "{\"traceEvents\":["), 0);
+    // A parse, three numbers, two operators, two trees and an evaluation
+    ASSERT_EQ(occurrences(trace, "\"ph\":\"X\""), 3 * 9u);
+    ASSERT_EQ(occurrences(trace, "\"name\":\"parse\""), 3u);
+    ASSERT_EQ(occurrences(trace, "\"ph\":\"C\""), 1u);
+    ASSERT_NE(trace.find("\"tokens\":15"), string::npos);
+
+    // Without tracing only the totals are kept
+    Stats::reset();
+    Stats::enable();
+    parse_expression("1 + 2");
+    Stats::disable();
+    ostringstream empty;
+    Stats::write_trace(empty);
+    ASSERT_EQ(occurrences(empty.str(), "\"ph\":\"X\""), 0u);
+    ASSERT_EQ(Stats::calls(Stats::parse), 1u);
+}
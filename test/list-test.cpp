@@ -1,7 +1,11 @@
 #include "../src/list.hh"
 
 #include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
 
 #include <gtest/gtest.h>
 
@@ -388,3 +392,277 @@ TEST_F(ListTest, IteratorDereferencePostfixTest)
     ASSERT_THROW(beg++, std::out_of_range);
     ASSERT_THROW(*beg, std::out_of_range);
 }
+
+
+TEST_F(ListTest, InsertAtIterator)
+{
+    List<int>::Iterator it = list_.begin();
+    ++it;
+    List<int>::Iterator inserted = list_.insert(it, 10);
+    ASSERT_EQ(*inserted, 10);
+    ASSERT_EQ(*it, 1);
+    list_.insert(list_.begin(), 20);
+    list_.insert(list_.end(), 30);
+    ASSERT_EQ(list_.size(), 7);
+    const int expected[] = {20, 0, 10, 1, 2, 3, 30};
+    size_t i = 0;
+    for (int x : list_)
+        ASSERT_EQ(x, expected[i++]);
+    ASSERT_THROW(list_.insert(List<int>::Iterator(), 1), std::logic_error);
+}
+
+TEST_F(ListTest, EraseAtIterator)
+{
+    List<int>::Iterator it = list_.begin();
+    ++it;
+    it = list_.erase(it);
+    ASSERT_EQ(*it, 2);
+    it = list_.erase(list_.begin());
+    ASSERT_EQ(*it, 2);
+    ++it;
+    it = list_.erase(it);
+    ASSERT_TRUE(it == list_.end());
+    ASSERT_EQ(list_.size(), 1);
+    ASSERT_EQ(list_.at(0), 2);
+    ASSERT_THROW(list_.erase(list_.end()), std::out_of_range);
+    list_.erase(list_.begin());
+    ASSERT_TRUE(list_.empty());
+    list_.push_back(5);
+    ASSERT_EQ(list_.at(0), 5);
+}
+
+TEST_F(ListTest, Splice)
+{
+    List<int> other;
+    other.push_back(10);
+    other.push_back(11);
+    List<int>::Iterator pos = list_.begin();
+    ++pos;
+    list_.splice(pos, other);
+    ASSERT_TRUE(other.empty());
+    ASSERT_EQ(list_.size(), 6);
+    const int whole[] = {0, 10, 11, 1, 2, 3};
+    for (size_t i = 0; i < 6; ++i)
+        ASSERT_EQ(list_.at(i), whole[i]);
+
+    // Elements move, iterators to them stay valid
+    List<int>::Iterator last = list_.begin();
+    for (int i = 0; i < 5; ++i)
+        ++last;
+    other.splice(other.end(), list_, last);
+    ASSERT_EQ(*last, 3);
+    ASSERT_EQ(other.size(), 1);
+    ASSERT_EQ(list_.size(), 5);
+
+    List<int>::Iterator first = list_.begin();
+    ++first;
+    other.splice(other.begin(), list_, first, pos);
+    ASSERT_EQ(list_.size(), 3);
+    ASSERT_EQ(other.size(), 3);
+    const int moved[] = {10, 11, 3};
+    for (size_t i = 0; i < 3; ++i)
+        ASSERT_EQ(other.at(i), moved[i]);
+    const int left[] = {0, 1, 2};
+    for (size_t i = 0; i < 3; ++i)
+        ASSERT_EQ(list_.at(i), left[i]);
+
+    list_.splice(list_.end(), other, other.begin(), other.end());
+    ASSERT_TRUE(other.empty());
+    ASSERT_EQ(list_.size(), 6);
+    ASSERT_EQ(list_.at(5), 3);
+    ASSERT_THROW(list_.splice(list_.end(), list_), std::invalid_argument);
+}
+
+TEST_F(ListTest, Range)
+{
+    List<int>::Range whole = list_.range();
+    ASSERT_EQ(whole.size(), 4);
+    ASSERT_EQ(whole.front(), 0);
+
+    List<int>::Iterator middle = list_.begin();
+    ++middle;
+    ++middle;
+    List<int>::Range head(whole.begin(), middle, 2);
+    List<int>::Range tail(middle, whole.end(), 2);
+    int sum = 0;
+    for (int x : head)
+        sum += x;
+    ASSERT_EQ(sum, 1);
+    sum = 0;
+    for (int x : tail)
+        sum += x;
+    ASSERT_EQ(sum, 5);
+    ASSERT_EQ(tail.front(), 2);
+
+    // Views write through to the list
+    head.front() = 7;
+    ASSERT_EQ(list_.at(0), 7);
+
+    List<int>::Range empty(middle, middle, 0);
+    ASSERT_TRUE(empty.empty());
+    ASSERT_TRUE(empty.begin() == empty.end());
+    ASSERT_THROW(empty.front(), std::out_of_range);
+    ASSERT_TRUE(List<int>::Range().begin() == list_.end());
+}
+
+/*
+ * Nodes go back to the pool of the thread and the next list takes them
+ * from there, elements are destroyed when their nodes are.
+ */
+TEST(Pool, NodesAreReused)
+{
+    auto value = std::make_shared<int>(1);
+    typedef List<std::shared_ptr<int>> Pointers;
+    {
+        Pointers list;
+        for (int i = 0; i < 100; ++i)
+            list.push_back(value);
+        ASSERT_EQ(value.use_count(), 101);
+        list.pop_back();
+        list.pop_front();
+        list.remove(50);
+        ASSERT_EQ(value.use_count(), 98);
+    }
+    ASSERT_EQ(value.use_count(), 1);
+
+    // Two links and the element
+    typedef data_structs::NodePool<2 * sizeof(void *) + sizeof(value)> Pool;
+    Pointers list;
+    const size_t cached = Pool::cached();
+    ASSERT_GE(cached, 100u);
+    for (int i = 0; i < 100; ++i)
+        list.push_front(value);
+    ASSERT_EQ(Pool::cached(), cached - 100);
+}
+
+/*
+ * A list destroyed after the pool's thread local cache, the way static
+ * objects outlive the main thread's cache, frees its nodes directly.
+ */
+struct LateList {
+    ~LateList()
+    {
+        list.clear();
+        freed_after_cache = true;
+        cached_then = data_structs::NodePool<2 * sizeof(void *) + sizeof(size_t)>::cached();
+    }
+
+    List<size_t> list;
+
+    static bool freed_after_cache;
+    static size_t cached_then;
+};
+
+bool LateList::freed_after_cache = false;
+size_t LateList::cached_then = 1;
+
+TEST(Pool, ListOutlivesCache)
+{
+    std::thread thread([] {
+        // Constructed first, so destroyed after the cache
+        static thread_local LateList late;
+        List<size_t> early;
+        early.push_back(1);
+        early.pop_back();
+        for (int i = 0; i < 10; ++i)
+            late.list.push_back(i);
+    });
+    thread.join();
+    ASSERT_TRUE(LateList::freed_after_cache);
+    ASSERT_EQ(LateList::cached_then, 0u);
+}
+
+
+/*
+ * Counts every copy and move of itself.
+ */
+struct Counted {
+    static int copies;
+    static int moves;
+
+    Counted(int value = 0) : value(value) {}
+    Counted(const Counted &other) : value(other.value) { ++copies; }
+    Counted(Counted &&other) : value(other.value) { ++moves; }
+    Counted &operator=(const Counted &other) { value = other.value; ++copies; return *this; }
+    Counted &operator=(Counted &&other) { value = other.value; ++moves; return *this; }
+
+    static void reset() { copies = moves = 0; }
+
+    int value;
+};
+
+int Counted::copies = 0;
+int Counted::moves = 0;
+
+TEST(Move, MoveOnlyElements)
+{
+    List<std::unique_ptr<int>> list;
+    list.push_back(std::unique_ptr<int>(new int(1)));
+    list.emplace_back(new int(2));
+    list.emplace_front(new int(0));
+    std::unique_ptr<int> three(new int(3));
+    list.insert(list.end(), std::move(three));
+    list.insert(std::unique_ptr<int>(new int(5)), 1);
+    ASSERT_EQ(list.size(), 5);
+    const int expected[] = {0, 5, 1, 2, 3};
+    size_t i = 0;
+    for (auto &p : list)
+        ASSERT_EQ(*p, expected[i++]);
+
+    List<std::unique_ptr<int>> other(std::move(list));
+    ASSERT_TRUE(list.empty());
+    ASSERT_EQ(other.size(), 5);
+    list = std::move(other);
+    ASSERT_EQ(*list.at(4), 3);
+    ASSERT_TRUE(other.empty());
+    other.emplace_back(new int(7));
+    ASSERT_EQ(*other.at(0), 7);
+}
+
+TEST(Move, NoCopies)
+{
+    Counted::reset();
+    List<Counted> list;
+    list.push_back(Counted(1));
+    list.push_front(Counted(0));
+    list.emplace_back(2);
+    list.emplace(list.begin(), -1);
+    ASSERT_EQ(list.emplace_front(-2).value, -2);
+    ASSERT_EQ(Counted::copies, 0);
+    ASSERT_EQ(Counted::moves, 2);
+
+    Counted::reset();
+    List<Counted> moved(std::move(list));
+    List<Counted> assigned;
+    assigned.push_back(Counted(9));
+    assigned = std::move(moved);
+    ASSERT_EQ(Counted::copies, 0);
+    ASSERT_EQ(Counted::moves, 1);
+    ASSERT_EQ(assigned.size(), 5);
+    ASSERT_EQ(assigned.at(0).value, -2);
+    ASSERT_TRUE(noexcept(List<Counted>(std::move(assigned))));
+}
+
+TEST(Move, CopyAssignment)
+{
+    List<std::string> list;
+    list.push_back("a");
+    list.push_back("b");
+    List<std::string> copy;
+    copy.push_back("c");
+    copy = list;
+    ASSERT_EQ(copy.size(), 2);
+    copy.at(0) = "x";
+    ASSERT_EQ(list.at(0), "a");
+    copy = copy;
+    ASSERT_EQ(copy.at(1), "b");
+
+    Counted::reset();
+    List<Counted> counted;
+    counted.emplace_back(1);
+    counted.emplace_back(2);
+    List<Counted> other;
+    other = counted;
+    ASSERT_EQ(Counted::copies, 2);
+    ASSERT_EQ(other.at(1).value, 2);
+}
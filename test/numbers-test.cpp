@@ -0,0 +1,201 @@
+#include "../src/numbers.hh"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../src/calculation-tree.hh"
+
+using namespace std;
+using namespace calculation;
+
+static string format(double value)
+{
+    char buffer[Numbers::max_length];
+    size_t length = Numbers::format(value, buffer);
+    EXPECT_EQ(strlen(buffer), length);
+    return string(buffer, length);
+}
+
+static double parse(const string &text, size_t expected_length)
+{
+    double value = -1;
+    EXPECT_EQ(Numbers::parse(text.data(), text.data() + text.size(), value), expected_length) << text;
+    return value;
+}
+
+static double parse(const string &text)
+{
+    return parse(text, text.size());
+}
+
+static uint64_t bits(double value)
+{
+    uint64_t res;
+    memcpy(&res, &value, sizeof(res));
+    return res;
+}
+
+/*
+ * Number of significant digits in a formatted number.
+ */
+static int significant(const string &text)
+{
+    string digits;
+    for (char c : text) {
+        if (c == 'e')
+            break;
+        if (c >= '0' && c <= '9')
+            digits += c;
+    }
+    size_t first = digits.find_first_not_of('0');
+    size_t last = digits.find_last_not_of('0');
+    return last - first + 1;
+}
+
+
+TEST(Format, Notation)
+{
+    ASSERT_EQ(format(0), "0");
+    ASSERT_EQ(format(-0.0), "-0");
+    ASSERT_EQ(format(2), "2");
+    ASSERT_EQ(format(-2.5), "-2.5");
+    ASSERT_EQ(format(0.1), "0.1");
+    ASSERT_EQ(format(0.1 + 0.2), "0.30000000000000004");
+    ASSERT_EQ(format(1500), "1500");
+    ASSERT_EQ(format(1e20), "100000000000000000000");
+    ASSERT_EQ(format(1e21), "1e+21");
+    ASSERT_EQ(format(1e23), "1e+23");
+    ASSERT_EQ(format(0.000001), "0.000001");
+    ASSERT_EQ(format(1.25e-7), "1.25e-7");
+    ASSERT_EQ(format(9007199254740992.0), "9007199254740992");
+    ASSERT_EQ(format(DBL_MAX), "1.7976931348623157e+308");
+    ASSERT_EQ(format(DBL_MIN), "2.2250738585072014e-308");
+    ASSERT_EQ(format(5e-324), "5e-324");
+    ASSERT_EQ(format(numeric_limits<double>::infinity()), "inf");
+    ASSERT_EQ(format(-numeric_limits<double>::infinity()), "-inf");
+    ASSERT_EQ(format(numeric_limits<double>::quiet_NaN()), "nan");
+}
+
+TEST(Format, Constants)
+{
+    ASSERT_EQ(Constant(2.3).str(), "2.3");
+    ASSERT_EQ(Constant(1e100).str(), "1e+100");
+    ASSERT_EQ(Constant(2.3, "x").str(), "x");
+}
+
+
+TEST(Parse, Grammar)
+{
+    ASSERT_EQ(parse("0"), 0);
+    ASSERT_EQ(parse("42"), 42);
+    ASSERT_EQ(parse("-42"), -42);
+    ASSERT_EQ(parse("0.5"), 0.5);
+    ASSERT_EQ(parse("5."), 5);
+    ASSERT_EQ(parse("000.125"), 0.125);
+    ASSERT_EQ(parse("1e3"), 1000);
+    ASSERT_EQ(parse("1.5E+3"), 1500);
+    ASSERT_EQ(parse("25e-1"), 2.5);
+    ASSERT_EQ(parse("12abc", 2), 12);
+    ASSERT_EQ(parse("1e", 1), 1);
+    ASSERT_EQ(parse("1e+", 1), 1);
+    ASSERT_EQ(parse("1.5e3x", 5), 1500);
+    ASSERT_EQ(parse("1.2.3", 3), 1.2);
+    parse("", 0);
+    parse("-", 0);
+    parse("abc", 0);
+    parse(".5", 0);
+}
+
+TEST(Parse, Limits)
+{
+    ASSERT_EQ(parse("1e-400"), 0);
+    ASSERT_EQ(parse("2.4703282292062327e-324"), 0);
+    ASSERT_EQ(parse("2.4703282292062328e-324"), 5e-324);
+    ASSERT_EQ(parse("1.7976931348623157e308"), DBL_MAX);
+    ASSERT_EQ(parse("1.7976931348623158e308"), DBL_MAX);
+    double value;
+    const string big = "1.7976931348623159e308";
+    ASSERT_THROW(Numbers::parse(big.data(), big.data() + big.size(), value), out_of_range);
+    const string huge = "1e400";
+    ASSERT_THROW(Numbers::parse(huge.data(), huge.data() + huge.size(), value), out_of_range);
+    ASSERT_EQ(parse("0e999999999999"), 0);
+}
+
+TEST(Parse, Halfway)
+{
+    // Ties go to the even mantissa
+    ASSERT_EQ(parse("9007199254740993"), 9007199254740992.0);
+    ASSERT_EQ(parse("9007199254740995"), 9007199254740996.0);
+    // Any digit past the halfway point decides, however far it is
+    ASSERT_EQ(parse("9007199254740993." + string(1000, '0') + "1"), 9007199254740994.0);
+    ASSERT_EQ(parse("9007199254740993" + string(1000, '0') + "1e-1001"), 9007199254740994.0);
+}
+
+TEST(Parse, SameAsStrtod)
+{
+    mt19937_64 rng(20211215);
+    uniform_int_distribution<int> length(1, 30);
+    uniform_int_distribution<int> digit(0, 9);
+    uniform_int_distribution<int> exponent(-360, 330);
+    for (int i = 0; i < 100000; ++i) {
+        string text;
+        const int n = length(rng);
+        for (int j = 0; j < n; ++j)
+            text += char('0' + digit(rng));
+        text += "e" + to_string(exponent(rng));
+        const double expected = strtod(text.c_str(), nullptr);
+        if (isinf(expected))
+            continue;
+        ASSERT_EQ(bits(parse(text)), bits(expected)) << text;
+    }
+}
+
+
+/*
+ * Every finite double is printed with the fewest digits and reads back
+ * exactly, both by us and by the C library.
+ */
+TEST(RoundTrip, RandomDoubles)
+{
+    mt19937_64 rng(20211215);
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t pattern = rng();
+        double value;
+        memcpy(&value, &pattern, sizeof(value));
+        if (!isfinite(value))
+            continue;
+        string text = format(value);
+        ASSERT_EQ(bits(parse(text)), pattern) << text;
+        ASSERT_EQ(bits(strtod(text.c_str(), nullptr)), pattern) << text;
+        if (i % 10 == 0) {
+            // Nothing shorter reads back as the same value
+            const int digits = significant(text);
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), "%.*e", digits - 2, value);
+            ASSERT_TRUE(digits == 1 || strtod(buffer, nullptr) != value) << text;
+        }
+    }
+}
+
+TEST(RoundTrip, SmallValues)
+{
+    for (double value = 5e-324; value < 1e-300; value *= 3.7) {
+        string text = format(value);
+        ASSERT_EQ(parse(text), value) << text;
+        ASSERT_EQ(strtod(text.c_str(), nullptr), value) << text;
+    }
+    for (int i = 1; i <= 1000; ++i) {
+        string text = format(i / 100.0);
+        ASSERT_EQ(parse(text), i / 100.0) << text;
+        ASSERT_LE(significant(text), 4) << text;
+    }
+}
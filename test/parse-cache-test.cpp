@@ -0,0 +1,123 @@
+#include "../src/parse-cache.hh"
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../src/calculation-tree.hh"
+#include "../src/parsing.hh"
+#include "../src/parsing-exceptions.hh"
+#include "../src/thread-pool.hh"
+
+using namespace std;
+using namespace infix_parsing;
+using namespace calculation;
+using concurrency::ThreadPool;
+
+
+/*
+ * Parsing module heavily depends on the ParsingTable module init, so
+ * this test always has to be run.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+TEST(Normalisation, Whitespace)
+{
+    ASSERT_EQ(ParseCache::normalise(""), "");
+    ASSERT_EQ(ParseCache::normalise("   "), "");
+    ASSERT_EQ(ParseCache::normalise("1+2"), "1+2");
+    ASSERT_EQ(ParseCache::normalise("  1 +\t\t2 \n"), "1 + 2");
+    ASSERT_EQ(ParseCache::normalise("1 2"), "1 2");
+    // Only the amount of whitespace is normalised, not where it is
+    ASSERT_EQ(ParseCache::normalise(" 1 +\t 2 "), ParseCache::normalise("1 + 2"));
+    ASSERT_NE(ParseCache::normalise("1+ 2"), ParseCache::normalise("1 + 2"));
+}
+
+TEST(Cache, HitsAndMisses)
+{
+    ParseCache cache(1 << 20);
+    shared_ptr<const Operand> a = cache.parse("2 * 3");
+    shared_ptr<const Operand> b = cache.parse("  2  *\t3 ");
+    ASSERT_EQ(a, b);
+    ASSERT_EQ(a->evaluate(), 6);
+    ASSERT_NE(cache.parse("2*3"), a);
+
+    ParseCache::Statistics stats = cache.statistics();
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 2);
+    ASSERT_EQ(stats.evictions, 0);
+    ASSERT_EQ(stats.entries, 2);
+    ASSERT_GT(stats.memory, 0);
+
+    cache.clear();
+    ASSERT_EQ(cache.statistics().entries, 0);
+    ASSERT_EQ(cache.statistics().memory, 0);
+}
+
+TEST(Cache, Errors)
+{
+    ParseCache cache(1 << 20);
+    try {
+        cache.parse("  1 + + 2");
+        FAIL();
+    } catch (const ParserError &e) {
+        ASSERT_EQ(e.position, 6);
+    }
+    ASSERT_EQ(cache.statistics().entries, 0);
+}
+
+TEST(Cache, Eviction)
+{
+    // A single shard makes the eviction order predictable
+    const size_t entry = ParseCache::cost("1 + 1", parse_expression("1 + 1"));
+    ParseCache cache(entry * 3, 1);
+    shared_ptr<const Operand> first = cache.parse("1 + 1");
+    cache.parse("1 + 2");
+    cache.parse("1 + 3");
+    ASSERT_EQ(cache.parse("1 + 1"), first);
+    cache.parse("1 + 4");
+
+    ParseCache::Statistics stats = cache.statistics();
+    ASSERT_EQ(stats.evictions, 1);
+    ASSERT_EQ(stats.entries, 3);
+    ASSERT_LE(stats.memory, cache.memory_limit());
+    // "1 + 2" was the least recently used one
+    ASSERT_EQ(cache.parse("1 + 1"), first);
+    ASSERT_EQ(cache.statistics().hits, 2);
+    cache.parse("1 + 2");
+    ASSERT_EQ(cache.statistics().misses, 5);
+}
+
+TEST(Cache, TooBig)
+{
+    ParseCache cache(16, 1);
+    ASSERT_EQ(cache.parse("1 + 1")->evaluate(), 2);
+    ASSERT_EQ(cache.statistics().entries, 0);
+}
+
+TEST(Cache, Concurrent)
+{
+    ParseCache cache(1 << 16);
+    ThreadPool pool(4);
+    atomic<int> wrong(0);
+    for (int t = 0; t < 16; ++t) {
+        pool.submit([&cache, &wrong, t] {
+            for (int i = 0; i < 2000; ++i) {
+                int k = (i * 7 + t) % 300;
+                if (cache.parse(to_string(k) + " * 2")->evaluate() != k * 2)
+                    ++wrong;
+            }
+        });
+    }
+    pool.wait();
+    ASSERT_EQ(wrong.load(), 0);
+    ParseCache::Statistics stats = cache.statistics();
+    ASSERT_EQ(stats.hits + stats.misses, 32000);
+    ASSERT_LE(stats.memory, cache.memory_limit());
+}
@@ -1,8 +1,12 @@
 #include "../src/parsing-table.hh"
 
+#include <atomic>
 #include <cmath>
 #include <functional>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -97,3 +101,111 @@ TEST(RegisterAndFind, Binary)
     ASSERT_TRUE(pt::is_binary_operator("+"));
     ASSERT_NO_THROW(pt::get_binary_operator("+"));
 }
+
+
+/*
+ * Contexts have their own tables and don't touch the global one.
+ */
+
+TEST(Context, Independent)
+{
+    infix_parsing::ParsingContext a, b;
+    a.register_constant("x", 1);
+    b.register_constant("x", 2);
+    ASSERT_EQ(a.snapshot()->get_constant("x")->evaluate(), 1);
+    ASSERT_EQ(b.snapshot()->get_constant("x")->evaluate(), 2);
+    ASSERT_FALSE(pt::is_constant("x"));
+}
+
+TEST(Context, Replace)
+{
+    infix_parsing::ParsingContext ctx;
+    ctx.register_unary("f", std::negate<double>());
+    ctx.register_unary("f", (double(*)(double))std::fabs);
+    ASSERT_EQ(ctx.snapshot()->get_unary_operator("f")->apply(-3), 3);
+    ASSERT_THROW(ctx.register_binary("a b", std::plus<double>(), 0), pt::InvalidNameError);
+}
+
+TEST(Context, Snapshot)
+{
+    infix_parsing::ParsingContext ctx;
+    ctx.register_constant("x", 1);
+    std::shared_ptr<const infix_parsing::SymbolTable> old = ctx.snapshot();
+    ctx.update([](infix_parsing::SymbolTable &t) {
+        t.register_constant("x", 5);
+        t.register_constant("y", 6);
+    });
+    ASSERT_EQ(old->get_constant("x")->evaluate(), 1);
+    ASSERT_FALSE(old->is_constant("y"));
+    ASSERT_EQ(ctx.snapshot()->get_constant("x")->evaluate(), 5);
+    ASSERT_TRUE(ctx.snapshot()->is_constant("y"));
+}
+
+/*
+ * Snapshots are cached per thread; more contexts than the cache holds and
+ * contexts created at the address of a destroyed one still see their own
+ * latest table.
+ */
+TEST(Context, CachedSnapshots)
+{
+    for (int round = 0; round < 3; ++round) {
+        std::vector<std::unique_ptr<infix_parsing::ParsingContext>> contexts;
+        for (int i = 0; i < 10; ++i) {
+            contexts.emplace_back(new infix_parsing::ParsingContext);
+            contexts.back()->register_constant("x", i);
+        }
+        for (int i = 0; i < 10; ++i)
+            ASSERT_EQ(contexts[i]->snapshot()->get_constant_value("x"), i);
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_EQ(contexts[i]->snapshot()->get_constant_value("x"), i);
+            contexts[i]->register_constant("x", 10 * i);
+            ASSERT_EQ(contexts[i]->snapshot()->get_constant_value("x"), 10 * i);
+        }
+    }
+
+    // Other threads see a registration made after their first snapshot
+    infix_parsing::ParsingContext ctx;
+    ctx.register_constant("x", 1);
+    std::atomic<int> stage(0);
+    double seen = 0;
+    std::thread reader([&]() {
+        ASSERT_EQ(ctx.snapshot()->get_constant_value("x"), 1);
+        stage = 1;
+        while (stage != 2)
+            std::this_thread::yield();
+        seen = ctx.snapshot()->get_constant_value("x");
+    });
+    while (stage != 1)
+        std::this_thread::yield();
+    ctx.register_constant("x", 2);
+    stage = 2;
+    reader.join();
+    ASSERT_EQ(seen, 2);
+}
+
+TEST(Context, FailedUpdate)
+{
+    infix_parsing::ParsingContext ctx;
+    ASSERT_THROW(ctx.update([](infix_parsing::SymbolTable &t) {
+        t.register_constant("x", 5);
+        t.register_constant("", 6);
+    }), pt::InvalidNameError);
+    ASSERT_FALSE(ctx.snapshot()->is_constant("x"));
+}
+
+TEST(Context, SharedDescriptors)
+{
+    infix_parsing::ParsingContext ctx;
+    ctx.register_binary("p", std::plus<double>(), 1);
+    std::shared_ptr<BinaryOperator> a = ctx.snapshot()->get_binary_operator("p");
+    std::shared_ptr<BinaryOperator> b = ctx.snapshot()->get_binary_operator("p");
+    ASSERT_NE(a, b);
+    ASSERT_EQ(a->descriptor(), b->descriptor());
+    ASSERT_EQ(a->descriptor(), ctx.snapshot()->get_binary_descriptor("p"));
+
+    // Nodes keep a replaced operator alive
+    ctx.register_binary("p", std::minus<double>(), 2);
+    ASSERT_EQ(a->apply(3, 1), 4);
+    ASSERT_EQ(a->order(), 1);
+    ASSERT_EQ(ctx.snapshot()->get_binary_operator("p")->apply(3, 1), 2);
+}
@@ -1,12 +1,17 @@
 #include "../src/parsing.hh"
 
+#include <atomic>
 #include <cmath>
 #include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "../src/calculation-tree.hh"
+#include "../src/parsing-exceptions.hh"
+#include "../src/parsing-table.hh"
 
 using namespace std;
 using namespace infix_parsing;
@@ -113,3 +118,46 @@ TEST(ComplexExpression, Functions)
     ASSERT_NO_THROW(res = parse_expression("sin (pi/6)"));
     ASSERT_TRUE(abs(res->evaluate()) - abs(0.5) < numeric_limits<double>::epsilon());
 }
+
+TEST(Context, Reinitialization)
+{
+    ASSERT_NO_THROW(init_table());
+    shared_ptr<Operand> res;
+    ASSERT_NO_THROW(res = parse_expression("2 - 3"));
+    ASSERT_EQ(res->evaluate(), -1);
+}
+
+TEST(Context, Tenants)
+{
+    ParsingContext a, b;
+    init_table(a);
+    init_table(b);
+    b.register_unary("twice", [](double x) { return 2 * x; });
+    ASSERT_EQ(parse_expression("twice 4", *b.snapshot())->evaluate(), 8);
+    ASSERT_THROW(parse_expression("twice 4", *a.snapshot()), ParserError);
+    ASSERT_THROW(parse_expression("twice 4"), ParserError);
+}
+
+TEST(Context, ConcurrentRegistration)
+{
+    ParsingContext ctx;
+    init_table(ctx);
+    atomic<bool> stop(false);
+    atomic<int> wrong(0);
+    vector<thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (!stop.load()) {
+                if (parse_expression("sin 0 + 2 * 3", *ctx.snapshot())->evaluate() != 6)
+                    ++wrong;
+            }
+        });
+    }
+    for (int i = 0; i < 200; ++i)
+        ctx.register_constant("c" + to_string(i) + "_", i);
+    stop.store(true);
+    for (auto &r : readers)
+        r.join();
+    ASSERT_EQ(wrong.load(), 0);
+    ASSERT_EQ(parse_expression("c199_ + 1", *ctx.snapshot())->evaluate(), 200);
+}
@@ -0,0 +1,149 @@
+#include "../src/profiler.hh"
+
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/calculation-tree.hh"
+#include "../src/parsing.hh"
+#include "../src/symbols.hh"
+
+using namespace std;
+using namespace infix_parsing;
+using calculation::Operand;
+using calculation::Profiler;
+using calculation::Symbols;
+
+
+/*
+ * Parsing module heavily depends on the ParsingTable module init, so
+ * this test always has to be run.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+
+TEST(Values, SameAsTree)
+{
+    for (const string s : {"42", "1 + 2 * 3", "-(1 + 2) ^ 2", "sin pi/6 + ctg 1", "2 ^ 3 ^ 2"}) {
+        shared_ptr<Operand> tree = parse_expression(s);
+        for (unsigned period : {1, 3}) {
+            Profiler profiler(*tree, period);
+            for (int i = 0; i < 5; ++i)
+                ASSERT_DOUBLE_EQ(profiler.evaluate(), tree->evaluate()) << s;
+        }
+    }
+    ASSERT_THROW(Profiler(*parse_expression("1"), 0), std::invalid_argument);
+}
+
+TEST(Frames, Subtrees)
+{
+    shared_ptr<Operand> tree = parse_expression("sin 1 + 2 * 3");
+    Profiler profiler(*tree, 1);
+    for (int i = 0; i < 10; ++i)
+        profiler.evaluate();
+    ASSERT_EQ(profiler.runs(), 10u);
+    ASSERT_EQ(profiler.samples(), 10u);
+
+    vector<Profiler::Subtree> subtrees = profiler.subtrees();
+    ASSERT_EQ(subtrees.size(), 3u);
+    ASSERT_EQ(subtrees[0].label, tree->str());
+    ASSERT_EQ(subtrees[0].depth, 0u);
+    ASSERT_EQ(subtrees[1].label, "sin 1");
+    ASSERT_EQ(subtrees[1].depth, 1u);
+    ASSERT_EQ(subtrees[2].label, "* 2 3");
+    for (auto &s : subtrees) {
+        ASSERT_EQ(s.calls, 10u);
+        ASSERT_LE(s.self_ticks, s.ticks);
+    }
+    ASSERT_GE(subtrees[0].ticks, subtrees[1].ticks + subtrees[2].ticks);
+
+    // A lone number has no operators to attribute time to
+    shared_ptr<Operand> number = parse_expression("42");
+    Profiler leaf(*number);
+    ASSERT_DOUBLE_EQ(leaf.evaluate(), 42);
+    ASSERT_TRUE(leaf.subtrees().empty());
+    ASSERT_TRUE(leaf.symbols().empty());
+}
+
+TEST(Frames, LongLabels)
+{
+    string sum = "1";
+    for (int i = 0; i < 50; ++i)
+        sum += " + 1";
+    shared_ptr<Operand> tree = parse_expression(sum);
+    Profiler profiler(*tree);
+    const string label = profiler.subtrees()[0].label;
+    ASSERT_EQ(label.size(), Profiler::max_label);
+    ASSERT_EQ(label.substr(label.size() - 3), "...");
+}
+
+
+static double slow(double a, double b)
+{
+    volatile double x = a;
+    for (int i = 0; i < 2000; ++i)
+        x = std::sqrt(x + b);
+    return x;
+}
+
+TEST(Symbols, Attribution)
+{
+    ParsingContext ctx;
+    init_table(ctx);
+    ctx.register_binary("slow", slow, 1);
+    shared_ptr<Operand> tree = parse_expression("1 + 2 slow 3 + 4 + sin 5", *ctx.snapshot());
+
+    Profiler profiler(*tree, 4);
+    for (int i = 0; i < 100; ++i)
+        profiler.evaluate();
+    ASSERT_EQ(profiler.samples(), 25u);
+
+    vector<Profiler::Symbol> symbols = profiler.symbols();
+    ASSERT_EQ(symbols.size(), 3u);
+    ASSERT_EQ(Symbols::name(symbols[0].name), "slow");
+    ASSERT_EQ(symbols[0].calls, 100u);
+    for (auto &s : symbols) {
+        if (Symbols::name(s.name) == "+") {
+            ASSERT_EQ(s.calls, 300u);
+        }
+    }
+
+    ostringstream report;
+    profiler.write_report(report);
+    ASSERT_NE(report.str().find("runs 100, timed 25"), string::npos);
+    ASSERT_NE(report.str().find("slow"), string::npos);
+}
+
+
+TEST(Collapsed, Stacks)
+{
+    shared_ptr<Operand> tree = parse_expression("sqrt (1 + 2 * 3) - 4");
+    Profiler profiler(*tree, 1);
+    for (int i = 0; i < 1000; ++i)
+        profiler.evaluate();
+
+    ostringstream out;
+    profiler.write_collapsed(out);
+    istringstream lines(out.str());
+    string line;
+    size_t count = 0;
+    while (getline(lines, line)) {
+        ++count;
+        // Every stack starts at the root and ends with a count of ticks
+        ASSERT_EQ(line.compare(0, tree->str().size() + 1, tree->str() + (line.find(';') == string::npos ? " " : ";")), 0) << line;
+        const size_t space = line.rfind(' ');
+        ASSERT_GT(stoull(line.substr(space + 1)), 0u) << line;
+    }
+    ASSERT_GE(count, 1u);
+    ASSERT_LE(count, 4u);
+    ASSERT_NE(out.str().find(tree->str() + ";sqrt + 1 * 2 3;+ 1 * 2 3"), string::npos);
+}
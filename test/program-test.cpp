@@ -0,0 +1,127 @@
+#include "../src/program.hh"
+
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../src/parsing.hh"
+#include "../src/parsing-exceptions.hh"
+#include "../src/parsing-table.hh"
+#include "../src/thread-pool.hh"
+
+using namespace std;
+using namespace infix_parsing;
+using concurrency::ThreadPool;
+
+
+/*
+ * Programs are parsed with the default parsing table, so it has to be
+ * initialized first.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+TEST(Parsing, Statements)
+{
+    shared_ptr<Program> p;
+    ASSERT_NO_THROW(p = parse_program("a = 2; b = a * 2; c = sin(a) + b"));
+    ASSERT_EQ(p->size(), 3);
+    ASSERT_EQ(p->at(0).name, "a");
+    ASSERT_EQ(p->at(1).name, "b");
+    ASSERT_EQ(p->at(2).name, "c");
+    ASSERT_EQ(p->at(2).dependencies.size(), 2);
+}
+
+TEST(Parsing, Separators)
+{
+    shared_ptr<Program> p;
+    ASSERT_NO_THROW(p = parse_program("a = 1\n\nb = 2;;\n c = 3;"));
+    ASSERT_EQ(p->size(), 3);
+    ASSERT_NO_THROW(p = parse_program(""));
+    ASSERT_EQ(p->size(), 0);
+}
+
+TEST(Parsing, Errors)
+{
+    ASSERT_THROW(parse_program("a 2"), AssignmentExpectationUnsatisfied);
+    ASSERT_THROW(parse_program("a = 1; a = 2"), NameRedefinition);
+    ASSERT_THROW(parse_program("pi = 3"), NameRedefinition);
+    ASSERT_THROW(parse_program("1a = 3"), SyntaxError);
+    ASSERT_THROW(parse_program("a = "), OperandExpectationUnsatisfied);
+    ASSERT_THROW(parse_program("a = b; b = c; c = a"), CyclicDependency);
+    ASSERT_THROW(parse_program("a = a + 1"), CyclicDependency);
+}
+
+TEST(Parsing, ErrorPosition)
+{
+    try {
+        parse_program("a = 1; b = 2 +");
+        FAIL();
+    } catch (const ParserError &e) {
+        ASSERT_EQ(e.position, 14);
+    }
+}
+
+TEST(Evaluation, Sequential)
+{
+    shared_ptr<Program> p = parse_program("c = sin(a) + b; b = a * 2; a = 2");
+    ASSERT_EQ(p->schedule().front(), 2);
+    p->evaluate();
+    ASSERT_EQ(p->value("a"), 2);
+    ASSERT_EQ(p->value("b"), 4);
+    ASSERT_EQ(p->value("c"), sin(2.0) + 4);
+    ASSERT_THROW(p->value("d"), ParsingTable::NameSearchError);
+}
+
+TEST(Evaluation, Parallel)
+{
+    string text = "x0 = 1";
+    for (int i = 1; i < 200; ++i) {
+        text += "; x" + to_string(i) + " = x" + to_string(i / 2)
+            + " + x" + to_string(i - 1);
+    }
+    shared_ptr<Program> seq = parse_program(text);
+    shared_ptr<Program> par = parse_program(text);
+    seq->evaluate();
+    ThreadPool pool(4);
+    par->evaluate(pool);
+    for (int i = 0; i < 200; ++i) {
+        string name = "x" + to_string(i);
+        ASSERT_EQ(seq->value(name), par->value(name));
+    }
+}
+
+/*
+ * Statements that only depend on the first one are all ready at once, so
+ * the pool runs many of them side by side before the last one joins them.
+ */
+TEST(Evaluation, ParallelWide)
+{
+    const int width = 256;
+    string text = "x0 = 2";
+    string join = "y = x0";
+    for (int i = 1; i < width; ++i) {
+        const string name = "x" + to_string(i);
+        text += "; " + name + " = sin(x0 * " + to_string(i) + ") + " + to_string(i);
+        join += " + " + name;
+    }
+    text += "; " + join;
+
+    shared_ptr<Program> seq = parse_program(text);
+    seq->evaluate();
+    ThreadPool pool(4);
+    for (int round = 0; round < 20; ++round) {
+        shared_ptr<Program> par = parse_program(text);
+        par->evaluate(pool);
+        for (int i = 0; i < width; ++i) {
+            string name = "x" + to_string(i);
+            ASSERT_EQ(seq->value(name), par->value(name));
+        }
+        ASSERT_EQ(seq->value("y"), par->value("y"));
+    }
+}
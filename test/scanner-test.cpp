@@ -0,0 +1,76 @@
+#include "../src/scanner.hh"
+
+#include <cctype>
+#include <random>
+#include <string>
+
+#include <gtest/gtest.h>
+
+using namespace std;
+using infix_parsing::Scanner;
+
+
+TEST(Classes, SameAsCLocale)
+{
+    for (int i = 0; i < 256; ++i) {
+        const char c = char(i);
+        const bool ascii = i < 128;
+        ASSERT_EQ(Scanner::is_space(c), ascii && isspace(i) != 0) << i;
+        ASSERT_EQ(Scanner::is_digit(c), ascii && isdigit(i) != 0) << i;
+        ASSERT_EQ(Scanner::is_number(c), ascii && (isdigit(i) || c == '.')) << i;
+        ASSERT_EQ(Scanner::is_identifier(c), ascii && (isalnum(i) || c == '_')) << i;
+        ASSERT_EQ(Scanner::is_graph(c), ascii && isgraph(i) != 0) << i;
+    }
+}
+
+TEST(Skip, Runs)
+{
+    const string s = "   \t\n 12.5e3 abc_9+x";
+    const char *begin = s.data(), *end = begin + s.size();
+    const char *number = Scanner::skip_spaces(begin, end);
+    ASSERT_EQ(number - begin, 6);
+    ASSERT_EQ(Scanner::skip_number(number, end) - begin, 10);
+    ASSERT_EQ(Scanner::skip_identifier(begin + 13, end) - begin, 18);
+    ASSERT_EQ(Scanner::skip_spaces(end, end), end);
+    ASSERT_EQ(Scanner::skip_identifier(begin, end), begin);
+}
+
+TEST(Skip, LongRuns)
+{
+    for (size_t n : {15, 16, 17, 31, 32, 33, 1000}) {
+        const string spaces(n, ' ');
+        const string digits(n, '7');
+        const string letters(n, 'Q');
+        ASSERT_EQ(Scanner::skip_spaces(spaces.data(), spaces.data() + n), spaces.data() + n);
+        ASSERT_EQ(Scanner::skip_number(digits.data(), digits.data() + n), digits.data() + n);
+        ASSERT_EQ(Scanner::skip_identifier(letters.data(), letters.data() + n), letters.data() + n);
+        const string stopped = letters + "-" + letters;
+        ASSERT_EQ(Scanner::skip_identifier(stopped.data(), stopped.data() + stopped.size()), stopped.data() + n);
+    }
+}
+
+/*
+ * Wide and table scanners agree at every length and alignment, with
+ * bytes from all the classes and from outside ASCII.
+ */
+TEST(Skip, SameAsScalar)
+{
+    static const string alphabet = " \t\n\v\f\r0123456789.azAZ_@[`{/:\x7f\x80\xe0\xff";
+    mt19937 rng(20211215);
+    uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    uniform_int_distribution<int> bias(0, 3);
+    for (int i = 0; i < 20000; ++i) {
+        string s;
+        const size_t n = i % 80;
+        // Long runs of a single class are more interesting than noise
+        const char run = alphabet[pick(rng)];
+        for (size_t j = 0; j < n; ++j)
+            s += bias(rng) ? run : alphabet[pick(rng)];
+        const char *begin = s.data(), *end = begin + s.size();
+        for (size_t off = 0; off <= min<size_t>(s.size(), 3); ++off) {
+            ASSERT_EQ(Scanner::skip_spaces(begin + off, end), Scanner::skip_spaces_scalar(begin + off, end));
+            ASSERT_EQ(Scanner::skip_number(begin + off, end), Scanner::skip_number_scalar(begin + off, end));
+            ASSERT_EQ(Scanner::skip_identifier(begin + off, end), Scanner::skip_identifier_scalar(begin + off, end));
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#include "../src/serializer.hh"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/calculation-tree.hh"
+#include "../src/parsing.hh"
+
+using namespace std;
+using namespace calculation;
+using infix_parsing::init_table;
+using infix_parsing::parse_expression;
+
+
+/*
+ * Parsing module heavily depends on the ParsingTable module init, so
+ * this test always has to be run.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+
+TEST(Prefix, SameAsBefore)
+{
+    Serializer s;
+    ASSERT_EQ(s.str(*parse_expression("2")), "2");
+    ASSERT_EQ(s.str(*parse_expression("-2 + 3 * 4")), "+ - 2 * 3 4");
+    ASSERT_EQ(s.str(*parse_expression("sin (pi/6)")), "sin / pi 6");
+    ASSERT_EQ(parse_expression("(3-2)*3")->str(), "* - 3 2 3");
+}
+
+TEST(Infix, MinimalParentheses)
+{
+    Serializer s(Serializer::infix);
+    ASSERT_EQ(s.str(*parse_expression("(3-2)*3")), "(3 - 2) * 3");
+    ASSERT_EQ(s.str(*parse_expression("((3*2))-3")), "3 * 2 - 3");
+    ASSERT_EQ(s.str(*parse_expression("1 - 2 - 3")), "1 - 2 - 3");
+    ASSERT_EQ(s.str(*parse_expression("1 - (2 - 3)")), "1 - (2 - 3)");
+    ASSERT_EQ(s.str(*parse_expression("1 - (2 * 3)")), "1 - 2 * 3");
+    ASSERT_EQ(s.str(*parse_expression("2 ^ 3 ^ 2")), "2 ^ 3 ^ 2");
+    ASSERT_EQ(s.str(*parse_expression("2 ^ (3 ^ 2)")), "2 ^ (3 ^ 2)");
+    ASSERT_EQ(s.str(*parse_expression("sin (pi/6) + - - 2")), "sin (pi / 6) + - - 2");
+}
+
+TEST(Infix, ReadsBack)
+{
+    static const vector<string> sources = {
+        "pi",
+        "-2 + 3 * 4",
+        "3^(2*3)",
+        "log (10 * 10) / (2 - 1 - 1 + 4)",
+        "sin (pi/6) + cos pi - abs(-3) / sqrt 4",
+        "(1 + 2) * (3 - (4 / (5 ^ 2)))",
+    };
+    Serializer s(Serializer::infix);
+    for (auto &src : sources) {
+        shared_ptr<Operand> tree = parse_expression(src);
+        string text = s.str(*tree);
+        shared_ptr<Operand> back = parse_expression(text);
+        ASSERT_EQ(back->evaluate(), tree->evaluate()) << src;
+        ASSERT_EQ(back->str(), tree->str()) << src;
+        ASSERT_EQ(s.str(*back), text) << src;
+    }
+}
+
+TEST(Output, Appends)
+{
+    Serializer s(Serializer::infix);
+    string out = "x = ";
+    s.write(*parse_expression("1+2"), out);
+    ASSERT_EQ(out, "x = 1 + 2");
+
+    ostringstream stream;
+    s.write(*parse_expression("1+2"), stream);
+    ASSERT_EQ(stream.str(), "1 + 2");
+}
+
+TEST(Output, Incomplete)
+{
+    Serializer s;
+    ASSERT_THROW(s.str(Expression()), logic_error);
+    ASSERT_THROW(s.str(BinaryOperator("+", plus<double>(), 2)), logic_error);
+}
+
+/*
+ * Recursive printing would take quadratic time here. The tree's own
+ * destructor is recursive, so the levels are released from the top one
+ * at a time, which keeps sanitized builds with their larger frames off
+ * the end of the stack.
+ */
+TEST(Output, DeepTree)
+{
+    const size_t depth = 5000;
+    vector<shared_ptr<Operand>> levels;
+    levels.push_back(make_shared<Constant>(1));
+    for (size_t i = 0; i < depth; ++i) {
+        shared_ptr<BinaryOperator> op = make_shared<BinaryOperator>("+", plus<double>(), 2);
+        op->set_left(levels.back());
+        op->set_right(make_shared<Constant>(1));
+        shared_ptr<Expression> exp = make_shared<Expression>();
+        exp->set_root(op);
+        levels.push_back(exp);
+    }
+    const Operand &tree = *levels.back();
+    ostringstream stream;
+    Serializer(Serializer::infix).write(tree, stream);
+    ASSERT_EQ(stream.str().size(), 1 + depth * 4);
+    ASSERT_EQ(tree.str().size(), 1 + depth * 4);
+    while (!levels.empty())
+        levels.pop_back();
+}
@@ -0,0 +1,230 @@
+#include "../src/server.hh"
+
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "../src/parsing.hh"
+
+using namespace std;
+using namespace server;
+using infix_parsing::init_table;
+
+
+/*
+ * Parsing module heavily depends on the ParsingTable module init, so
+ * this test always has to be run.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+
+/*
+ * Server running on its own thread for the time of a test.
+ */
+class Running {
+public:
+    explicit Running(size_t threads = 2)
+        : path("/tmp/server-test-" + to_string(getpid()) + ".sock"),
+          server(path, threads),
+          thread([this] { server.run(); })
+    {}
+    ~Running()
+    {
+        server.stop();
+        thread.join();
+    }
+
+    string path;
+    Server server;
+    std::thread thread;
+};
+
+
+TEST(Requests, Evaluate)
+{
+    Running running;
+    Client client(running.path);
+    ASSERT_DOUBLE_EQ(client.evaluate("2 + 3 * 4"), 14);
+    ASSERT_DOUBLE_EQ(client.evaluate("sin (pi / 2)"), 1);
+    ASSERT_DOUBLE_EQ(client.evaluate(""), 0);
+}
+
+TEST(Requests, FormulaWithInputs)
+{
+    Running running;
+    Client client(running.path);
+    const uint32_t formula = client.parse("x * y + 1", {"x", "y"});
+    ASSERT_DOUBLE_EQ(client.evaluate(formula, {2, 3}), 7);
+    ASSERT_DOUBLE_EQ(client.evaluate(formula, {-1, 5}), -4);
+    ASSERT_EQ(client.parse("2 ^ 10"), formula + 1);
+    ASSERT_DOUBLE_EQ(client.evaluate(formula + 1, {}), 1024);
+    ASSERT_EQ(running.server.formula_count(), 2u);
+
+    // Formulas belong to the connection, numbers start over on another
+    Client other(running.path);
+    ASSERT_THROW(other.evaluate(formula + 1, {}), Client::RequestError);
+    ASSERT_EQ(other.parse("x - 1", {"x"}), formula);
+    ASSERT_DOUBLE_EQ(other.evaluate(formula, {4}), 3);
+    ASSERT_DOUBLE_EQ(client.evaluate(formula, {4, 4}), 17);
+    ASSERT_EQ(running.server.formula_count(), 3u);
+}
+
+static bool wait_for_formulas(const Server &server, size_t count)
+{
+    for (int i = 0; i < 1000 && server.formula_count() != count; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    return server.formula_count() == count;
+}
+
+TEST(Requests, FormulasFreedOnClose)
+{
+    Running running;
+    Client stays(running.path);
+    stays.parse("1");
+    {
+        Client client(running.path);
+        for (uint32_t i = 0; i < 1000; ++i)
+            client.send_parse(i, "x + " + to_string(i), {"x"});
+        for (uint32_t i = 0; i < 1000; ++i)
+            ASSERT_EQ(client.receive().formula, i);
+        ASSERT_EQ(running.server.formula_count(), 1001u);
+    }
+    ASSERT_TRUE(wait_for_formulas(running.server, 1));
+    ASSERT_DOUBLE_EQ(stays.evaluate(0, {}), 1);
+}
+
+TEST(Requests, FormulaLimit)
+{
+    Running running;
+    Client client(running.path);
+    for (uint32_t i = 0; i < protocol::max_formulas; ++i)
+        client.send_parse(i, "2");
+    for (uint32_t i = 0; i < protocol::max_formulas; ++i)
+        ASSERT_EQ(client.receive().status, protocol::ok);
+    try {
+        client.parse("2");
+        FAIL();
+    } catch (const Client::RequestError &e) {
+        ASSERT_EQ(e.status, protocol::bad_request);
+    }
+    ASSERT_DOUBLE_EQ(client.evaluate(protocol::max_formulas - 1, {}), 2);
+}
+
+/*
+ * Responses are told apart by the request they answer, not by their
+ * size.
+ */
+TEST(Requests, MixedResponses)
+{
+    Running running;
+    Client client(running.path);
+    client.send_parse(10, "x", {"x"});
+    client.send_evaluate(11, "1 / 4");
+    client.send_evaluate(12, 0, {2.5});
+    client.send_parse(13, "3");
+
+    Client::Response response = client.receive();
+    ASSERT_EQ(response.id, 10u);
+    ASSERT_EQ(response.formula, 0u);
+    response = client.receive();
+    ASSERT_EQ(response.id, 11u);
+    ASSERT_DOUBLE_EQ(response.value, 0.25);
+    response = client.receive();
+    ASSERT_DOUBLE_EQ(response.value, 2.5);
+    response = client.receive();
+    ASSERT_EQ(response.id, 13u);
+    ASSERT_EQ(response.formula, 1u);
+    ASSERT_DOUBLE_EQ(response.value, 0);
+}
+
+TEST(Requests, Errors)
+{
+    Running running;
+    Client client(running.path);
+    try {
+        client.evaluate("1 + ");
+        FAIL();
+    } catch (const Client::RequestError &e) {
+        ASSERT_EQ(e.status, protocol::parse_error);
+        ASSERT_EQ(e.position, 4u);
+    }
+    ASSERT_THROW(client.evaluate(7, {}), Client::RequestError);
+    const uint32_t formula = client.parse("x", {"x"});
+    try {
+        client.evaluate(formula, {1, 2});
+        FAIL();
+    } catch (const Client::RequestError &e) {
+        ASSERT_EQ(e.status, protocol::bad_request);
+    }
+    ASSERT_THROW(client.parse("x", {"x", "x"}), Client::RequestError);
+
+    // The connection is still usable
+    ASSERT_DOUBLE_EQ(client.evaluate(formula, {5}), 5);
+}
+
+TEST(Requests, PipelinedInOrder)
+{
+    Running running;
+    Client client(running.path);
+    const uint32_t formula = client.parse("x / 2", {"x"});
+    const uint32_t count = 20000;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (i % 2)
+            client.send_evaluate(i, formula, {double(i)});
+        else
+            client.send_evaluate(i, to_string(i) + " / 2");
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        Client::Response response = client.receive();
+        ASSERT_EQ(response.id, i);
+        ASSERT_EQ(response.status, protocol::ok);
+        ASSERT_DOUBLE_EQ(response.value, i / 2.0);
+    }
+}
+
+TEST(Requests, ManyConnections)
+{
+    Running running(4);
+    vector<std::thread> threads;
+    vector<int> correct(8, 0);
+    for (size_t t = 0; t < correct.size(); ++t) {
+        threads.emplace_back([&running, &correct, t] {
+            Client client(running.path);
+            const uint32_t formula = client.parse("a - b", {"a", "b"});
+            for (int i = 0; i < 500; ++i)
+                client.send_evaluate(i, formula, {double(t), double(i)});
+            for (int i = 0; i < 500; ++i) {
+                Client::Response response = client.receive();
+                correct[t] += response.value == double(t) - response.id;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    for (int c : correct)
+        ASSERT_EQ(c, 500);
+}
+
+TEST(Requests, ClientGoesAway)
+{
+    Running running;
+    {
+        Client client(running.path);
+        for (uint32_t i = 0; i < 1000; ++i)
+            client.send_evaluate(i, "1 + 1");
+        client.flush();
+    }
+    Client client(running.path);
+    ASSERT_DOUBLE_EQ(client.evaluate("1 + 1"), 2);
+}
@@ -0,0 +1,243 @@
+#include "../src/shared-rings.hh"
+
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "../src/parsing.hh"
+
+using namespace std;
+using namespace server;
+using infix_parsing::init_table;
+
+
+/*
+ * Parsing module heavily depends on the ParsingTable module init, so
+ * this test always has to be run.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+
+static const shared::Geometry geometry = {8, 256, 2};
+
+TEST(Region, Layout)
+{
+    ASSERT_THROW(SharedRegion::create({3, 16, 1}), std::invalid_argument);
+
+    SharedRegion region = SharedRegion::create(geometry);
+    ASSERT_EQ(region.geometry().slots, 8u);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(region.submissions()) % 64, 0u);
+    ASSERT_EQ(region.inputs(1, 0), region.inputs(0, 1) + geometry.max_rows);
+    ASSERT_LE(reinterpret_cast<char *>(region.outputs(7) + geometry.max_rows),
+              reinterpret_cast<char *>(&region.header()) + region.size());
+
+    SharedRegion other = SharedRegion::attach(region.fd());
+    region.inputs(3, 1)[5] = 42;
+    ASSERT_EQ(other.inputs(3, 1)[5], 42);
+}
+
+TEST(Region, Named)
+{
+    const string name = "/shared-rings-test-" + to_string(getpid());
+    {
+        SharedRegion region = SharedRegion::create(geometry, name);
+        SharedRegion other = SharedRegion::open(name);
+        region.outputs(2)[0] = 7;
+        ASSERT_EQ(other.outputs(2)[0], 7);
+        ASSERT_THROW(SharedRegion::create(geometry, name), std::system_error);
+    }
+    SharedRegion::unlink(name);
+    ASSERT_THROW(SharedRegion::open(name), std::system_error);
+}
+
+
+TEST(Rings, Columns)
+{
+    SharedRegion region = SharedRegion::create(geometry);
+    RingEvaluator evaluator(region);
+    const uint32_t sum = evaluator.add("x + y * 2", {"x", "y"});
+    const uint32_t sine = evaluator.add("sin x", {"x"});
+
+    RingClient client(region);
+    const uint32_t a = client.acquire();
+    const uint32_t b = client.acquire();
+    for (uint32_t row = 0; row < 100; ++row) {
+        client.inputs(a, 0)[row] = row;
+        client.inputs(a, 1)[row] = 0.5;
+        client.inputs(b, 0)[row] = row / 100.0;
+    }
+    client.submit(a, sum, 100, 1);
+    client.submit(b, sine, 100, 2);
+
+    shared::Completion completion;
+    ASSERT_FALSE(client.poll(completion));
+    ASSERT_EQ(evaluator.poll(), 2u);
+    ASSERT_EQ(evaluator.poll(), 0u);
+
+    completion = client.wait();
+    ASSERT_EQ(completion.slot, a);
+    ASSERT_EQ(completion.tag, 1u);
+    ASSERT_EQ(completion.status, shared::ok);
+    for (uint32_t row = 0; row < 100; ++row)
+        ASSERT_DOUBLE_EQ(client.outputs(a)[row], row + 1.0);
+    completion = client.wait();
+    ASSERT_EQ(completion.slot, b);
+    for (uint32_t row = 0; row < 100; ++row)
+        ASSERT_DOUBLE_EQ(client.outputs(b)[row], std::sin(row / 100.0));
+}
+
+TEST(Rings, BadSubmissions)
+{
+    SharedRegion region = SharedRegion::create(geometry);
+    RingEvaluator evaluator(region);
+    evaluator.add("1");
+    ASSERT_THROW(evaluator.add("a + b + c", {"a", "b", "c"}), std::invalid_argument);
+
+    RingClient client(region);
+    client.submit(0, 5, 1);
+    client.submit(0, 0, geometry.max_rows + 1);
+    client.submit(9, 0, 1);
+    evaluator.poll();
+    ASSERT_EQ(client.wait().status, shared::unknown_formula);
+    ASSERT_EQ(client.wait().status, shared::too_many_rows);
+    ASSERT_EQ(client.wait().status, shared::bad_slot);
+}
+
+/*
+ * The header lives in memory the client can write. What the evaluator
+ * checked on attach stays what it uses.
+ */
+TEST(Rings, CorruptedHeader)
+{
+    SharedRegion region = SharedRegion::create(geometry);
+    SharedRegion attached = SharedRegion::attach(region.fd());
+    RingEvaluator evaluator(attached);
+    evaluator.add("x", {"x"});
+
+    shared::Geometry &header = region.header().geometry;
+    header.slots = 1u << 31;
+    header.max_rows = 1u << 30;
+    header.max_inputs = 1u << 30;
+    ASSERT_EQ(attached.geometry().slots, geometry.slots);
+    ASSERT_EQ(attached.geometry().max_rows, geometry.max_rows);
+    ASSERT_EQ(attached.outputs(1), attached.outputs(0) + geometry.max_rows);
+    ASSERT_THROW(SharedRegion::attach(region.fd()), std::runtime_error);
+
+    RingClient client(region);
+    client.submit(0, 0, geometry.max_rows + 1);
+    client.submit(geometry.slots, 0, 1);
+    client.submit(1, 0, geometry.max_rows);
+    ASSERT_EQ(evaluator.poll(), 3u);
+    ASSERT_EQ(client.wait().status, shared::too_many_rows);
+    ASSERT_EQ(client.wait().status, shared::bad_slot);
+    ASSERT_EQ(client.wait().status, shared::ok);
+}
+
+/*
+ * Without inputs the output section alone can overflow: 2^30 slots of
+ * 2^31 rows wrap to no bytes at all, and a sparse region is large enough
+ * for the rest of the layout.
+ */
+TEST(Rings, CorruptedHeaderWithoutInputs)
+{
+    SharedRegion region = SharedRegion::create(geometry);
+    shared::Geometry &header = region.header().geometry;
+    header.slots = 1u << 30;
+    header.max_rows = 1u << 31;
+    header.max_inputs = 0;
+    ASSERT_EQ(::ftruncate(region.fd(), (off_t(1) << 35) + region.size()), 0);
+    ASSERT_THROW(SharedRegion::attach(region.fd()), std::runtime_error);
+}
+
+TEST(Rings, SlotsRunOut)
+{
+    SharedRegion region = SharedRegion::create(geometry);
+    RingClient client(region);
+    for (uint32_t i = 0; i < geometry.slots; ++i)
+        ASSERT_GE(client.acquire(), 0);
+    ASSERT_EQ(client.acquire(), -1);
+    client.release(3);
+    ASSERT_EQ(client.acquire(), 3);
+}
+
+
+/*
+ * Client keeps every slot busy while the evaluator thread polls, the
+ * counters wrap around the rings many times.
+ */
+TEST(Rings, Threads)
+{
+    SharedRegion region = SharedRegion::create(geometry);
+    RingEvaluator evaluator(region);
+    const uint32_t formula = evaluator.add("x * x - y", {"x", "y"});
+    atomic<bool> stop(false);
+    std::thread thread([&] { evaluator.run(stop); });
+
+    RingClient client(region);
+    const uint32_t batches = 5000;
+    uint32_t sent = 0;
+    uint32_t wrong = 0;
+    for (uint32_t done = 0; done < batches; ++done) {
+        int64_t slot;
+        while (sent < batches && (slot = client.acquire()) >= 0) {
+            for (uint32_t row = 0; row < 16; ++row) {
+                client.inputs(slot, 0)[row] = sent;
+                client.inputs(slot, 1)[row] = row;
+            }
+            client.submit(slot, formula, 16, sent++);
+        }
+        const shared::Completion completion = client.wait();
+        for (uint32_t row = 0; row < 16; ++row)
+            wrong += client.outputs(completion.slot)[row] != double(completion.tag) * completion.tag - row;
+        client.release(completion.slot);
+    }
+    stop = true;
+    thread.join();
+    ASSERT_EQ(wrong, 0u);
+}
+
+/*
+ * Evaluator in another process, sharing an anonymous region inherited
+ * over fork().
+ */
+TEST(Rings, Processes)
+{
+    SharedRegion region = SharedRegion::create(geometry);
+    const uint32_t batches = 100;
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        SharedRegion mine = SharedRegion::attach(region.fd());
+        RingEvaluator evaluator(mine);
+        evaluator.add("abs x", {"x"});
+        size_t handled = 0;
+        while (handled < batches)
+            handled += evaluator.poll();
+        _exit(0);
+    }
+
+    RingClient client(region);
+    double sum = 0;
+    for (uint32_t i = 0; i < batches; ++i) {
+        const int64_t slot = client.acquire();
+        client.inputs(slot, 0)[0] = -double(i);
+        client.submit(slot, 0, 1);
+        const shared::Completion completion = client.wait();
+        sum += client.outputs(completion.slot)[0];
+        client.release(completion.slot);
+    }
+    int status;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    ASSERT_EQ(sum, batches * (batches - 1) / 2);
+}
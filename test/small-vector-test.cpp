@@ -0,0 +1,116 @@
+#include "../src/small-vector.hh"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+using data_structs::SmallVector;
+
+
+TEST(Base, Creation)
+{
+    SmallVector<int, 4> v;
+    ASSERT_TRUE(v.empty());
+    ASSERT_EQ(v.size(), 0u);
+    ASSERT_EQ(v.capacity(), 4u);
+    ASSERT_TRUE(v.is_inline());
+    ASSERT_TRUE(v.begin() == v.end());
+    ASSERT_THROW(v.at(0), std::out_of_range);
+}
+
+TEST(Base, Spill)
+{
+    SmallVector<int, 4> v;
+    for (int i = 0; i < 4; ++i)
+        v.push_back(i);
+    ASSERT_TRUE(v.is_inline());
+    v.push_back(4);
+    ASSERT_FALSE(v.is_inline());
+    ASSERT_GE(v.capacity(), 5u);
+    for (int i = 5; i < 100; ++i)
+        v.push_back(i);
+    ASSERT_EQ(v.size(), 100u);
+    int expected = 0;
+    for (int x : v)
+        ASSERT_EQ(x, expected++);
+    ASSERT_EQ(v.back(), 99);
+    v.pop_back();
+    ASSERT_EQ(v.at(98), 98);
+    ASSERT_THROW(v.at(99), std::out_of_range);
+    v.clear();
+    ASSERT_TRUE(v.empty());
+}
+
+/*
+ * Pushing an element of the vector itself while it grows.
+ */
+TEST(Base, PushOwnElement)
+{
+    SmallVector<std::string, 2> v;
+    v.push_back("first");
+    v.push_back("second");
+    v.push_back(v[0]);
+    v.emplace_back(v[1]);
+    ASSERT_EQ(v[2], "first");
+    ASSERT_EQ(v[3], "second");
+}
+
+TEST(Copy, InlineAndHeap)
+{
+    SmallVector<std::string, 2> small;
+    small.push_back("a");
+    SmallVector<std::string, 2> big;
+    for (int i = 0; i < 5; ++i)
+        big.push_back(std::to_string(i));
+
+    SmallVector<std::string, 2> copy(small);
+    ASSERT_TRUE(copy.is_inline());
+    ASSERT_EQ(copy[0], "a");
+    copy = big;
+    ASSERT_EQ(copy.size(), 5u);
+    copy[0] = "x";
+    ASSERT_EQ(big[0], "0");
+    copy = small;
+    ASSERT_EQ(copy.size(), 1u);
+}
+
+TEST(Move, InlineAndHeap)
+{
+    SmallVector<std::unique_ptr<int>, 2> small;
+    small.emplace_back(new int(1));
+    SmallVector<std::unique_ptr<int>, 2> moved(std::move(small));
+    ASSERT_TRUE(small.empty());
+    ASSERT_TRUE(moved.is_inline());
+    ASSERT_EQ(*moved[0], 1);
+
+    SmallVector<std::unique_ptr<int>, 2> big;
+    for (int i = 0; i < 5; ++i)
+        big.emplace_back(new int(i));
+    const std::unique_ptr<int> *data = big.data();
+    moved = std::move(big);
+    // A heap buffer changes hands as it is
+    ASSERT_EQ(moved.data(), data);
+    ASSERT_TRUE(big.empty());
+    ASSERT_TRUE(big.is_inline());
+    ASSERT_EQ(*moved[4], 4);
+    big.emplace_back(new int(7));
+    ASSERT_EQ(*big[0], 7);
+}
+
+TEST(Elements, Destroyed)
+{
+    auto value = std::make_shared<int>(1);
+    {
+        SmallVector<std::shared_ptr<int>, 4> v;
+        for (int i = 0; i < 10; ++i)
+            v.push_back(value);
+        v.pop_back();
+        ASSERT_EQ(value.use_count(), 10);
+        SmallVector<std::shared_ptr<int>, 4> copy(v);
+        ASSERT_EQ(value.use_count(), 19);
+    }
+    ASSERT_EQ(value.use_count(), 1);
+}
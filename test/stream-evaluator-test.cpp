@@ -0,0 +1,157 @@
+#include "../src/stream-evaluator.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "../src/parsing.hh"
+#include "../src/parsing-exceptions.hh"
+
+using namespace std;
+using namespace infix_parsing;
+
+
+/*
+ * Parsing module heavily depends on the ParsingTable module init, so
+ * this test always has to be run.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+
+static double stream(const string &expression, size_t chunk_size = StreamEvaluator::default_chunk_size)
+{
+    StreamEvaluator evaluator(ParsingContext::global(), chunk_size);
+    istringstream in(expression);
+    return evaluator.evaluate(in);
+}
+
+static const vector<string> corpus = {
+    "",
+    "2",
+    "  42  ",
+    "1.5e3 + 2",
+    "2 + 3 * 4",
+    "(2 + 3) * 4",
+    "2 ^ 3 ^ 2",
+    "10 - 4 - 3",
+    "100 / 10 / 5",
+    "-2^2",
+    "--3",
+    "-(1 + 2) * 3",
+    "sin pi/6",
+    "sin (pi/6)",
+    "abs -7 + sqrt 16",
+    "ln e",
+    "() + 1",
+    "((((1))))",
+    "2*(3+(4-(5*(6/2))))",
+    "1e300 * 1e300",
+};
+
+TEST(Values, SameAsParser)
+{
+    for (const string &s : corpus) {
+        const double expected = parse_expression(s)->evaluate();
+        ASSERT_DOUBLE_EQ(stream(s), expected) << s;
+    }
+}
+
+TEST(Values, AnyChunkSize)
+{
+    for (size_t chunk = 1; chunk <= 4; ++chunk) {
+        for (const string &s : corpus)
+            ASSERT_DOUBLE_EQ(stream(s, chunk), parse_expression(s)->evaluate()) << s << " " << chunk;
+    }
+}
+
+TEST(Values, NumberLongerThanChunk)
+{
+    const string number = "123456789.123456789e-5";
+    ASSERT_DOUBLE_EQ(stream(number + " + 1", 2), 123456789.123456789e-5 + 1);
+    const string digits = string(1000, '1') + "e-990";
+    ASSERT_DOUBLE_EQ(stream(digits, 16), parse_expression(digits)->evaluate());
+}
+
+TEST(Values, TableSnapshot)
+{
+    ParsingContext ctx;
+    init_table(ctx);
+    ctx.register_binary("mod", (double (*)(double, double))std::fmod, 1);
+
+    StreamEvaluator evaluator(ctx, 3);
+    istringstream in("17 mod 5 + 1");
+    ASSERT_DOUBLE_EQ(evaluator.evaluate(in), 3);
+}
+
+
+static size_t error_position(const string &expression, size_t chunk_size)
+{
+    try {
+        stream(expression, chunk_size);
+    } catch (const ParserError &e) {
+        return e.position;
+    }
+    ADD_FAILURE() << "No error in \"" << expression << "\"";
+    return 0;
+}
+
+TEST(Errors, Positions)
+{
+    for (size_t chunk : {1, 2, 7, 4096}) {
+        ASSERT_EQ(error_position("1 + ", chunk), 4u);
+        ASSERT_EQ(error_position("1 + foo", chunk), 4u);
+        ASSERT_EQ(error_position("1 2", chunk), 2u);
+        ASSERT_EQ(error_position("(1 + 2", chunk), 6u);
+        ASSERT_EQ(error_position("1 + 2)", chunk), 5u);
+        ASSERT_EQ(error_position(string(5000, ' ') + "1 +* 2", chunk), 5003u);
+    }
+    ASSERT_THROW(stream("1 + 1e400"), TooBigNumber);
+    ASSERT_THROW(stream("(1 + 2"), UnexpectedEndOfExpression);
+    ASSERT_THROW(stream("1 2"), BinaryExpectationUnsatisfied);
+    ASSERT_THROW(stream("1 + "), OperandExpectationUnsatisfied);
+}
+
+
+/*
+ * A long flat sum is evaluated as it goes, nesting is what takes memory.
+ */
+TEST(Memory, BoundedByNesting)
+{
+    string sum = "0";
+    for (int i = 0; i < 100000; ++i)
+        sum += " + 1 * 2 ^ 1";
+    StreamEvaluator evaluator(ParsingContext::global(), 1024);
+    istringstream flat(sum);
+    ASSERT_DOUBLE_EQ(evaluator.evaluate(flat), 200000);
+    ASSERT_EQ(evaluator.max_depth(), 7u);
+
+    const int depth = 5000;
+    istringstream nested(string(depth, '(') + "1" + string(depth, ')'));
+    ASSERT_DOUBLE_EQ(evaluator.evaluate(nested), 1);
+    ASSERT_EQ(evaluator.max_depth(), size_t(depth + 1));
+}
+
+TEST(FileDescriptor, Pipe)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    const string expression = "(2 + 3) * sin (pi / 2)";
+    ASSERT_EQ(write(fds[1], expression.data(), expression.size()), ssize_t(expression.size()));
+    close(fds[1]);
+
+    StreamEvaluator evaluator(ParsingContext::global(), 4);
+    ASSERT_DOUBLE_EQ(evaluator.evaluate(fds[0]), 5);
+    close(fds[0]);
+
+    ASSERT_THROW(evaluator.evaluate(-1), std::system_error);
+}
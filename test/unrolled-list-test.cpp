@@ -0,0 +1,247 @@
+#include "../src/unrolled-list.hh"
+
+#include <deque>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+using data_structs::UnrolledList;
+
+/*
+ * Small chunks, so that a handful of elements already spans several.
+ */
+typedef UnrolledList<int, 4> Small;
+
+
+template<class Expected>
+static void expect_same(Small &list, const Expected &expected)
+{
+    ASSERT_EQ(list.size(), expected.size());
+    size_t i = 0;
+    for (int x : list)
+        ASSERT_EQ(x, expected[i++]);
+    ASSERT_EQ(i, expected.size());
+    for (i = 0; i < expected.size(); ++i)
+        ASSERT_EQ(list.at(i), expected[i]);
+}
+
+
+TEST(Base, Creation)
+{
+    Small list;
+    ASSERT_EQ(list.size(), 0u);
+    ASSERT_TRUE(list.empty());
+    ASSERT_TRUE(list.begin() == list.end());
+    ASSERT_THROW(list.at(0), std::out_of_range);
+    ASSERT_THROW(*list.begin(), std::out_of_range);
+}
+
+TEST(Base, PushBothEnds)
+{
+    Small list;
+    std::deque<int> expected;
+    for (int i = 0; i < 10; ++i) {
+        list.push_back(i);
+        expected.push_back(i);
+        list.push_front(-i);
+        expected.push_front(-i);
+    }
+    expect_same(list, expected);
+
+    for (int i = 0; i < 7; ++i) {
+        list.pop_front();
+        expected.pop_front();
+    }
+    for (int i = 0; i < 5; ++i) {
+        list.pop_back();
+        expected.pop_back();
+    }
+    expect_same(list, expected);
+
+    while (!list.empty())
+        list.pop_back();
+    list.pop_back();
+    ASSERT_TRUE(list.begin() == list.end());
+    list.push_front(5);
+    ASSERT_EQ(list.at(0), 5);
+}
+
+TEST(Base, CopyAndMove)
+{
+    Small list;
+    for (int i = 0; i < 9; ++i)
+        list.push_back(i);
+    Small copy(list);
+    copy.at(0) = 100;
+    ASSERT_EQ(list.at(0), 0);
+    ASSERT_EQ(copy.size(), 9u);
+
+    Small moved(std::move(copy));
+    ASSERT_TRUE(copy.empty());
+    ASSERT_EQ(moved.at(0), 100);
+    copy = list;
+    ASSERT_EQ(copy.at(8), 8);
+    list = std::move(moved);
+    ASSERT_EQ(list.at(0), 100);
+    ASSERT_TRUE(moved.empty());
+}
+
+
+TEST(Iterators, Traversal)
+{
+    Small list;
+    for (int i = 0; i < 10; ++i)
+        list.push_back(i);
+    Small::Iterator it = list.begin();
+    for (int i = 0; i < 10; ++i)
+        ASSERT_EQ(*it++, i);
+    ASSERT_TRUE(it == list.end());
+    ASSERT_THROW(++it, std::out_of_range);
+    ASSERT_THROW(*it, std::out_of_range);
+    ASSERT_THROW(--it, std::out_of_range);
+    ASSERT_THROW(++Small::Iterator(), std::logic_error);
+
+    it = list.begin();
+    for (int i = 0; i < 9; ++i)
+        ++it;
+    for (int i = 9; i > 0; --i)
+        ASSERT_EQ(*it--, i);
+    ASSERT_EQ(*it, 0);
+}
+
+TEST(Iterators, InsertAndErase)
+{
+    Small list;
+    std::deque<int> expected;
+    // Inserting before every element splits full chunks over and over
+    for (int i = 0; i < 4; ++i) {
+        list.push_back(i);
+        expected.push_back(i);
+    }
+    for (int round = 0; round < 3; ++round) {
+        Small::Iterator it = list.begin();
+        size_t index = 0;
+        while (it != list.end()) {
+            it = list.insert(it, 100 + round);
+            expected.insert(expected.begin() + index, 100 + round);
+            ++it;
+            ++it;
+            index += 2;
+        }
+        expect_same(list, expected);
+    }
+    list.emplace(list.end(), 7);
+    expected.push_back(7);
+    list.emplace(list.begin(), 8);
+    expected.push_front(8);
+    expect_same(list, expected);
+
+    // Erasing every other element empties some chunks entirely
+    Small::Iterator it = list.begin();
+    size_t index = 0;
+    while (it != list.end()) {
+        it = list.erase(it);
+        expected.erase(expected.begin() + index);
+        if (it != list.end())
+            ++it;
+        ++index;
+    }
+    expect_same(list, expected);
+    ASSERT_THROW(list.erase(list.end()), std::out_of_range);
+    ASSERT_THROW(list.insert(Small::Iterator(), 1), std::logic_error);
+}
+
+/*
+ * Random mix of every modification against std::deque.
+ */
+TEST(Iterators, Random)
+{
+    std::mt19937 random(12345);
+    Small list;
+    std::deque<int> expected;
+    for (int step = 0; step < 20000; ++step) {
+        const int value = step;
+        switch (random() % 6) {
+        case 0:
+            list.push_back(value);
+            expected.push_back(value);
+            break;
+        case 1:
+            list.push_front(value);
+            expected.push_front(value);
+            break;
+        case 2:
+        case 3: {
+            const size_t index = expected.empty() ? 0 : random() % (expected.size() + 1);
+            Small::Iterator it = list.begin();
+            for (size_t i = 0; i < index; ++i)
+                ++it;
+            ASSERT_EQ(*list.insert(it, value), value);
+            expected.insert(expected.begin() + index, value);
+            break;
+        }
+        case 4:
+            if (!expected.empty()) {
+                const size_t index = random() % expected.size();
+                Small::Iterator it = list.begin();
+                for (size_t i = 0; i < index; ++i)
+                    ++it;
+                it = list.erase(it);
+                expected.erase(expected.begin() + index);
+                if (index < expected.size())
+                    ASSERT_EQ(*it, expected[index]);
+                else
+                    ASSERT_TRUE(it == list.end());
+            }
+            break;
+        case 5:
+            if (!expected.empty()) {
+                const size_t index = random() % expected.size();
+                ASSERT_EQ(list.at(index), expected[index]);
+            }
+            break;
+        }
+        if (expected.size() > 200) {
+            while (expected.size() > 50) {
+                list.pop_front();
+                expected.pop_front();
+            }
+        }
+    }
+    expect_same(list, expected);
+}
+
+
+TEST(Elements, DestroyedWithChunks)
+{
+    auto value = std::make_shared<int>(1);
+    {
+        UnrolledList<std::shared_ptr<int>, 4> list;
+        for (int i = 0; i < 10; ++i)
+            list.push_back(value);
+        list.erase(list.begin());
+        list.pop_back();
+        ASSERT_EQ(value.use_count(), 9);
+    }
+    ASSERT_EQ(value.use_count(), 1);
+}
+
+TEST(Elements, MoveOnly)
+{
+    UnrolledList<std::unique_ptr<std::string>, 4> list;
+    for (int i = 0; i < 6; ++i)
+        list.emplace_back(new std::string(std::to_string(i)));
+    list.insert(list.begin(), std::unique_ptr<std::string>(new std::string("x")));
+    auto it = list.begin();
+    ++it;
+    ++it;
+    list.emplace(it, new std::string("y"));
+    const char *expected[] = {"x", "0", "y", "1", "2", "3", "4", "5"};
+    size_t i = 0;
+    for (auto &p : list)
+        ASSERT_EQ(*p, expected[i++]);
+}
@@ -0,0 +1,168 @@
+#include "../src/workspace.hh"
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../src/allocation-counter.hh"
+#include "../src/parsing.hh"
+#include "../src/parsing-exceptions.hh"
+
+using namespace std;
+using namespace infix_parsing;
+using diagnostics::AllocationCounter;
+
+
+/*
+ * Parsing module heavily depends on the ParsingTable module init, so
+ * this test always has to be run.
+ */
+
+TEST(Initial, Initialization)
+{
+    ASSERT_NO_THROW(init_table());
+}
+
+
+static const vector<string> corpus = {
+    "",
+    "2",
+    "  42  ",
+    "1.5e3 + 2",
+    "2 + 3 * 4",
+    "(2 + 3) * 4",
+    "2 ^ 3 ^ 2",
+    "10 - 4 - 3",
+    "100 / 10 / 5",
+    "-2^2",
+    "--3",
+    "-(1 + 2) * 3",
+    "sin pi/6",
+    "sin (pi/6)",
+    "abs -7 + sqrt 16",
+    "ln e",
+    "() + 1",
+    "((((1))))",
+    "2*(3+(4-(5*(6/2))))",
+    "1e300 * 1e300",
+};
+
+TEST(Values, SameAsParser)
+{
+    Workspace workspace;
+    for (const string &s : corpus) {
+        const double expected = parse_expression(s)->evaluate();
+        ASSERT_DOUBLE_EQ(workspace.evaluate(s), expected) << s;
+    }
+    ASSERT_DOUBLE_EQ(workspace.evaluate("xx 2 + 3", 3), 5);
+}
+
+TEST(Values, ParsedOnce)
+{
+    Workspace workspace;
+    workspace.parse("sqrt (3 * 3 + 4 * 4)");
+    ASSERT_EQ(workspace.size(), 8u);
+    for (int i = 0; i < 3; ++i)
+        ASSERT_DOUBLE_EQ(workspace.evaluate(), 5);
+}
+
+TEST(Values, Variables)
+{
+    auto x = make_shared<calculation::Variable>("x", 2);
+    auto pie = make_shared<calculation::Variable>("pie", 10);
+    Scope scope = {{"x", x}, {"pie", pie}};
+
+    Workspace workspace;
+    workspace.parse("x * x + pie - pi", scope);
+    ASSERT_DOUBLE_EQ(workspace.evaluate(), 4 + 10 - M_PI);
+    // Variables are read on evaluation
+    x->set_value(3);
+    ASSERT_DOUBLE_EQ(workspace.evaluate(), 9 + 10 - M_PI);
+    ASSERT_DOUBLE_EQ(workspace.evaluate("-x + sin x", scope), parse_expression("-x + sin x", scope)->evaluate());
+}
+
+TEST(Values, TableSnapshot)
+{
+    ParsingContext ctx;
+    init_table(ctx);
+    ctx.register_binary("mod", (double (*)(double, double))std::fmod, 1);
+
+    Workspace workspace(ctx);
+    ASSERT_DOUBLE_EQ(workspace.evaluate("17 mod 5 + 1"), 3);
+    ASSERT_THROW(Workspace().evaluate("17 mod 5"), BinaryExpectationUnsatisfied);
+}
+
+
+static size_t error_position(const string &expression)
+{
+    try {
+        Workspace().parse(expression);
+    } catch (const ParserError &e) {
+        return e.position;
+    }
+    ADD_FAILURE() << "No error in \"" << expression << "\"";
+    return 0;
+}
+
+TEST(Errors, Positions)
+{
+    ASSERT_EQ(error_position("1 + "), 4u);
+    ASSERT_EQ(error_position("1 + foo"), 4u);
+    ASSERT_EQ(error_position("1 2"), 2u);
+    ASSERT_EQ(error_position("(1 + 2"), 6u);
+    ASSERT_EQ(error_position("1 + 2)"), 5u);
+    ASSERT_THROW(Workspace().parse("1 + 1e400"), TooBigNumber);
+    ASSERT_THROW(Workspace().parse("(1 + 2"), UnexpectedEndOfExpression);
+}
+
+TEST(Errors, ProgramDropped)
+{
+    Workspace workspace;
+    workspace.parse("1 + 2");
+    ASSERT_THROW(workspace.parse("1 + 2 +"), OperandExpectationUnsatisfied);
+    ASSERT_EQ(workspace.size(), 0u);
+    ASSERT_DOUBLE_EQ(workspace.evaluate(), 0);
+}
+
+
+/*
+ * Once the buffers have grown for the longest expression, nothing is
+ * allocated any more: neither by parsing nor by evaluation.
+ */
+TEST(Allocations, NoneAfterWarmUp)
+{
+    auto x = make_shared<calculation::Variable>("x", 0.5);
+    Scope scope = {{"x", x}};
+    vector<string> expressions(corpus);
+    expressions.push_back("sin x * cos x + x ^ 2 - ln (x + e)");
+    expressions.push_back(string(100, '(') + "x" + string(100, ')'));
+
+    Workspace workspace;
+    vector<double> expected;
+    for (const string &s : expressions)
+        expected.push_back(workspace.evaluate(s, scope));
+
+    const size_t iterations = 1000000;
+    size_t mismatches = 0;
+    const size_t before = AllocationCounter::count();
+    for (size_t i = 0; i < iterations; ++i) {
+        const size_t k = i % expressions.size();
+        if (workspace.evaluate(expressions[k], scope) != expected[k])
+            ++mismatches;
+    }
+    const size_t allocations = AllocationCounter::count() - before;
+
+    ASSERT_EQ(allocations, 0u);
+    ASSERT_EQ(mismatches, 0u);
+}
+
+TEST(Allocations, Counted)
+{
+    const size_t before = AllocationCounter::count();
+    unique_ptr<int> p(new int(1));
+    parse_expression("1 + 2");
+    ASSERT_GE(AllocationCounter::count() - before, 2u);
+}